@@ -0,0 +1,317 @@
+// Bancada do Sentinela: reproduz rastros de eventos contra o firmware compilado no host e
+// mede, por evento, a latência até a primeira saída (relé, mensagem, edição, documento) e
+// as alocações; no fim, a vazão, o tempo de CPU por tarefa e o volume de mensagens.
+//
+// Formato do rastro (um evento por linha; `#` começa um comentário):
+//   <instante_ms> pino <gpio> <nivel>          muda o nível de uma entrada
+//   <instante_ms> pulso <gpio> <nivel> <ms>    o nível dura <ms> e depois volta
+//   <instante_ms> rf <codigo> [quadros]        quadros RF iguais, a cada 40 ms
+//   <instante_ms> chat <id>                    chat das próximas mensagens (não é evento)
+//   <instante_ms> telegram <texto...>          mensagem recebida pelo bot
+//   <instante_ms> wifi <0|1>                   derruba ou devolve a rede
+//   <instante_ms> fim                          duração do rastro (padrão: último + 60 s)
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "simulador.h"
+
+namespace {
+
+const char* CHAT_PADRAO = "SEU_CHAT_ID_TELEGRAM"; // O `CHAT_ID` de fábrica do sketch.
+const uint64_t FOLGA_FINAL_US = 60000000;
+
+struct Evento {
+  uint64_t instanteUs;
+  std::string tipo;
+  std::vector<std::string> args;
+  std::string resto; // Tudo depois do tipo (o texto de `telegram`).
+  std::string chat;
+};
+
+struct Rastro {
+  std::string nome;
+  std::vector<Evento> eventos;
+  uint64_t duracaoUs = 0;
+};
+
+struct Medicao {
+  std::string tipo;
+  uint64_t instanteUs = 0;
+  uint64_t nsInicio = 0;
+  uint64_t alocacoesInicio = 0;
+  bool respondida = false;
+  uint64_t latenciaUs = 0; // Virtual: prazos do firmware e latências simuladas.
+  uint64_t latenciaNs = 0; // Real: custo de CPU no host até a primeira saída.
+  uint64_t alocacoes = 0;  // Até o próximo evento.
+};
+
+struct Opcoes {
+  int repeticoes = 1;
+  bool transcricao = false;
+  std::vector<std::string> arquivos;
+};
+
+std::vector<Medicao> medicoes;
+std::map<sim::TipoSaida, uint64_t> saidasPorTipo;
+bool transcrever = false;
+
+const char* nomeSaida(sim::TipoSaida t){
+  switch(t){
+    case sim::SAIDA_GPIO:      return "gpio";
+    case sim::SAIDA_TELEGRAM:  return "mensagem";
+    case sim::SAIDA_EDICAO:    return "edição";
+    case sim::SAIDA_DOCUMENTO: return "documento";
+    case sim::SAIDA_REINICIO:  return "reinício";
+  }
+  return "?";
+}
+
+bool carregarRastro(const std::string& caminho, Rastro& r){
+  std::ifstream f(caminho);
+  if(!f){
+    fprintf(stderr, "bancada: não foi possível abrir %s\n", caminho.c_str());
+    return false;
+  }
+  r.nome = caminho.substr(caminho.find_last_of('/') + 1);
+  std::string linha, chat = CHAT_PADRAO;
+  bool temFim = false;
+  for(int n = 1; std::getline(f, linha); n++){
+    linha = linha.substr(0, linha.find('#'));
+    std::istringstream in(linha);
+    double ms;
+    Evento e;
+    if(!(in >> ms)){
+      if(linha.find_first_not_of(" \t\r") != std::string::npos){
+        fprintf(stderr, "%s:%d: instante inválido\n", caminho.c_str(), n);
+        return false;
+      }
+      continue;
+    }
+    in >> e.tipo;
+    e.instanteUs = (uint64_t)llround(ms * 1000);
+    std::getline(in, e.resto);
+    size_t p = e.resto.find_first_not_of(" \t");
+    e.resto = p == std::string::npos ? std::string() : e.resto.substr(p);
+    while(!e.resto.empty() && (e.resto.back() == '\r' || e.resto.back() == ' ')){
+      e.resto.pop_back();
+    }
+    std::istringstream palavras(e.resto);
+    for(std::string a; palavras >> a;){
+      e.args.push_back(a);
+    }
+    size_t esperados = e.tipo == "pino" ? 2 : e.tipo == "pulso" ? 3 : e.tipo == "rf" ? 1 :
+                       e.tipo == "chat" ? 1 : e.tipo == "wifi" ? 1 : 0;
+    bool conhecido = e.tipo == "pino" || e.tipo == "pulso" || e.tipo == "rf" || e.tipo == "chat" ||
+                     e.tipo == "telegram" || e.tipo == "wifi" || e.tipo == "fim";
+    if(!conhecido || e.args.size() < esperados || (e.tipo == "telegram" && e.resto.empty())){
+      fprintf(stderr, "%s:%d: evento inválido: %s\n", caminho.c_str(), n, linha.c_str());
+      return false;
+    }
+    if(e.tipo == "fim"){
+      r.duracaoUs = e.instanteUs;
+      temFim = true;
+      continue;
+    }
+    if(e.tipo == "chat"){
+      chat = e.args[0];
+      continue;
+    }
+    e.chat = chat;
+    r.eventos.push_back(e);
+  }
+  std::stable_sort(r.eventos.begin(), r.eventos.end(),
+                   [](const Evento& a, const Evento& b){ return a.instanteUs < b.instanteUs; });
+  if(!temFim){
+    r.duracaoUs = (r.eventos.empty() ? 0 : r.eventos.back().instanteUs) + FOLGA_FINAL_US;
+  }
+  return true;
+}
+
+void fecharMedicaoAtual(){
+  if(!medicoes.empty()){
+    Medicao& m = medicoes.back();
+    m.alocacoes = sim::contadores().alocacoes - m.alocacoesInicio;
+  }
+}
+
+void injetar(const Evento& e){
+  fecharMedicaoAtual();
+  Medicao m;
+  m.tipo = e.tipo;
+  m.instanteUs = sim::agoraUs();
+  m.alocacoesInicio = sim::contadores().alocacoes;
+  m.nsInicio = sim::nsHost();
+  medicoes.push_back(m);
+  if(transcrever){
+    printf("[%10.3f s] > %s %s\n", sim::agoraUs() / 1e6, e.tipo.c_str(), e.resto.c_str());
+  }
+
+  if(e.tipo == "pino"){
+    sim::definirPino((uint8_t)atoi(e.args[0].c_str()), (uint8_t)atoi(e.args[1].c_str()));
+  } else if(e.tipo == "pulso"){
+    uint8_t pino = (uint8_t)atoi(e.args[0].c_str());
+    uint8_t nivel = (uint8_t)atoi(e.args[1].c_str());
+    sim::definirPino(pino, nivel);
+    sim::agendar(sim::agoraUs() + (uint64_t)atoll(e.args[2].c_str()) * 1000,
+                 [pino, nivel]{ sim::definirPino(pino, !nivel); });
+  } else if(e.tipo == "rf"){
+    uint32_t quadros = e.args.size() > 1 ? (uint32_t)atoi(e.args[1].c_str()) : 4;
+    sim::receberRF((uint32_t)strtoul(e.args[0].c_str(), nullptr, 10), quadros);
+  } else if(e.tipo == "telegram"){
+    sim::receberTelegram(e.chat, e.resto);
+  } else if(e.tipo == "wifi"){
+    sim::definirWiFi(atoi(e.args[0].c_str()) != 0);
+  }
+}
+
+void observarSaida(const sim::Saida& s){
+  saidasPorTipo[s.tipo]++;
+  if(!medicoes.empty() && !medicoes.back().respondida){
+    Medicao& m = medicoes.back();
+    m.respondida = true;
+    m.latenciaUs = s.instanteUs - m.instanteUs;
+    m.latenciaNs = sim::nsHost() - m.nsInicio;
+  }
+  if(transcrever){
+    if(s.tipo == sim::SAIDA_GPIO){
+      printf("[%10.3f s] < gpio %u = %u\n", s.instanteUs / 1e6, s.valor >> 1, s.valor & 1);
+    } else {
+      printf("[%10.3f s] < %s #%u: %s\n", s.instanteUs / 1e6, nomeSaida(s.tipo), s.valor, s.texto.c_str());
+    }
+  }
+}
+
+template<typename T> T percentil(std::vector<T> v, double q){
+  if(v.empty()){
+    return 0;
+  }
+  std::sort(v.begin(), v.end());
+  size_t i = (size_t)ceil(q * v.size());
+  return v[std::min(v.size() - 1, i > 0 ? i - 1 : 0)];
+}
+
+void relatorio(uint64_t nsTotal, uint64_t duracaoUs){
+  printf("\n%-9s %6s %6s | %27s | %27s | %15s\n", "evento", "total", "c/saída",
+         "latência virtual (ms)", "latência no host (us)", "alocações");
+  printf("%-9s %6s %6s | %8s %8s %9s | %8s %8s %9s | %7s %7s\n", "", "", "", "p50", "p99", "máx",
+         "p50", "p99", "máx", "média", "máx");
+  std::map<std::string, std::vector<const Medicao*>> porTipo;
+  for(const Medicao& m : medicoes){
+    porTipo[m.tipo].push_back(&m);
+  }
+  for(auto& par : porTipo){
+    std::vector<double> virt, host;
+    std::vector<uint64_t> aloc;
+    for(const Medicao* m : par.second){
+      if(m->respondida){
+        virt.push_back(m->latenciaUs / 1000.0);
+        host.push_back(m->latenciaNs / 1000.0);
+      }
+      aloc.push_back(m->alocacoes);
+    }
+    double media = 0;
+    for(uint64_t a : aloc){
+      media += a;
+    }
+    media /= aloc.size();
+    printf("%-9s %6zu %6zu | %8.1f %8.1f %9.1f | %8.1f %8.1f %9.1f | %7.1f %7" PRIu64 "\n", par.first.c_str(),
+           par.second.size(), virt.size(), percentil(virt, 0.5), percentil(virt, 0.99), percentil(virt, 1.0),
+           percentil(host, 0.5), percentil(host, 0.99), percentil(host, 1.0), media, percentil(aloc, 1.0));
+  }
+
+  double segundosHost = nsTotal / 1e9;
+  const sim::Contadores& c = sim::contadores();
+  printf("\nsaídas:");
+  for(auto& par : saidasPorTipo){
+    printf(" %s=%" PRIu64, nomeSaida(par.first), par.second);
+  }
+  printf("\ntempo virtual: %.1f s; tempo no host: %.3f s (%.0fx); vazão: %.0f eventos/s\n", duracaoUs / 1e6,
+         segundosHost, segundosHost > 0 ? duracaoUs / 1e6 / segundosHost : 0.0,
+         segundosHost > 0 ? medicoes.size() / segundosHost : 0.0);
+  printf("CPU no sketch: %.3f s; trocas de contexto: %" PRIu64 "; alocações: %" PRIu64 " (%" PRIu64
+         " bytes); gravações NVS: %" PRIu64 "; bytes no FS: %" PRIu64 "\n",
+         c.nsEmTarefas / 1e9, c.trocasContexto, c.alocacoes, c.bytesAlocados, c.escritasNvs, c.bytesGravadosFs);
+  printf("\n%-10s %10s %10s %12s %10s\n", "tarefa", "pilha", "usada(host)", "CPU (ms)", "execuções");
+  for(const sim::EstatisticaTarefa& t : sim::estatisticasTarefas()){
+    printf("%-10s %10u %10u %12.2f %10" PRIu64 "\n", t.nome.c_str(), t.pilhaPedida, t.pilhaUsada, t.nsCpu / 1e6,
+           t.execucoes);
+  }
+  if(sim::reiniciou()){
+    printf("\nO firmware reiniciou durante o rastro; a reprodução parou ali.\n");
+  }
+}
+
+bool lerOpcoes(int argc, char** argv, Opcoes& o){
+  for(int i = 1; i < argc; i++){
+    if(strcmp(argv[i], "--repetir") == 0 && i + 1 < argc){
+      o.repeticoes = std::max(1, atoi(argv[++i]));
+    } else if(strcmp(argv[i], "--serial") == 0){
+      sim::parametros().serialVisivel = true;
+    } else if(strcmp(argv[i], "--transcricao") == 0){
+      o.transcricao = true;
+    } else if(strcmp(argv[i], "--sem-wifi") == 0){
+      sim::parametros().wifiDisponivel = false;
+    } else if(argv[i][0] == '-'){
+      return false;
+    } else {
+      o.arquivos.push_back(argv[i]);
+    }
+  }
+  return !o.arquivos.empty();
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+  Opcoes opcoes;
+  if(!lerOpcoes(argc, argv, opcoes)){
+    fprintf(stderr, "uso: %s [--repetir N] [--transcricao] [--serial] [--sem-wifi] rastro.txt...\n", argv[0]);
+    return 2;
+  }
+  std::vector<Rastro> rastros(opcoes.arquivos.size());
+  for(size_t i = 0; i < rastros.size(); i++){
+    if(!carregarRastro(opcoes.arquivos[i], rastros[i])){
+      return 2;
+    }
+  }
+  transcrever = opcoes.transcricao;
+
+  // Os rastros tocam em sequência, cada um a partir do fim do anterior, e o conjunto se
+  // repete: o estado do firmware (armado, logs, NVS) passa de um para o outro.
+  sim::aoProduzirSaida(observarSaida);
+  uint64_t base = 0;
+  for(int rep = 0; rep < opcoes.repeticoes; rep++){
+    for(const Rastro& r : rastros){
+      for(const Evento& e : r.eventos){
+        const Evento* evento = &e;
+        sim::agendar(base + e.instanteUs, [evento]{ injetar(*evento); });
+      }
+      base += r.duracaoUs;
+    }
+  }
+
+  uint64_t inicio = sim::nsHost();
+  sim::iniciar(setup, loop);
+  sim::executarAte(base);
+  uint64_t nsTotal = sim::nsHost() - inicio;
+  fecharMedicaoAtual();
+
+  printf("rastros:");
+  for(const Rastro& r : rastros){
+    printf(" %s", r.nome.c_str());
+  }
+  printf(" (x%d)\n", opcoes.repeticoes);
+  relatorio(nsTotal, sim::agoraUs());
+  fflush(stdout);
+  _Exit(0); // As tarefas simuladas nunca terminam: nada de destrutores globais com elas no meio.
+}
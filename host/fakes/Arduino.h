@@ -0,0 +1,208 @@
+// Fake do núcleo Arduino-ESP32 para a bancada no host.
+//
+// Junto com os outros cabeçalhos desta pasta, forma a camada de abstração do hardware:
+// o sketch é compilado sem mudanças, e cada API do Arduino e do ESP-IDF que ele usa
+// (relógio, GPIO, interrupções, FreeRTOS, LittleFS, NVS, Wi-Fi, Telegram) é atendida
+// por um backend simulado. O relógio é virtual; veja `simulador.h`.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <algorithm>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_err.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "soc/soc.h"
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#if !SIM_LIBC_TEM_STRLCPY
+extern "C" size_t strlcpy(char* destino, const char* origem, size_t tamanho);
+extern "C" size_t strlcat(char* destino, const char* origem, size_t tamanho);
+#endif
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define PROGMEM
+#define F(texto) (texto)
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define PULLUP 0x04
+#define INPUT_PULLUP 0x05
+#define PULLDOWN 0x08
+#define INPUT_PULLDOWN 0x09
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define digitalPinToInterrupt(pino) (((pino) < 40) ? (pino) : -1)
+
+// --- Tempo (virtual) ---
+// 32 bits, como o `unsigned long` do ESP32: as contas com estouro dão o mesmo resultado.
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+void configTime(long fusoS, int horarioVeraoS, const char* servidor1, const char* servidor2 = nullptr,
+                const char* servidor3 = nullptr);
+uint32_t getCpuFrequencyMhz();
+
+// --- GPIO e interrupções ---
+void pinMode(uint8_t pino, uint8_t modo);
+void digitalWrite(uint8_t pino, uint8_t nivel);
+int digitalRead(uint8_t pino);
+void attachInterrupt(uint8_t pino, void (*isr)(void), int modo);
+void attachInterruptArg(uint8_t pino, void (*isr)(void*), void* arg, int modo);
+void detachInterrupt(uint8_t pino);
+
+long random(long limite);
+long random(long minimo, long limite);
+
+// --- String ---
+// Só o que o sketch usa. Como na do Arduino, toda String com conteúdo aloca no heap,
+// e essas alocações aparecem na contagem da bancada.
+class String {
+ public:
+  String() {}
+  String(const char* texto) : s_(texto ? texto : "") {}
+  String(const String& outra) = default;
+  String(String&& outra) = default;
+  explicit String(char c) : s_(1, c) {}
+  explicit String(int valor) : s_(std::to_string(valor)) {}
+  explicit String(unsigned int valor) : s_(std::to_string(valor)) {}
+  explicit String(long valor) : s_(std::to_string(valor)) {}
+  explicit String(unsigned long valor) : s_(std::to_string(valor)) {}
+  String& operator=(const String& outra) = default;
+  String& operator=(String&& outra) = default;
+  String& operator=(const char* texto) { s_ = texto ? texto : ""; return *this; }
+
+  const char* c_str() const { return s_.c_str(); }
+  unsigned int length() const { return (unsigned int)s_.size(); }
+  bool reserve(unsigned int tamanho) { s_.reserve(tamanho); return true; }
+  char operator[](unsigned int i) const { return i < s_.size() ? s_[i] : '\0'; }
+  char charAt(unsigned int i) const { return (*this)[i]; }
+
+  String& operator+=(const String& outra) { s_ += outra.s_; return *this; }
+  String& operator+=(const char* texto) { s_ += texto ? texto : ""; return *this; }
+  String& operator+=(char c) { s_ += c; return *this; }
+  bool concat(const char* texto) { *this += texto; return true; }
+  friend String operator+(String a, const String& b) { a += b; return a; }
+  friend String operator+(String a, const char* b) { a += b; return a; }
+  friend String operator+(const char* a, const String& b) { return String(a) + b; }
+
+  bool operator==(const String& outra) const { return s_ == outra.s_; }
+  bool operator==(const char* texto) const { return s_ == (texto ? texto : ""); }
+  bool operator!=(const String& outra) const { return !(*this == outra); }
+  bool operator!=(const char* texto) const { return !(*this == texto); }
+  bool equals(const String& outra) const { return *this == outra; }
+  bool startsWith(const String& prefixo) const { return s_.compare(0, prefixo.s_.size(), prefixo.s_) == 0; }
+  bool endsWith(const String& sufixo) const {
+    return s_.size() >= sufixo.s_.size() && s_.compare(s_.size() - sufixo.s_.size(), sufixo.s_.size(), sufixo.s_) == 0;
+  }
+
+  int indexOf(char c, unsigned int inicio = 0) const { return posicao(s_.find(c, inicio)); }
+  int indexOf(const char* texto, unsigned int inicio = 0) const { return posicao(s_.find(texto, inicio)); }
+  int indexOf(const String& texto, unsigned int inicio = 0) const { return posicao(s_.find(texto.s_, inicio)); }
+  int lastIndexOf(char c) const { return posicao(s_.rfind(c)); }
+  String substring(unsigned int inicio) const { return inicio < s_.size() ? String(s_.substr(inicio).c_str()) : String(); }
+  String substring(unsigned int inicio, unsigned int fim) const {
+    if(fim > s_.size()) fim = (unsigned int)s_.size();
+    return inicio < fim ? String(s_.substr(inicio, fim - inicio).c_str()) : String();
+  }
+  long toInt() const { return strtol(s_.c_str(), nullptr, 10); }
+  void trim();
+  void toLowerCase();
+
+ private:
+  static int posicao(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+  std::string s_;
+};
+
+// --- Print e Stream ---
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* dados, size_t tamanho);
+  size_t write(const char* texto) { return texto ? write((const uint8_t*)texto, strlen(texto)) : 0; }
+  size_t write(const char* dados, size_t tamanho) { return write((const uint8_t*)dados, tamanho); }
+  virtual void flush() {}
+
+  size_t print(const char* texto) { return write(texto); }
+  size_t print(const String& texto) { return write(texto.c_str(), texto.length()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int valor) { return printf("%d", valor); }
+  size_t print(unsigned int valor) { return printf("%u", valor); }
+  size_t print(long valor) { return printf("%ld", valor); }
+  size_t print(unsigned long valor) { return printf("%lu", valor); }
+  size_t println() { return write("\r\n"); }
+  template<typename T> size_t println(const T& valor) { size_t n = print(valor); return n + println(); }
+  // Como no Arduino-ESP32: até 63 caracteres no buffer da pilha; acima disso, aloca.
+  size_t printf(const char* formato, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  void setTimeout(unsigned long ms) { tempoLimiteMs_ = ms; }
+  size_t readBytes(char* destino, size_t tamanho);
+  size_t readBytes(uint8_t* destino, size_t tamanho) { return readBytes((char*)destino, tamanho); }
+  size_t readBytesUntil(char terminador, char* destino, size_t tamanho);
+  size_t readBytesUntil(char terminador, uint8_t* destino, size_t tamanho) {
+    return readBytesUntil(terminador, (char*)destino, tamanho);
+  }
+
+ protected:
+  unsigned long tempoLimiteMs_ = 1000; // Os fakes nunca esperam por dados: o fim é o fim.
+};
+
+class HardwareSerial : public Stream {
+ public:
+  void begin(unsigned long baud);
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* dados, size_t tamanho) override;
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  int availableForWrite() { return 128; }
+  operator bool() const { return true; }
+};
+extern HardwareSerial Serial;
+
+// --- ESP ---
+class EspClass {
+ public:
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  uint32_t getHeapSize();
+  uint64_t getEfuseMac();
+  uint32_t getCpuFreqMHz() { return getCpuFrequencyMhz(); }
+  [[noreturn]] void restart() { esp_restart(); }
+};
+extern EspClass ESP;
+
+void setup();
+void loop();
@@ -0,0 +1,60 @@
+// Fake do FS do Arduino-ESP32 para a bancada no host: arquivos em memória.
+#pragma once
+#include <memory>
+#include "Arduino.h"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct ArquivoAberto; // Definido em `armazenamento.cpp`.
+
+class File : public Stream {
+ public:
+  File() = default;
+  explicit File(std::shared_ptr<ArquivoAberto> aberto) : aberto_(std::move(aberto)) {}
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* dados, size_t tamanho) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t read(uint8_t* destino, size_t tamanho);
+  size_t readBytes(char* destino, size_t tamanho) { return read((uint8_t*)destino, tamanho); }
+  bool seek(uint32_t posicao, SeekMode modo = SeekSet);
+  size_t position() const;
+  size_t size() const;
+  void flush() override;
+  void close();
+  operator bool() const;
+  const char* path() const;
+  const char* name() const;
+  bool isDirectory() const { return false; }
+
+ private:
+  std::shared_ptr<ArquivoAberto> aberto_;
+};
+
+class FS {
+ public:
+  File open(const char* caminho, const char* modo = "r", bool criar = false);
+  File open(const String& caminho, const char* modo = "r", bool criar = false) {
+    return open(caminho.c_str(), modo, criar);
+  }
+  bool exists(const char* caminho);
+  bool exists(const String& caminho) { return exists(caminho.c_str()); }
+  bool remove(const char* caminho);
+  bool remove(const String& caminho) { return remove(caminho.c_str()); }
+  bool rename(const char* de, const char* para);
+  bool mkdir(const char*) { return true; }
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
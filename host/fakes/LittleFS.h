@@ -0,0 +1,21 @@
+// Fake do LittleFS para a bancada no host: um sistema de arquivos em memória, que só
+// some quando o processo termina (sobrevive a um `esp_restart()` simulado).
+#pragma once
+#include "FS.h"
+
+namespace fs {
+
+class LittleFSFS : public FS {
+ public:
+  bool begin(bool formatarSeFalhar = false, const char* base = "/littlefs", uint8_t maxAbertos = 10,
+             const char* particao = "spiffs");
+  void end() {}
+  bool format();
+  size_t totalBytes();
+  size_t usedBytes();
+};
+
+} // namespace fs
+
+extern fs::LittleFSFS LittleFS;
+using fs::LittleFSFS;
@@ -0,0 +1,32 @@
+// Fake da NVS (Preferences) para a bancada no host: chave-valor em memória.
+#pragma once
+#include "Arduino.h"
+
+class Preferences {
+ public:
+  bool begin(const char* espaco, bool somenteLeitura = false, const char* particao = nullptr);
+  void end();
+  bool clear();
+  bool remove(const char* chave);
+  bool isKey(const char* chave);
+  size_t putBool(const char* chave, bool valor) { return putBytes(chave, &valor, sizeof(valor)); }
+  bool getBool(const char* chave, bool padrao = false) { return ler(chave, padrao); }
+  size_t putUChar(const char* chave, uint8_t valor) { return putBytes(chave, &valor, sizeof(valor)); }
+  uint8_t getUChar(const char* chave, uint8_t padrao = 0) { return ler(chave, padrao); }
+  size_t putUInt(const char* chave, uint32_t valor) { return putBytes(chave, &valor, sizeof(valor)); }
+  uint32_t getUInt(const char* chave, uint32_t padrao = 0) { return ler(chave, padrao); }
+  size_t putInt(const char* chave, int32_t valor) { return putBytes(chave, &valor, sizeof(valor)); }
+  int32_t getInt(const char* chave, int32_t padrao = 0) { return ler(chave, padrao); }
+  size_t putBytes(const char* chave, const void* valor, size_t tamanho);
+  size_t getBytes(const char* chave, void* destino, size_t tamanhoMax);
+  size_t getBytesLength(const char* chave);
+
+ private:
+  template<typename T> T ler(const char* chave, T padrao) {
+    T valor;
+    return getBytesLength(chave) == sizeof(T) && getBytes(chave, &valor, sizeof(T)) == sizeof(T) ? valor : padrao;
+  }
+  std::string espaco_;
+  bool aberto_ = false;
+  bool somenteLeitura_ = false;
+};
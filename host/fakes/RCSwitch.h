@@ -0,0 +1,16 @@
+// Fake do RCSwitch para a bancada no host: os quadros vêm do rastro (`sim::receberRF`).
+#pragma once
+#include "Arduino.h"
+
+class RCSwitch {
+ public:
+  RCSwitch() {}
+  void enableReceive(int interrupcao);
+  void disableReceive();
+  bool available();
+  void resetAvailable();
+  unsigned long getReceivedValue();
+  unsigned int getReceivedBitlength();
+  unsigned int getReceivedDelay();
+  unsigned int getReceivedProtocol();
+};
@@ -0,0 +1,51 @@
+// Fake do UniversalTelegramBot para a bancada no host. Envios e edições viram saídas do
+// simulador (`sim::Saida`); as mensagens recebidas vêm do rastro (`sim::receberTelegram`).
+#pragma once
+#include "Arduino.h"
+#include "WiFi.h"
+
+#define TELEGRAM_HOST "api.telegram.org"
+#define TELEGRAM_SSL_PORT 443
+
+struct TelegramMessage {
+  String text;
+  String chat_id;
+  String chat_title;
+  String from_id;
+  String from_name;
+  String date;
+  String type;
+  int update_id = 0;
+  int message_id = 0;
+};
+
+typedef bool (*MoreDataAvailable)();
+typedef byte (*GetNextByte)();
+typedef byte* (*GetNextBuffer)();
+typedef int (*GetNextBufferLen)();
+
+class UniversalTelegramBot {
+ public:
+  UniversalTelegramBot(const String& token, Client& cliente);
+  bool getMe();
+  int getUpdates(long offset);
+  bool sendMessage(const String& chat_id, const String& texto, const String& parse_mode = "", int message_id = 0);
+  String sendMultipartFormDataToTelegram(const String& comando, const String& campo, const String& arquivo,
+                                         const String& tipo, const String& chat_id, int tamanho,
+                                         MoreDataAvailable temMais, GetNextByte proximoByte,
+                                         GetNextBuffer proximoBloco, GetNextBufferLen tamanhoBloco);
+
+  TelegramMessage messages[1];
+  long last_message_received = 0;
+  int last_sent_message_id = 0;
+  int longPoll = 0;
+  unsigned int waitForResponse = 1500;
+  int maxMessageLength = 1500;
+  String name;
+  String userName;
+
+ private:
+  bool garantirConexao();
+  String token_;
+  Client* cliente_;
+};
@@ -0,0 +1,82 @@
+// Fake do Wi-Fi do Arduino-ESP32 para a bancada no host. A conexão sobe depois de
+// `sim::Parametros::latenciaWiFiMs` e cai quando o rastro desliga a rede.
+#pragma once
+#include "Arduino.h"
+
+typedef enum {
+  WL_NO_SHIELD = 255,
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6,
+} wl_status_t;
+
+typedef enum {
+  ARDUINO_EVENT_WIFI_STA_START = 2,
+  ARDUINO_EVENT_WIFI_STA_STOP,
+  ARDUINO_EVENT_WIFI_STA_CONNECTED,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+  ARDUINO_EVENT_WIFI_STA_AUTHMODE_CHANGE,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP6,
+  ARDUINO_EVENT_WIFI_STA_LOST_IP,
+} arduino_event_id_t;
+
+typedef union {
+  struct { uint8_t reason; } wifi_sta_disconnected;
+} arduino_event_info_t;
+
+#define WIFI_REASON_ASSOC_LEAVE 8
+#define WIFI_REASON_BEACON_TIMEOUT 200
+#define WIFI_REASON_NO_AP_FOUND 201
+
+typedef enum { WIFI_MODE_NULL = 0, WIFI_MODE_STA, WIFI_MODE_AP, WIFI_MODE_APSTA } wifi_mode_t;
+#define WIFI_OFF WIFI_MODE_NULL
+#define WIFI_STA WIFI_MODE_STA
+typedef enum { WIFI_PS_NONE, WIFI_PS_MIN_MODEM, WIFI_PS_MAX_MODEM } wifi_ps_type_t;
+
+typedef void (*WiFiEventSysCb)(arduino_event_id_t evento, arduino_event_info_t info);
+typedef int wifi_event_id_t;
+
+class WiFiClass {
+ public:
+  bool mode(wifi_mode_t modo) { return true; }
+  bool setSleep(bool) { return true; }
+  bool setSleep(wifi_ps_type_t) { return true; }
+  bool setAutoReconnect(bool) { return true; }
+  wl_status_t begin(const char* ssid, const char* senha);
+  bool disconnect(bool desligar = false, bool apagar = false);
+  wl_status_t status();
+  bool isConnected() { return status() == WL_CONNECTED; }
+  int8_t RSSI();
+  wifi_event_id_t onEvent(WiFiEventSysCb callback, arduino_event_id_t evento = (arduino_event_id_t)0);
+};
+extern WiFiClass WiFi;
+
+// Cliente de rede: conecta (bloqueando pela latência simulada) e cai junto com o Wi-Fi.
+class Client : public Stream {
+ public:
+  Client();
+  ~Client() override;
+  virtual int connect(const char* host, uint16_t porta);
+  virtual void stop();
+  virtual uint8_t connected();
+  operator bool() { return connected(); }
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t*, size_t tamanho) override { return tamanho; }
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+
+ protected:
+  virtual uint32_t latenciaConexaoMs();
+
+ private:
+  bool conectado_ = false;
+};
+
+class WiFiClient : public Client {};
@@ -0,0 +1,14 @@
+// Fake do WiFiClientSecure para a bancada no host: o handshake TLS custa
+// `sim::Parametros::latenciaTlsMs` no relógio virtual.
+#pragma once
+#include "WiFi.h"
+
+class WiFiClientSecure : public WiFiClient {
+ public:
+  void setCACert(const char*) {}
+  void setInsecure() {}
+  void setHandshakeTimeout(unsigned long) {}
+
+ protected:
+  uint32_t latenciaConexaoMs() override;
+};
@@ -0,0 +1,397 @@
+// Fakes do armazenamento para a bancada: LittleFS e NVS em memória, e a partição do
+// diário com a semântica da flash NOR. Tudo persiste até o fim do processo.
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "FS.h"
+#include "LittleFS.h"
+#include "Preferences.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "interno.h"
+
+namespace fs {
+
+struct ArquivoAberto {
+  std::string caminho;
+  std::shared_ptr<std::vector<uint8_t>> dados;
+  size_t posicao = 0;
+  bool leitura = false;
+  bool escrita = false;
+  bool anexar = false;
+  bool aberto = true;
+};
+
+} // namespace fs
+
+namespace {
+
+const size_t CAPACIDADE_FS = 0x160000; // Partição `spiffs` do esquema padrão de 4 MB.
+
+std::map<std::string, std::shared_ptr<std::vector<uint8_t>>>& arquivos(){
+  static std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> m;
+  return m;
+}
+
+std::map<std::string, std::map<std::string, std::vector<uint8_t>>>& nvs(){
+  static std::map<std::string, std::map<std::string, std::vector<uint8_t>>> m;
+  return m;
+}
+
+size_t ocupadoFs(){
+  size_t total = 0;
+  for(auto& a : arquivos()){
+    total += a.second->size();
+  }
+  return total;
+}
+
+} // namespace
+
+fs::LittleFSFS LittleFS;
+
+namespace fs {
+
+// =================================================================================
+// --- LITTLEFS ---
+// =================================================================================
+
+bool LittleFSFS::begin(bool, const char*, uint8_t, const char*){
+  return true;
+}
+
+bool LittleFSFS::format(){
+  sim::SemContagem sem;
+  arquivos().clear();
+  return true;
+}
+
+size_t LittleFSFS::totalBytes(){
+  return CAPACIDADE_FS;
+}
+
+size_t LittleFSFS::usedBytes(){
+  return ocupadoFs();
+}
+
+// O objeto aberto (a `FileImpl` do Arduino-ESP32) é alocado a cada `open()` e conta
+// como alocação do sketch; os dados do arquivo, não.
+File FS::open(const char* caminho, const char* modo, bool criar){
+  std::string m = modo != nullptr ? modo : "r";
+  std::shared_ptr<std::vector<uint8_t>> dados;
+  {
+    sim::SemContagem sem;
+    auto it = arquivos().find(caminho);
+    if(it != arquivos().end()){
+      dados = it->second;
+    } else if(m[0] == 'w' || m[0] == 'a' || criar){
+      dados = std::make_shared<std::vector<uint8_t>>();
+      arquivos()[caminho] = dados;
+    } else {
+      return File();
+    }
+    if(m[0] == 'w'){
+      dados->clear();
+    }
+  }
+  auto aberto = std::make_shared<ArquivoAberto>();
+  {
+    sim::SemContagem sem;
+    aberto->caminho = caminho;
+  }
+  aberto->dados = dados;
+  bool mais = m.find('+') != std::string::npos;
+  aberto->leitura = m[0] == 'r' || mais;
+  aberto->escrita = m[0] != 'r' || mais;
+  aberto->anexar = m[0] == 'a';
+  aberto->posicao = aberto->anexar ? dados->size() : 0;
+  return File(aberto);
+}
+
+bool FS::exists(const char* caminho){
+  return arquivos().count(caminho) > 0;
+}
+
+bool FS::remove(const char* caminho){
+  sim::SemContagem sem;
+  return arquivos().erase(caminho) > 0;
+}
+
+bool FS::rename(const char* de, const char* para){
+  sim::SemContagem sem;
+  auto it = arquivos().find(de);
+  if(it == arquivos().end()){
+    return false;
+  }
+  arquivos()[para] = it->second;
+  arquivos().erase(it);
+  return true;
+}
+
+// =================================================================================
+// --- ARQUIVOS ---
+// =================================================================================
+
+File::operator bool() const {
+  return aberto_ != nullptr && aberto_->aberto;
+}
+
+size_t File::write(uint8_t c){
+  return write(&c, 1);
+}
+
+size_t File::write(const uint8_t* dados, size_t tamanho){
+  if(!*this || !aberto_->escrita){
+    return 0;
+  }
+  std::vector<uint8_t>& d = *aberto_->dados;
+  if(aberto_->anexar){
+    aberto_->posicao = d.size(); // "a": toda escrita vai para o fim, como no POSIX.
+  }
+  if(aberto_->posicao + tamanho > d.size() && ocupadoFs() + (aberto_->posicao + tamanho - d.size()) > CAPACIDADE_FS){
+    return 0; // Sistema de arquivos cheio.
+  }
+  sim::SemContagem sem;
+  if(aberto_->posicao + tamanho > d.size()){
+    d.resize(aberto_->posicao + tamanho);
+  }
+  memcpy(d.data() + aberto_->posicao, dados, tamanho);
+  aberto_->posicao += tamanho;
+  sim::contadores().bytesGravadosFs += tamanho;
+  return tamanho;
+}
+
+int File::available(){
+  if(!*this || !aberto_->leitura){
+    return 0;
+  }
+  size_t tamanho = aberto_->dados->size();
+  return aberto_->posicao < tamanho ? (int)(tamanho - aberto_->posicao) : 0;
+}
+
+int File::read(){
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek(){
+  if(available() <= 0){
+    return -1;
+  }
+  return (*aberto_->dados)[aberto_->posicao];
+}
+
+size_t File::read(uint8_t* destino, size_t tamanho){
+  size_t disponivel = (size_t)available();
+  size_t n = tamanho < disponivel ? tamanho : disponivel;
+  if(n > 0){
+    memcpy(destino, aberto_->dados->data() + aberto_->posicao, n);
+    aberto_->posicao += n;
+  }
+  return n;
+}
+
+bool File::seek(uint32_t posicao, SeekMode modo){
+  if(!*this){
+    return false;
+  }
+  size_t base = modo == SeekSet ? 0 : modo == SeekCur ? aberto_->posicao : aberto_->dados->size();
+  size_t destino = base + posicao;
+  if(destino > aberto_->dados->size()){
+    return false;
+  }
+  aberto_->posicao = destino;
+  return true;
+}
+
+size_t File::position() const {
+  return *this ? aberto_->posicao : 0;
+}
+
+size_t File::size() const {
+  return *this ? aberto_->dados->size() : 0;
+}
+
+void File::flush(){}
+
+void File::close(){
+  if(aberto_ != nullptr){
+    aberto_->aberto = false;
+    aberto_.reset();
+  }
+}
+
+const char* File::path() const {
+  return *this ? aberto_->caminho.c_str() : nullptr;
+}
+
+const char* File::name() const {
+  if(!*this){
+    return nullptr;
+  }
+  size_t barra = aberto_->caminho.rfind('/');
+  return aberto_->caminho.c_str() + (barra == std::string::npos ? 0 : barra + 1);
+}
+
+} // namespace fs
+
+// =================================================================================
+// --- NVS (PREFERENCES) ---
+// =================================================================================
+
+bool Preferences::begin(const char* espaco, bool somenteLeitura, const char*){
+  sim::SemContagem sem;
+  espaco_ = espaco;
+  somenteLeitura_ = somenteLeitura;
+  aberto_ = true;
+  return true;
+}
+
+void Preferences::end(){
+  aberto_ = false;
+}
+
+bool Preferences::clear(){
+  if(!aberto_ || somenteLeitura_){
+    return false;
+  }
+  sim::SemContagem sem;
+  nvs()[espaco_].clear();
+  return true;
+}
+
+bool Preferences::remove(const char* chave){
+  if(!aberto_ || somenteLeitura_){
+    return false;
+  }
+  sim::SemContagem sem;
+  return nvs()[espaco_].erase(chave) > 0;
+}
+
+bool Preferences::isKey(const char* chave){
+  return getBytesLength(chave) > 0;
+}
+
+size_t Preferences::putBytes(const char* chave, const void* valor, size_t tamanho){
+  if(!aberto_ || somenteLeitura_){
+    return 0;
+  }
+  sim::SemContagem sem;
+  const uint8_t* b = (const uint8_t*)valor;
+  nvs()[espaco_][chave].assign(b, b + tamanho);
+  sim::contadores().escritasNvs++;
+  return tamanho;
+}
+
+size_t Preferences::getBytesLength(const char* chave){
+  if(!aberto_){
+    return 0;
+  }
+  sim::SemContagem sem;
+  auto& espaco = nvs()[espaco_];
+  auto it = espaco.find(chave);
+  return it != espaco.end() ? it->second.size() : 0;
+}
+
+size_t Preferences::getBytes(const char* chave, void* destino, size_t tamanhoMax){
+  size_t tamanho = getBytesLength(chave);
+  if(tamanho == 0 || tamanho > tamanhoMax){
+    return 0; // Como na NVS: buffer pequeno demais não recebe nada.
+  }
+  sim::SemContagem sem;
+  memcpy(destino, nvs()[espaco_][chave].data(), tamanho);
+  return tamanho;
+}
+
+// =================================================================================
+// --- PARTIÇÃO DO DIÁRIO E CRCS DA ROM ---
+// =================================================================================
+
+namespace {
+
+const uint32_t TAMANHO_PARTICAO = 64 * 1024;
+const uint32_t SETOR_FLASH = 4096;
+
+std::vector<uint8_t>& flashDiario(){
+  static std::vector<uint8_t> f(TAMANHO_PARTICAO, 0xFF);
+  return f;
+}
+
+const esp_partition_t PARTICAO_DIARIO = {ESP_PARTITION_TYPE_DATA, 0x40, 0x3F0000, TAMANHO_PARTICAO, SETOR_FLASH,
+                                         "diario", false};
+
+bool dentro(const esp_partition_t* p, size_t posicao, size_t tamanho){
+  return p == &PARTICAO_DIARIO && posicao <= p->size && tamanho <= p->size - posicao;
+}
+
+} // namespace
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t tipo, esp_partition_subtype_t subtipo, const char*){
+  return tipo == ESP_PARTITION_TYPE_DATA && subtipo == PARTICAO_DIARIO.subtype ? &PARTICAO_DIARIO : nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* particao, size_t posicao, void* destino, size_t tamanho){
+  if(!dentro(particao, posicao, tamanho)){
+    return ESP_ERR_INVALID_SIZE;
+  }
+  memcpy(destino, flashDiario().data() + posicao, tamanho);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* particao, size_t posicao, const void* origem, size_t tamanho){
+  if(!dentro(particao, posicao, tamanho)){
+    return ESP_ERR_INVALID_SIZE;
+  }
+  const uint8_t* b = (const uint8_t*)origem;
+  for(size_t i = 0; i < tamanho; i++){
+    flashDiario()[posicao + i] &= b[i]; // A escrita na NOR só leva bits de 1 para 0.
+  }
+  sim::contadores().bytesGravadosFs += tamanho;
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* particao, size_t posicao, size_t tamanho){
+  if(!dentro(particao, posicao, tamanho) || posicao % SETOR_FLASH != 0 || tamanho % SETOR_FLASH != 0){
+    return ESP_ERR_INVALID_ARG;
+  }
+  memset(flashDiario().data() + posicao, 0xFF, tamanho);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t* particao, size_t posicao, size_t tamanho,
+                             esp_partition_mmap_memory_t, const void** ponteiro,
+                             esp_partition_mmap_handle_t* handle){
+  if(!dentro(particao, posicao, tamanho)){
+    return ESP_ERR_INVALID_SIZE;
+  }
+  *ponteiro = flashDiario().data() + posicao; // O mapa enxerga as escritas na hora.
+  *handle = 1;
+  return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t){}
+
+uint8_t esp_rom_crc8_le(uint8_t crc, uint8_t const* buf, uint32_t len){
+  crc = ~crc;
+  while(len-- > 0){
+    crc ^= *buf++;
+    for(int b = 0; b < 8; b++){
+      crc = crc & 1 ? (crc >> 1) ^ 0x8C : crc >> 1;
+    }
+  }
+  return ~crc;
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const* buf, uint32_t len){
+  crc = ~crc;
+  while(len-- > 0){
+    crc ^= *buf++;
+    for(int b = 0; b < 8; b++){
+      crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+    }
+  }
+  return ~crc;
+}
@@ -0,0 +1,28 @@
+// Fake do ESP-IDF para a bancada no host: uma partição de dados em memória, com a
+// semântica da flash NOR (o apagamento põe 0xFF; a escrita só zera bits).
+#pragma once
+#include <stddef.h>
+#include "esp_err.h"
+
+typedef enum { ESP_PARTITION_TYPE_APP = 0x00, ESP_PARTITION_TYPE_DATA = 0x01 } esp_partition_type_t;
+typedef int esp_partition_subtype_t;
+typedef enum { ESP_PARTITION_MMAP_DATA, ESP_PARTITION_MMAP_INST } esp_partition_mmap_memory_t;
+typedef uint32_t esp_partition_mmap_handle_t;
+typedef struct {
+  esp_partition_type_t type;
+  esp_partition_subtype_t subtype;
+  uint32_t address;
+  uint32_t size;
+  uint32_t erase_size;
+  char label[17];
+  bool encrypted;
+} esp_partition_t;
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t tipo, esp_partition_subtype_t subtipo, const char* rotulo);
+esp_err_t esp_partition_read(const esp_partition_t* particao, size_t posicao, void* destino, size_t tamanho);
+esp_err_t esp_partition_write(const esp_partition_t* particao, size_t posicao, const void* origem, size_t tamanho);
+esp_err_t esp_partition_erase_range(const esp_partition_t* particao, size_t posicao, size_t tamanho);
+esp_err_t esp_partition_mmap(const esp_partition_t* particao, size_t posicao, size_t tamanho,
+                             esp_partition_mmap_memory_t memoria, const void** ponteiro,
+                             esp_partition_mmap_handle_t* handle);
+void esp_partition_munmap(esp_partition_mmap_handle_t handle);
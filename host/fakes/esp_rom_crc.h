@@ -0,0 +1,6 @@
+// Fake do ESP-IDF para a bancada no host: os CRCs da ROM, calculados em software.
+#pragma once
+#include <stdint.h>
+
+uint8_t esp_rom_crc8_le(uint8_t crc, uint8_t const* buf, uint32_t len);
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const* buf, uint32_t len);
@@ -0,0 +1,5 @@
+// Fake do ESP-IDF para a bancada no host: não há sono leve no relógio virtual.
+#pragma once
+#include "esp_err.h"
+
+esp_err_t esp_sleep_enable_gpio_wakeup();
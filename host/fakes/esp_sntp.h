@@ -0,0 +1,6 @@
+// Fake do ESP-IDF para a bancada no host: o "NTP" sincroniza pouco depois do Wi-Fi subir.
+#pragma once
+#include <sys/time.h>
+
+typedef void (*sntp_sync_time_cb_t)(struct timeval* tv);
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback);
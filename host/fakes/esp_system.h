@@ -0,0 +1,10 @@
+// Fake do ESP-IDF para a bancada no host: reinício e tratadores de desligamento.
+#pragma once
+#include "esp_err.h"
+
+typedef void (*shutdown_handler_t)(void);
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t tratador);
+[[noreturn]] void esp_restart();
+uint32_t esp_random();
+uint32_t esp_get_free_heap_size();
+uint32_t esp_get_minimum_free_heap_size();
@@ -0,0 +1,8 @@
+// Fake do ESP-IDF para a bancada no host: o watchdog de tarefas não existe no relógio virtual.
+#pragma once
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+esp_err_t esp_task_wdt_add(TaskHandle_t tarefa);
+esp_err_t esp_task_wdt_delete(TaskHandle_t tarefa);
+esp_err_t esp_task_wdt_reset();
@@ -0,0 +1,21 @@
+// Fake do ESP-IDF para a bancada no host: timers de alta resolução no relógio virtual.
+// Os callbacks rodam no contexto do simulador, como na tarefa `esp_timer` do ESP32.
+#pragma once
+#include "esp_err.h"
+
+typedef struct esp_timer* esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void* arg);
+typedef enum { ESP_TIMER_TASK } esp_timer_dispatch_t;
+typedef struct {
+  esp_timer_cb_t callback;
+  void* arg;
+  esp_timer_dispatch_t dispatch_method;
+  const char* name;
+  bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* criado);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodoUs);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t esperaUs);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+int64_t esp_timer_get_time();
@@ -0,0 +1,15 @@
+// Fake do FreeRTOS para a bancada no host: filas.
+#pragma once
+#include "FreeRTOS.h"
+
+QueueHandle_t xQueueCreate(UBaseType_t capacidade, UBaseType_t tamanhoItem);
+BaseType_t xQueueSend(QueueHandle_t fila, const void* item, TickType_t ticks);
+BaseType_t xQueueSendToBack(QueueHandle_t fila, const void* item, TickType_t ticks);
+BaseType_t xQueueSendToFront(QueueHandle_t fila, const void* item, TickType_t ticks);
+BaseType_t xQueueSendFromISR(QueueHandle_t fila, const void* item, BaseType_t* acordouMaisPrioritaria);
+BaseType_t xQueueReceive(QueueHandle_t fila, void* item, TickType_t ticks);
+BaseType_t xQueuePeek(QueueHandle_t fila, void* item, TickType_t ticks);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t fila);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t fila);
+BaseType_t xQueueReset(QueueHandle_t fila);
+void vQueueDelete(QueueHandle_t fila);
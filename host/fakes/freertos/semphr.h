@@ -0,0 +1,9 @@
+// Fake do FreeRTOS para a bancada no host: semáforos e mutexes (filas sem dados).
+#pragma once
+#include "queue.h"
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaforo, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaforo);
+#define vSemaphoreDelete(semaforo) vQueueDelete(semaforo)
@@ -0,0 +1,16 @@
+// Fake do FreeRTOS para a bancada no host: tarefas e notificações.
+#pragma once
+#include "FreeRTOS.h"
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t funcao, const char* nome, uint32_t pilha, void* parametro,
+                                   UBaseType_t prioridade, TaskHandle_t* criada, BaseType_t nucleo);
+BaseType_t xTaskCreate(TaskFunction_t funcao, const char* nome, uint32_t pilha, void* parametro,
+                       UBaseType_t prioridade, TaskHandle_t* criada);
+void vTaskDelete(TaskHandle_t tarefa);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t tarefa);
+BaseType_t xTaskNotifyGive(TaskHandle_t tarefa);
+void vTaskNotifyGiveFromISR(TaskHandle_t tarefa, BaseType_t* acordouMaisPrioritaria);
+uint32_t ulTaskNotifyTake(BaseType_t zerar, TickType_t ticks);
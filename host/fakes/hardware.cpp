@@ -0,0 +1,377 @@
+// Fakes do hardware para a bancada: GPIO (com os registradores do ESP32), interrupções,
+// decodificador RF, Serial, String, informações do chip e gerência de energia.
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Arduino.h"
+#include "RCSwitch.h"
+#include "driver/gpio.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "soc/gpio_reg.h"
+#include "interno.h"
+
+namespace {
+
+const uint8_t TOTAL_PINOS = 40;
+const uint32_t CAMPO_INT_TYPE = GPIO_PIN0_INT_TYPE_V << GPIO_PIN0_INT_TYPE_S;
+const int MAX_REPETICOES_NIVEL = 16; // Interrupção por nível que a ISR não desarma.
+
+struct Pino {
+  uint8_t modo = 0;
+  uint8_t nivel = LOW;
+  uint32_t registrador = 0; // GPIO_PINn_REG (só o tipo de interrupção é usado).
+  void (*isr)() = nullptr;
+  void (*isrArg)(void*) = nullptr;
+  void* arg = nullptr;
+};
+
+Pino pinos[TOTAL_PINOS];
+
+struct DecodificadorRF {
+  bool habilitado = false;
+  bool disponivel = false;
+  unsigned long valor = 0;
+  unsigned int bits = 0;
+  unsigned int protocolo = 0;
+} decodificador;
+
+uint32_t sementeAleatoria = 0x2545F491;
+
+uint8_t tipoInterrupcao(const Pino& p){
+  return (p.registrador & CAMPO_INT_TYPE) >> GPIO_PIN0_INT_TYPE_S;
+}
+
+bool interrupcaoCasa(uint8_t tipo, uint8_t anterior, uint8_t nivel){
+  switch(tipo){
+    case GPIO_INTR_POSEDGE:    return anterior == LOW && nivel == HIGH;
+    case GPIO_INTR_NEGEDGE:    return anterior == HIGH && nivel == LOW;
+    case GPIO_INTR_ANYEDGE:    return anterior != nivel;
+    case GPIO_INTR_LOW_LEVEL:  return nivel == LOW;
+    case GPIO_INTR_HIGH_LEVEL: return nivel == HIGH;
+    default:                   return false;
+  }
+}
+
+void chamarIsr(Pino& p){
+  sim::executarNoSketch([&p]{
+    if(p.isrArg != nullptr){
+      p.isrArg(p.arg);
+    } else if(p.isr != nullptr){
+      p.isr();
+    }
+  });
+}
+
+/** Avalia a interrupção do pino depois de uma mudança de nível (ou do tipo dela). */
+void avaliarInterrupcao(uint8_t pino, uint8_t anterior){
+  Pino& p = pinos[pino];
+  if(p.isr == nullptr && p.isrArg == nullptr){
+    return;
+  }
+  if(!interrupcaoCasa(tipoInterrupcao(p), anterior, p.nivel)){
+    return;
+  }
+  chamarIsr(p);
+  // Por nível, a interrupção continua ativa enquanto o nível durar (a ISR do sketch a
+  // reprograma para o nível oposto).
+  for(int i = 0; i < MAX_REPETICOES_NIVEL && tipoInterrupcao(p) >= GPIO_INTR_LOW_LEVEL &&
+                 interrupcaoCasa(tipoInterrupcao(p), p.nivel, p.nivel); i++){
+    chamarIsr(p);
+  }
+}
+
+void escreverSaida(uint8_t pino, uint8_t nivel){
+  if(pino >= TOTAL_PINOS || pinos[pino].nivel == nivel){
+    return;
+  }
+  pinos[pino].nivel = nivel;
+  sim::produzirSaida(sim::SAIDA_GPIO, ((uint32_t)pino << 1) | nivel);
+}
+
+void escreverMascara(uint32_t mascara, uint8_t primeiro, uint8_t nivel){
+  for(uint8_t b = 0; b < 32 && primeiro + b < TOTAL_PINOS; b++){
+    if(mascara & (1u << b)){
+      escreverSaida(primeiro + b, nivel);
+    }
+  }
+}
+
+void ligarInterrupcao(uint8_t pino, void (*isr)(), void (*isrArg)(void*), void* arg, int modo){
+  if(pino >= TOTAL_PINOS){
+    return;
+  }
+  Pino& p = pinos[pino];
+  p.isr = isr;
+  p.isrArg = isrArg;
+  p.arg = arg;
+  p.registrador = (p.registrador & ~CAMPO_INT_TYPE) | ((uint32_t)(modo & GPIO_PIN0_INT_TYPE_V) << GPIO_PIN0_INT_TYPE_S);
+}
+
+} // namespace
+
+// =================================================================================
+// --- GPIO E REGISTRADORES ---
+// =================================================================================
+
+namespace sim {
+
+void definirPino(uint8_t pino, uint8_t nivel){
+  if(pino >= TOTAL_PINOS){
+    return;
+  }
+  uint8_t anterior = pinos[pino].nivel;
+  pinos[pino].nivel = nivel ? HIGH : LOW;
+  avaliarInterrupcao(pino, anterior);
+}
+
+uint32_t lerRegistrador(uint32_t endereco){
+  uint32_t valor = 0;
+  if(endereco == GPIO_IN_REG || endereco == GPIO_IN1_REG){
+    uint8_t primeiro = endereco == GPIO_IN_REG ? 0 : 32;
+    for(uint8_t b = 0; b < 32 && primeiro + b < TOTAL_PINOS; b++){
+      valor |= (uint32_t)pinos[primeiro + b].nivel << b;
+    }
+  } else if(endereco >= GPIO_PIN0_REG && endereco < GPIO_PIN0_REG + 4 * TOTAL_PINOS){
+    valor = pinos[(endereco - GPIO_PIN0_REG) / 4].registrador;
+  }
+  return valor;
+}
+
+void escreverRegistrador(uint32_t endereco, uint32_t valor){
+  switch(endereco){
+    case GPIO_OUT_W1TS_REG:  escreverMascara(valor, 0, HIGH); return;
+    case GPIO_OUT_W1TC_REG:  escreverMascara(valor, 0, LOW); return;
+    case GPIO_OUT1_W1TS_REG: escreverMascara(valor, 32, HIGH); return;
+    case GPIO_OUT1_W1TC_REG: escreverMascara(valor, 32, LOW); return;
+    default: break;
+  }
+  if(endereco >= GPIO_PIN0_REG && endereco < GPIO_PIN0_REG + 4 * TOTAL_PINOS){
+    uint8_t pino = (endereco - GPIO_PIN0_REG) / 4;
+    pinos[pino].registrador = valor;
+    // Uma interrupção por nível armada já no nível dispara logo que a ISR atual terminar.
+    if(tipoInterrupcao(pinos[pino]) >= GPIO_INTR_LOW_LEVEL){
+      sim::agendar(sim::agoraUs(), [pino]{ avaliarInterrupcao(pino, pinos[pino].nivel); });
+    }
+  }
+}
+
+void receberRF(uint32_t codigo, uint32_t quadros, uint32_t intervaloUs, uint8_t bits, uint8_t protocolo){
+  for(uint32_t i = 0; i < quadros; i++){
+    // Cada quadro só é decodificado depois de recebido por inteiro.
+    sim::agendar(sim::agoraUs() + (uint64_t)(i + 1) * intervaloUs, [=]{
+      if(!decodificador.habilitado){
+        return;
+      }
+      decodificador.disponivel = true; // Como no RCSwitch, um quadro novo sobrescreve o anterior.
+      decodificador.valor = codigo;
+      decodificador.bits = bits;
+      decodificador.protocolo = protocolo;
+    });
+  }
+}
+
+} // namespace sim
+
+void pinMode(uint8_t pino, uint8_t modo){
+  if(pino >= TOTAL_PINOS){
+    return;
+  }
+  Pino& p = pinos[pino];
+  bool eraConfigurado = p.modo != 0;
+  p.modo = modo;
+  if(!eraConfigurado && (modo & PULLUP) && modo != OUTPUT){
+    p.nivel = HIGH; // Pull-up sem nada ligado: o pino repousa em nível alto.
+  }
+}
+
+void digitalWrite(uint8_t pino, uint8_t nivel){
+  escreverSaida(pino, nivel ? HIGH : LOW);
+}
+
+int digitalRead(uint8_t pino){
+  return pino < TOTAL_PINOS ? pinos[pino].nivel : LOW;
+}
+
+void attachInterrupt(uint8_t pino, void (*isr)(void), int modo){
+  ligarInterrupcao(pino, isr, nullptr, nullptr, modo);
+}
+
+void attachInterruptArg(uint8_t pino, void (*isr)(void*), void* arg, int modo){
+  ligarInterrupcao(pino, nullptr, isr, arg, modo);
+}
+
+void detachInterrupt(uint8_t pino){
+  ligarInterrupcao(pino, nullptr, nullptr, nullptr, GPIO_INTR_DISABLE);
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t pino, gpio_int_type_t tipo){
+  return pino >= 0 && pino < TOTAL_PINOS && tipo >= GPIO_INTR_LOW_LEVEL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+// =================================================================================
+// --- DECODIFICADOR RF ---
+// =================================================================================
+
+void RCSwitch::enableReceive(int){ decodificador.habilitado = true; }
+void RCSwitch::disableReceive(){ decodificador.habilitado = false; }
+bool RCSwitch::available(){ return decodificador.disponivel; }
+void RCSwitch::resetAvailable(){ decodificador.disponivel = false; }
+unsigned long RCSwitch::getReceivedValue(){ return decodificador.valor; }
+unsigned int RCSwitch::getReceivedBitlength(){ return decodificador.bits; }
+unsigned int RCSwitch::getReceivedDelay(){ return 350; }
+unsigned int RCSwitch::getReceivedProtocol(){ return decodificador.protocolo; }
+
+// =================================================================================
+// --- SERIAL, PRINT E STRING ---
+// =================================================================================
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long){}
+
+size_t HardwareSerial::write(uint8_t c){
+  return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* dados, size_t tamanho){
+  if(sim::parametros().serialVisivel){
+    fwrite(dados, 1, tamanho, stdout);
+  }
+  return tamanho;
+}
+
+size_t Print::write(const uint8_t* dados, size_t tamanho){
+  size_t n = 0;
+  while(tamanho-- > 0){
+    n += write(*dados++);
+  }
+  return n;
+}
+
+size_t Print::printf(const char* formato, ...){
+  char local[64];
+  va_list args;
+  va_start(args, formato);
+  int tamanho = vsnprintf(local, sizeof(local), formato, args);
+  va_end(args);
+  if(tamanho < 0){
+    return 0;
+  }
+  if((size_t)tamanho < sizeof(local)){
+    return write((const uint8_t*)local, tamanho);
+  }
+  char* grande = new char[tamanho + 1];
+  va_start(args, formato);
+  vsnprintf(grande, tamanho + 1, formato, args);
+  va_end(args);
+  size_t n = write((const uint8_t*)grande, tamanho);
+  delete[] grande;
+  return n;
+}
+
+size_t Stream::readBytes(char* destino, size_t tamanho){
+  size_t n = 0;
+  while(n < tamanho){
+    int c = read();
+    if(c < 0){
+      break;
+    }
+    destino[n++] = (char)c;
+  }
+  return n;
+}
+
+size_t Stream::readBytesUntil(char terminador, char* destino, size_t tamanho){
+  size_t n = 0;
+  while(n < tamanho){
+    int c = read();
+    if(c < 0 || c == terminador){
+      break;
+    }
+    destino[n++] = (char)c;
+  }
+  return n;
+}
+
+void String::trim(){
+  size_t inicio = 0;
+  while(inicio < s_.size() && isspace((unsigned char)s_[inicio])){
+    inicio++;
+  }
+  size_t fim = s_.size();
+  while(fim > inicio && isspace((unsigned char)s_[fim - 1])){
+    fim--;
+  }
+  s_ = s_.substr(inicio, fim - inicio);
+}
+
+void String::toLowerCase(){
+  for(char& c : s_){
+    c = (char)tolower((unsigned char)c);
+  }
+}
+
+#if !SIM_LIBC_TEM_STRLCPY
+extern "C" size_t strlcpy(char* destino, const char* origem, size_t tamanho){
+  size_t comprimento = strlen(origem);
+  if(tamanho > 0){
+    size_t n = comprimento < tamanho - 1 ? comprimento : tamanho - 1;
+    memcpy(destino, origem, n);
+    destino[n] = '\0';
+  }
+  return comprimento;
+}
+
+extern "C" size_t strlcat(char* destino, const char* origem, size_t tamanho){
+  size_t usado = strnlen(destino, tamanho);
+  if(usado == tamanho){
+    return tamanho + strlen(origem);
+  }
+  return usado + strlcpy(destino + usado, origem, tamanho - usado);
+}
+#endif
+
+// =================================================================================
+// --- CHIP E ENERGIA ---
+// =================================================================================
+
+EspClass ESP;
+
+uint32_t EspClass::getHeapSize(){ return 327680; }
+uint32_t EspClass::getFreeHeap(){ return esp_get_free_heap_size(); }
+uint32_t EspClass::getMinFreeHeap(){ return esp_get_minimum_free_heap_size(); }
+uint32_t EspClass::getMaxAllocHeap(){ return 110580; }
+uint64_t EspClass::getEfuseMac(){ return 0x0000A4CF12F0E1D2ull; }
+
+uint32_t esp_get_free_heap_size(){ return 214000; }
+uint32_t esp_get_minimum_free_heap_size(){ return 196000; }
+
+uint32_t esp_random(){
+  // Xorshift32 com semente fixa: as esperas aleatórias do Wi-Fi se repetem a cada execução.
+  sementeAleatoria ^= sementeAleatoria << 13;
+  sementeAleatoria ^= sementeAleatoria >> 17;
+  sementeAleatoria ^= sementeAleatoria << 5;
+  return sementeAleatoria;
+}
+
+long random(long limite){
+  return limite > 0 ? (long)(esp_random() % (uint32_t)limite) : 0;
+}
+
+long random(long minimo, long limite){
+  return limite > minimo ? minimo + random(limite - minimo) : minimo;
+}
+
+uint32_t getCpuFrequencyMhz(){ return 240; }
+
+esp_err_t esp_pm_configure(const void*){ return ESP_OK; }
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t, int, const char*, esp_pm_lock_handle_t* criada){
+  static int travas = 0;
+  *criada = (esp_pm_lock_handle_t)(uintptr_t)++travas; // Só precisa ser diferente de nullptr.
+  return ESP_OK;
+}
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t){ return ESP_OK; }
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t){ return ESP_OK; }
+esp_err_t esp_sleep_enable_gpio_wakeup(){ return ESP_OK; }
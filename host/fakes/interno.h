@@ -0,0 +1,17 @@
+// Ligações entre os fakes da bancada. Não faz parte da API usada por `bancada.cpp`.
+#pragma once
+#include <stdint.h>
+#include "simulador.h"
+
+namespace sim {
+
+/** Horário Unix a partir de agora, ou 0 para voltar a contar segundos desde o boot. */
+void sincronizarRelogio(uint32_t epochAgora);
+
+/** Conta uma leitura do relógio ou uma consulta sem espera: muitas seguidas cedem a vez. */
+void contarConsulta();
+
+/** Roda os tratadores de `esp_register_shutdown_handler()`, na ordem de registro. */
+void executarTratadoresDesligamento();
+
+} // namespace sim
@@ -0,0 +1,326 @@
+// Fakes da rede para a bancada: Wi-Fi, NTP, conexões TCP/TLS e a API do Telegram.
+// As latências vêm de `sim::Parametros`; toda espera bloqueia só a tarefa que chamou.
+#include <deque>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "WiFi.h"
+#include "WiFiClientSecure.h"
+#include "UniversalTelegramBot.h"
+#include "esp_sntp.h"
+#include "interno.h"
+
+namespace {
+
+const uint32_t LATENCIA_TCP_MS = 20;
+const uint32_t US_POR_BYTE_UPLOAD = 20; // ~50 KB/s de subida.
+const int8_t RSSI_SIMULADO = -58;
+
+struct MensagemRecebida {
+  int updateId;
+  std::string chat;
+  std::string texto;
+};
+
+wl_status_t estadoWiFi = WL_IDLE_STATUS;
+int redeDisponivel = -1; // -1: ainda não lido de `sim::parametros()`.
+uint64_t geracaoWiFi = 0; // Invalida o resultado de uma tentativa substituída.
+bool ntpPedido = false;
+bool ntpSincronizado = false;
+sntp_sync_time_cb_t callbackNtp = nullptr;
+int proximoUpdateId = 1;
+int proximaMensagemId = 1;
+int caixaEntrada; // Só o endereço importa: é o objeto esperado pelo `getUpdates`.
+
+std::vector<WiFiEventSysCb>& callbacksWiFi(){ static std::vector<WiFiEventSysCb> v; return v; }
+std::set<Client*>& clientes(){ static std::set<Client*> s; return s; }
+std::deque<MensagemRecebida>& mensagens(){ static std::deque<MensagemRecebida> d; return d; }
+std::set<int>& mensagensEnviadas(){ static std::set<int> s; return s; }
+
+bool disponivel(){
+  if(redeDisponivel < 0){
+    redeDisponivel = sim::parametros().wifiDisponivel ? 1 : 0;
+  }
+  return redeDisponivel == 1;
+}
+
+void emitirEvento(arduino_event_id_t evento, uint8_t motivo = 0){
+  arduino_event_info_t info = {};
+  info.wifi_sta_disconnected.reason = motivo;
+  sim::executarNoSketch([&]{
+    for(WiFiEventSysCb cb : callbacksWiFi()){
+      cb(evento, info);
+    }
+  });
+}
+
+void agendarNtp(){
+  if(!ntpPedido || ntpSincronizado){
+    return;
+  }
+  uint64_t geracao = geracaoWiFi;
+  sim::agendar(sim::agoraUs() + (uint64_t)sim::parametros().latenciaNtpMs * 1000, [geracao]{
+    if(ntpSincronizado || geracao != geracaoWiFi || estadoWiFi != WL_CONNECTED){
+      return; // A rede caiu antes da resposta: tenta de novo na próxima conexão.
+    }
+    ntpSincronizado = true;
+    sim::sincronizarRelogio(sim::parametros().epochNtp + (uint32_t)(sim::agoraUs() / 1000000));
+    if(callbackNtp != nullptr){
+      timeval tv = {time(nullptr), 0};
+      sim::executarNoSketch([&]{ callbackNtp(&tv); });
+    }
+  });
+}
+
+/** A rede caiu (ou a estação saiu): fecha as conexões e avisa o sketch. */
+void perderConexao(uint8_t motivo){
+  geracaoWiFi++;
+  bool estavaConectado = estadoWiFi == WL_CONNECTED;
+  estadoWiFi = WL_DISCONNECTED;
+  for(Client* c : clientes()){
+    c->stop();
+  }
+  sim::sinalizar(&caixaEntrada); // Um `getUpdates` pendente volta sem nada.
+  if(estavaConectado){
+    emitirEvento(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, motivo);
+  }
+}
+
+} // namespace
+
+// =================================================================================
+// --- WI-FI E NTP ---
+// =================================================================================
+
+WiFiClass WiFi;
+
+wl_status_t WiFiClass::begin(const char*, const char*){
+  uint64_t geracao = ++geracaoWiFi;
+  estadoWiFi = WL_DISCONNECTED;
+  sim::agendar(sim::agoraUs() + (uint64_t)sim::parametros().latenciaWiFiMs * 1000, [geracao]{
+    if(geracao != geracaoWiFi){
+      return;
+    }
+    if(!disponivel()){
+      estadoWiFi = WL_NO_SSID_AVAIL;
+      emitirEvento(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_NO_AP_FOUND);
+      return;
+    }
+    estadoWiFi = WL_CONNECTED;
+    emitirEvento(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+    emitirEvento(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    agendarNtp();
+  });
+  return estadoWiFi;
+}
+
+bool WiFiClass::disconnect(bool, bool){
+  perderConexao(WIFI_REASON_ASSOC_LEAVE);
+  return true;
+}
+
+wl_status_t WiFiClass::status(){
+  sim::contarConsulta();
+  return estadoWiFi;
+}
+
+int8_t WiFiClass::RSSI(){
+  return estadoWiFi == WL_CONNECTED ? RSSI_SIMULADO : 0;
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventSysCb callback, arduino_event_id_t){
+  sim::SemContagem sem;
+  callbacksWiFi().push_back(callback);
+  return (wifi_event_id_t)callbacksWiFi().size();
+}
+
+void configTime(long fusoS, int horarioVeraoS, const char*, const char*, const char*){
+  // Como o Arduino-ESP32: o fuso vira uma variável TZ POSIX (sinal invertido).
+  long total = fusoS + horarioVeraoS;
+  long absoluto = total < 0 ? -total : total;
+  char tz[32];
+  snprintf(tz, sizeof(tz), "UTC%s%ld:%02ld", total > 0 ? "-" : "", absoluto / 3600, absoluto % 3600 / 60);
+  setenv("TZ", tz, 1);
+  tzset();
+  ntpPedido = true;
+  if(estadoWiFi == WL_CONNECTED){
+    agendarNtp();
+  }
+}
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback){
+  callbackNtp = callback;
+}
+
+namespace sim {
+
+void definirWiFi(bool disponivelAgora){
+  disponivel();
+  redeDisponivel = disponivelAgora ? 1 : 0;
+  if(!disponivelAgora && estadoWiFi == WL_CONNECTED){
+    perderConexao(WIFI_REASON_BEACON_TIMEOUT);
+  }
+}
+
+void receberTelegram(const std::string& chat, const std::string& texto){
+  SemContagem sem;
+  mensagens().push_back({proximoUpdateId++, chat, texto});
+  sinalizar(&caixaEntrada);
+}
+
+} // namespace sim
+
+// =================================================================================
+// --- CONEXÕES ---
+// =================================================================================
+
+Client::Client(){
+  sim::SemContagem sem;
+  clientes().insert(this);
+}
+
+Client::~Client(){
+  sim::SemContagem sem;
+  clientes().erase(this);
+}
+
+uint32_t Client::latenciaConexaoMs(){
+  return LATENCIA_TCP_MS;
+}
+
+int Client::connect(const char*, uint16_t){
+  if(estadoWiFi != WL_CONNECTED){
+    return 0;
+  }
+  uint64_t geracao = geracaoWiFi;
+  sim::dormirUs((uint64_t)latenciaConexaoMs() * 1000);
+  conectado_ = geracao == geracaoWiFi && estadoWiFi == WL_CONNECTED;
+  return conectado_ ? 1 : 0;
+}
+
+void Client::stop(){
+  conectado_ = false;
+}
+
+uint8_t Client::connected(){
+  return conectado_ ? 1 : 0;
+}
+
+uint32_t WiFiClientSecure::latenciaConexaoMs(){
+  return LATENCIA_TCP_MS + sim::parametros().latenciaTlsMs;
+}
+
+// =================================================================================
+// --- TELEGRAM ---
+// =================================================================================
+
+UniversalTelegramBot::UniversalTelegramBot(const String& token, Client& cliente)
+  : token_(token), cliente_(&cliente) {}
+
+bool UniversalTelegramBot::garantirConexao(){
+  return cliente_->connected() || cliente_->connect(TELEGRAM_HOST, TELEGRAM_SSL_PORT);
+}
+
+bool UniversalTelegramBot::getMe(){
+  if(!garantirConexao()){
+    return false;
+  }
+  sim::dormirUs((uint64_t)sim::parametros().latenciaEnvioMs * 1000);
+  return cliente_->connected();
+}
+
+int UniversalTelegramBot::getUpdates(long offset){
+  if(!garantirConexao()){
+    return 0;
+  }
+  uint64_t metadeIdaVolta = (uint64_t)sim::parametros().latenciaEnvioMs * 500;
+  sim::dormirUs(metadeIdaVolta);
+  // Long polling: o servidor segura a resposta até chegar uma mensagem ou vencer o prazo.
+  uint64_t prazo = sim::agoraUs() + (uint64_t)longPoll * 1000000;
+  while(cliente_->connected() && mensagens().empty() && sim::esperarSinal(&caixaEntrada, prazo)){
+  }
+  sim::dormirUs(metadeIdaVolta);
+  if(!cliente_->connected()){
+    return 0;
+  }
+  while(!mensagens().empty() && mensagens().front().updateId < offset){
+    sim::SemContagem sem;
+    mensagens().pop_front(); // Já confirmada pelo offset.
+  }
+  if(mensagens().empty()){
+    return 0;
+  }
+  MensagemRecebida m;
+  {
+    sim::SemContagem sem;
+    m = mensagens().front();
+    mensagens().pop_front();
+  }
+  TelegramMessage& t = messages[0];
+  t.update_id = m.updateId;
+  t.message_id = m.updateId;
+  t.chat_id = m.chat.c_str();
+  t.text = m.texto.c_str();
+  t.from_name = "Bancada";
+  t.type = "message";
+  last_message_received = m.updateId;
+  return 1;
+}
+
+bool UniversalTelegramBot::sendMessage(const String& chat_id, const String& texto, const String& parse_mode, int message_id){
+  if(!garantirConexao()){
+    return false;
+  }
+  sim::dormirUs((uint64_t)sim::parametros().latenciaEnvioMs * 1000);
+  if(!cliente_->connected()){
+    return false; // A rede caiu no meio da chamada.
+  }
+  if(message_id != 0){
+    if(mensagensEnviadas().count(message_id) == 0){
+      return false; // "message to edit not found"
+    }
+    last_sent_message_id = message_id;
+    sim::produzirSaida(sim::SAIDA_EDICAO, (uint32_t)message_id, texto.c_str());
+    return true;
+  }
+  last_sent_message_id = proximaMensagemId++;
+  {
+    sim::SemContagem sem;
+    mensagensEnviadas().insert(last_sent_message_id);
+  }
+  sim::produzirSaida(sim::SAIDA_TELEGRAM, (uint32_t)last_sent_message_id, texto.c_str());
+  return true;
+}
+
+String UniversalTelegramBot::sendMultipartFormDataToTelegram(const String&, const String&, const String& arquivo,
+                                                             const String&, const String&, int,
+                                                             MoreDataAvailable temMais, GetNextByte proximoByte,
+                                                             GetNextBuffer proximoBloco, GetNextBufferLen tamanhoBloco){
+  if(!garantirConexao()){
+    return String();
+  }
+  uint32_t enviados = 0;
+  while(temMais()){
+    uint32_t n;
+    if(proximoBloco != nullptr){
+      proximoBloco(); // Como na biblioteca: o bloco primeiro, o tamanho depois.
+      n = (uint32_t)tamanhoBloco();
+    } else {
+      proximoByte();
+      n = 1;
+    }
+    enviados += n;
+    sim::dormirUs((uint64_t)n * US_POR_BYTE_UPLOAD);
+    if(!cliente_->connected()){
+      return String();
+    }
+  }
+  sim::dormirUs((uint64_t)sim::parametros().latenciaEnvioMs * 1000);
+  if(!cliente_->connected()){
+    return String();
+  }
+  sim::produzirSaida(sim::SAIDA_DOCUMENTO, enviados, arquivo.c_str());
+  return String("{\"ok\":true,\"result\":{}}");
+}
@@ -0,0 +1,765 @@
+// Simulador da bancada: relógio virtual, agenda de eventos e escalonador cooperativo
+// das tarefas do FreeRTOS (cada tarefa numa pilha própria, trocada com `ucontext`).
+//
+// Um só núcleo virtual. A tarefa escolhida é a pronta de maior prioridade (empate: a que
+// rodou há mais tempo) e roda até bloquear; o relógio só avança quando ninguém está pronto,
+// direto para o próximo prazo (da agenda ou de uma tarefa). Uma tarefa que consulta o
+// relógio ou as filas sem nunca bloquear cede a vez por `QUANTUM_US` a cada
+// `CONSULTAS_POR_QUANTUM` consultas, e o tempo anda também nas esperas ativas.
+#include <ucontext.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "esp_timer.h"
+#include "esp_task_wdt.h"
+#include "interno.h"
+
+// =================================================================================
+// --- ESTADO DO SIMULADOR ---
+// =================================================================================
+
+struct tskTaskControlBlock {
+  std::string nome;
+  uint32_t pilhaPedida;
+  UBaseType_t prioridade;
+  TaskFunction_t funcao;
+  void* parametro;
+  ucontext_t contexto;
+  uint8_t* mapa;           // Região do mmap, com a página de guarda no início.
+  size_t tamanhoMapa;
+  uint8_t* pilha;          // Início utilizável (logo acima da guarda).
+  size_t tamanhoPilha;
+  bool terminada = false;
+  bool bloqueada = false;
+  const void* esperando = nullptr; // Objeto de `sinalizar()`; nullptr para só o prazo.
+  uint64_t prazoUs = 0;
+  uint32_t notificacao = 0;
+  int semContagem = 0;
+  uint32_t consultas = 0;
+  uint64_t ultimaVez = 0;
+  uint64_t nsCpu = 0;
+  uint64_t execucoes = 0;
+};
+
+struct QueueDefinition {
+  UBaseType_t capacidade;
+  UBaseType_t tamanhoItem;
+  std::vector<uint8_t> dados;
+  UBaseType_t inicio = 0;
+  UBaseType_t quantidade = 0;
+  bool mutex = false;
+  TaskHandle_t dono = nullptr;
+  uint8_t espaco = 0; // Só o endereço importa: é o objeto esperado por quem envia.
+};
+
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void* arg;
+  const char* nome;
+  uint64_t periodoUs = 0;
+  uint64_t geracao = 0;
+  bool ativo = false;
+};
+
+namespace {
+
+const uint64_t QUANTUM_US = 10;
+const uint32_t CONSULTAS_POR_QUANTUM = 64;
+const uint8_t PINTURA_PILHA = 0xA5;
+const uint64_t PARA_SEMPRE = UINT64_MAX;
+
+uint64_t relogioUs = 0;
+bool contagemLigada = false;
+int semContagemPrincipal = 0; // O contexto do simulador só conta dentro de `executarNoSketch()`.
+bool dentroDoSketch = false;
+bool reinicioPedido = false;
+uint64_t sequencia = 0;
+uint32_t epochNoBoot = 0; // Epoch Unix no instante virtual 0, depois do "NTP".
+TaskHandle_t corrente = nullptr;
+ucontext_t contextoPrincipal;
+
+// Os contêineres do simulador são criados na primeira chamada, já fora da contagem.
+std::vector<TaskHandle_t>& tarefas(){ static std::vector<TaskHandle_t> v; return v; }
+std::multimap<uint64_t, std::function<void()>>& agenda(){ static std::multimap<uint64_t, std::function<void()>> m; return m; }
+std::vector<std::function<void(const sim::Saida&)>>& observadores(){ static std::vector<std::function<void(const sim::Saida&)>> v; return v; }
+std::vector<shutdown_handler_t>& tratadoresDesligamento(){ static std::vector<shutdown_handler_t> v; return v; }
+
+int* semContagemAtual(){
+  return corrente != nullptr ? &corrente->semContagem : &semContagemPrincipal;
+}
+
+void contarAlocacao(size_t tamanho){
+  if(contagemLigada && (corrente != nullptr || dentroDoSketch) && *semContagemAtual() == 0){
+    sim::contadores().alocacoes++;
+    sim::contadores().bytesAlocados += tamanho;
+  }
+}
+
+void voltarAoSimulador(){
+  swapcontext(&corrente->contexto, &contextoPrincipal);
+}
+
+/** Bloqueia a tarefa atual até `sinalizar(objeto)` ou até o prazo. */
+void bloquear(const void* objeto, uint64_t prazoUs){
+  corrente->bloqueada = true;
+  corrente->esperando = objeto;
+  corrente->prazoUs = prazoUs;
+  voltarAoSimulador();
+}
+
+void ceder(){
+  if(corrente != nullptr){
+    bloquear(nullptr, relogioUs + QUANTUM_US);
+  }
+}
+
+/**
+ * Tenta `tentar()`; sem sucesso, espera por `objeto` até o prazo de `ticks`. Fora de uma
+ * tarefa (ISR, timer) nunca bloqueia, como as variantes `FromISR` do FreeRTOS.
+ */
+template<typename F> bool esperar(const void* objeto, TickType_t ticks, F tentar){
+  if(tentar()){
+    return true;
+  }
+  if(corrente == nullptr){
+    return false;
+  }
+  if(ticks == 0){
+    sim::contarConsulta();
+    return false;
+  }
+  uint64_t prazo = ticks == portMAX_DELAY ? PARA_SEMPRE : relogioUs + (uint64_t)ticks * 1000;
+  for(;;){
+    bloquear(objeto, prazo);
+    if(tentar()){
+      return true;
+    }
+    if(relogioUs >= prazo){
+      return false;
+    }
+  }
+}
+
+void entradaTarefa(){
+  TaskHandle_t t = corrente;
+  t->funcao(t->parametro);
+  t->terminada = true; // Uma tarefa do FreeRTOS não deve retornar; aqui, só termina.
+  voltarAoSimulador();
+}
+
+TaskHandle_t escolherTarefa(){
+  TaskHandle_t escolhida = nullptr;
+  for(TaskHandle_t t : tarefas()){
+    if(t->terminada || (t->bloqueada && t->prazoUs > relogioUs)){
+      continue;
+    }
+    if(escolhida == nullptr || t->prioridade > escolhida->prioridade ||
+       (t->prioridade == escolhida->prioridade && t->ultimaVez < escolhida->ultimaVez)){
+      escolhida = t;
+    }
+  }
+  return escolhida;
+}
+
+void rodar(TaskHandle_t t){
+  t->bloqueada = false;
+  t->esperando = nullptr;
+  t->consultas = 0;
+  t->ultimaVez = ++sequencia;
+  t->execucoes++;
+  corrente = t;
+  uint64_t inicio = sim::nsHost();
+  swapcontext(&contextoPrincipal, &t->contexto);
+  uint64_t duracao = sim::nsHost() - inicio;
+  corrente = nullptr;
+  t->nsCpu += duracao;
+  sim::contadores().nsEmTarefas += duracao;
+  sim::contadores().trocasContexto++;
+  if(t->terminada && t->mapa != nullptr){
+    munmap(t->mapa, t->tamanhoMapa);
+    t->mapa = nullptr;
+  }
+}
+
+uint64_t proximoPrazo(){
+  uint64_t proximo = agenda().empty() ? PARA_SEMPRE : agenda().begin()->first;
+  for(TaskHandle_t t : tarefas()){
+    if(!t->terminada && t->bloqueada && t->prazoUs < proximo){
+      proximo = t->prazoUs;
+    }
+  }
+  return proximo;
+}
+
+size_t pilhaUsada(TaskHandle_t t){
+  if(t->mapa == nullptr){
+    return 0;
+  }
+  size_t intocado = 0;
+  while(intocado < t->tamanhoPilha && t->pilha[intocado] == PINTURA_PILHA){
+    intocado++;
+  }
+  return t->tamanhoPilha - intocado;
+}
+
+void dispararTimer(esp_timer_handle_t timer, uint64_t geracao){
+  if(!timer->ativo || timer->geracao != geracao){
+    return; // Parado ou reprogramado depois deste agendamento.
+  }
+  if(timer->periodoUs > 0){
+    sim::agendar(relogioUs + timer->periodoUs, [timer, geracao]{ dispararTimer(timer, geracao); });
+  } else {
+    timer->ativo = false;
+  }
+  sim::executarNoSketch([timer]{ timer->callback(timer->arg); });
+}
+
+} // namespace
+
+// =================================================================================
+// --- API DA BANCADA ---
+// =================================================================================
+
+namespace sim {
+
+uint64_t agoraUs(){
+  return relogioUs;
+}
+
+uint64_t nsHost(){
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+Parametros& parametros(){
+  static Parametros p;
+  return p;
+}
+
+Contadores& contadores(){
+  static Contadores c;
+  return c;
+}
+
+void agendar(uint64_t instanteUs, std::function<void()> acao){
+  SemContagem sem;
+  agenda().emplace(instanteUs < relogioUs ? relogioUs : instanteUs, std::move(acao));
+}
+
+void iniciar(void (*setup)(), void (*loop)()){
+  setenv("TZ", "UTC0", 1); // O fuso vem do `configTime()` do sketch, não do host.
+  tzset();
+  static void (*fSetup)() = setup;
+  static void (*fLoop)() = loop;
+  fSetup = setup;
+  fLoop = loop;
+  contagemLigada = true;
+  xTaskCreatePinnedToCore([](void*){
+    fSetup();
+    for(;;){
+      fLoop();
+    }
+  }, "loopTask", 8192, nullptr, 1, nullptr, 1);
+}
+
+void executarAte(uint64_t instanteUs){
+  while(!reinicioPedido){
+    while(!agenda().empty() && agenda().begin()->first <= relogioUs){
+      std::function<void()> acao;
+      {
+        SemContagem sem;
+        acao = std::move(agenda().begin()->second);
+        agenda().erase(agenda().begin());
+      }
+      acao();
+      if(reinicioPedido){
+        return;
+      }
+    }
+    TaskHandle_t t = escolherTarefa();
+    if(t != nullptr){
+      rodar(t);
+      continue;
+    }
+    uint64_t proximo = proximoPrazo();
+    if(proximo > instanteUs){
+      if(relogioUs < instanteUs){
+        relogioUs = instanteUs;
+      }
+      return;
+    }
+    relogioUs = proximo;
+  }
+}
+
+bool reiniciou(){
+  return reinicioPedido;
+}
+
+void aoProduzirSaida(std::function<void(const Saida&)> observador){
+  SemContagem sem;
+  observadores().push_back(std::move(observador));
+}
+
+void produzirSaida(TipoSaida tipo, uint32_t valor, const std::string& texto){
+  SemContagem sem;
+  Saida s{tipo, relogioUs, valor, texto};
+  for(auto& o : observadores()){
+    o(s);
+  }
+}
+
+std::vector<EstatisticaTarefa> estatisticasTarefas(){
+  SemContagem sem;
+  std::vector<EstatisticaTarefa> v;
+  for(TaskHandle_t t : tarefas()){
+    v.push_back({t->nome, t->pilhaPedida, (uint32_t)pilhaUsada(t), t->nsCpu, t->execucoes});
+  }
+  return v;
+}
+
+SemContagem::SemContagem(){
+  (*semContagemAtual())++;
+}
+
+SemContagem::~SemContagem(){
+  (*semContagemAtual())--;
+}
+
+void dormirUs(uint64_t duracaoUs){
+  if(corrente == nullptr){
+    relogioUs += duracaoUs; // Fora das tarefas (não deveria acontecer): só avança o relógio.
+    return;
+  }
+  uint64_t prazo = relogioUs + duracaoUs;
+  while(relogioUs < prazo){
+    bloquear(nullptr, prazo);
+  }
+}
+
+bool esperarSinal(const void* objeto, uint64_t prazoUs){
+  if(corrente == nullptr || relogioUs >= prazoUs){
+    return false;
+  }
+  bloquear(objeto, prazoUs);
+  return relogioUs < prazoUs;
+}
+
+void sinalizar(const void* objeto){
+  for(TaskHandle_t t : tarefas()){
+    if(t->bloqueada && objeto != nullptr && t->esperando == objeto){
+      t->bloqueada = false;
+    }
+  }
+}
+
+void executarNoSketch(const std::function<void()>& acao){
+  if(corrente != nullptr || dentroDoSketch){
+    acao();
+    return;
+  }
+  dentroDoSketch = true;
+  uint64_t inicio = nsHost();
+  acao();
+  contadores().nsEmTarefas += nsHost() - inicio;
+  dentroDoSketch = false;
+}
+
+void contarConsulta(){
+  if(corrente != nullptr && ++corrente->consultas >= CONSULTAS_POR_QUANTUM){
+    ceder();
+  }
+}
+
+void sincronizarRelogio(uint32_t epochAgora){
+  epochNoBoot = epochAgora == 0 ? 0 : epochAgora - (uint32_t)(relogioUs / 1000000);
+}
+
+void executarTratadoresDesligamento(){
+  for(shutdown_handler_t h : tratadoresDesligamento()){
+    h();
+  }
+}
+
+} // namespace sim
+
+// =================================================================================
+// --- CONTAGEM DE ALOCAÇÕES ---
+// =================================================================================
+
+void* operator new(size_t tamanho){
+  contarAlocacao(tamanho);
+  void* p = malloc(tamanho != 0 ? tamanho : 1);
+  if(p == nullptr){
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void* operator new[](size_t tamanho){
+  return operator new(tamanho);
+}
+
+void* operator new(size_t tamanho, const std::nothrow_t&) noexcept {
+  contarAlocacao(tamanho);
+  return malloc(tamanho != 0 ? tamanho : 1);
+}
+
+void* operator new[](size_t tamanho, const std::nothrow_t& nt) noexcept {
+  return operator new(tamanho, nt);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// =================================================================================
+// --- RELÓGIO ---
+// =================================================================================
+
+uint32_t micros(){
+  sim::contarConsulta();
+  return (uint32_t)relogioUs;
+}
+
+uint32_t millis(){
+  sim::contarConsulta();
+  return (uint32_t)(relogioUs / 1000);
+}
+
+void delay(uint32_t ms){
+  vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+void delayMicroseconds(uint32_t us){
+  relogioUs += us; // Espera ativa: o tempo passa sem ceder a vez.
+}
+
+void yield(){
+  ceder();
+}
+
+int64_t esp_timer_get_time(){
+  sim::contarConsulta();
+  return (int64_t)relogioUs;
+}
+
+// Antes do NTP, como no ESP32, o relógio conta segundos desde o boot.
+extern "C" time_t time(time_t* destino) noexcept {
+  time_t agora = (time_t)(epochNoBoot + relogioUs / 1000000);
+  if(destino != nullptr){
+    *destino = agora;
+  }
+  return agora;
+}
+
+// =================================================================================
+// --- FREERTOS: TAREFAS E NOTIFICAÇÕES ---
+// =================================================================================
+
+BaseType_t xPortGetCoreID(){
+  return corrente != nullptr && corrente->nome == "loopTask" ? 1 : 0;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t funcao, const char* nome, uint32_t pilha, void* parametro,
+                                   UBaseType_t prioridade, TaskHandle_t* criada, BaseType_t nucleo){
+  sim::SemContagem sem;
+  TaskHandle_t t = new tskTaskControlBlock();
+  t->nome = nome;
+  t->pilhaPedida = pilha;
+  t->prioridade = prioridade;
+  t->funcao = funcao;
+  t->parametro = parametro;
+  size_t pagina = (size_t)sysconf(_SC_PAGESIZE);
+  t->tamanhoPilha = ((size_t)std::max<uint32_t>(pilha * 4, sim::parametros().pilhaMinimaBytes) + pagina - 1) / pagina * pagina;
+  t->tamanhoMapa = t->tamanhoPilha + pagina;
+  void* mapa = mmap(nullptr, t->tamanhoMapa, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(mapa == MAP_FAILED){
+    delete t;
+    return pdFAIL;
+  }
+  t->mapa = (uint8_t*)mapa;
+  mprotect(t->mapa, pagina, PROT_NONE); // Estouro da pilha vira SIGSEGV, não corrupção.
+  t->pilha = t->mapa + pagina;
+  memset(t->pilha, PINTURA_PILHA, t->tamanhoPilha);
+  getcontext(&t->contexto);
+  t->contexto.uc_stack.ss_sp = t->pilha;
+  t->contexto.uc_stack.ss_size = t->tamanhoPilha;
+  t->contexto.uc_link = nullptr;
+  makecontext(&t->contexto, entradaTarefa, 0);
+  t->ultimaVez = ++sequencia;
+  tarefas().push_back(t);
+  if(criada != nullptr){
+    *criada = t;
+  }
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t funcao, const char* nome, uint32_t pilha, void* parametro,
+                       UBaseType_t prioridade, TaskHandle_t* criada){
+  return xTaskCreatePinnedToCore(funcao, nome, pilha, parametro, prioridade, criada, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t tarefa){
+  TaskHandle_t t = tarefa != nullptr ? tarefa : corrente;
+  t->terminada = true;
+  if(t == corrente){
+    voltarAoSimulador(); // Nunca volta: a pilha é liberada pelo simulador.
+  }
+}
+
+void vTaskDelay(TickType_t ticks){
+  if(ticks == 0){
+    ceder();
+    return;
+  }
+  sim::dormirUs((uint64_t)ticks * 1000);
+}
+
+TickType_t xTaskGetTickCount(){
+  sim::contarConsulta();
+  return (TickType_t)(relogioUs / 1000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(){
+  return corrente;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t tarefa){
+  TaskHandle_t t = tarefa != nullptr ? tarefa : corrente;
+  if(t == nullptr || t->tamanhoPilha == 0){
+    return 0;
+  }
+  // A pilha do host é maior que a pedida: a folga é devolvida na mesma proporção.
+  size_t livre = t->tamanhoPilha - pilhaUsada(t);
+  return (UBaseType_t)((uint64_t)t->pilhaPedida * livre / t->tamanhoPilha);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t tarefa){
+  tarefa->notificacao++;
+  sim::sinalizar(tarefa);
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t tarefa, BaseType_t* acordouMaisPrioritaria){
+  xTaskNotifyGive(tarefa);
+  if(acordouMaisPrioritaria != nullptr){
+    *acordouMaisPrioritaria = pdFALSE; // Sem preempção: a tarefa roda quando a ISR terminar.
+  }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t zerar, TickType_t ticks){
+  TaskHandle_t t = corrente;
+  esperar(t, ticks, [t]{ return t->notificacao > 0; });
+  uint32_t valor = t->notificacao;
+  if(valor > 0){
+    t->notificacao = zerar ? 0 : valor - 1;
+  }
+  return valor;
+}
+
+// =================================================================================
+// --- FREERTOS: FILAS E SEMÁFOROS ---
+// =================================================================================
+
+QueueHandle_t xQueueCreate(UBaseType_t capacidade, UBaseType_t tamanhoItem){
+  QueueHandle_t f = new QueueDefinition(); // Conta: no ESP32, a fila também sai do heap.
+  f->capacidade = capacidade;
+  f->tamanhoItem = tamanhoItem;
+  sim::SemContagem sem;
+  f->dados.resize((size_t)capacidade * tamanhoItem);
+  return f;
+}
+
+void vQueueDelete(QueueHandle_t fila){
+  delete fila;
+}
+
+namespace {
+
+bool colocar(QueueHandle_t f, const void* item, bool naFrente){
+  if(f->quantidade >= f->capacidade){
+    return false;
+  }
+  UBaseType_t posicao;
+  if(naFrente){
+    f->inicio = (f->inicio + f->capacidade - 1) % f->capacidade;
+    posicao = f->inicio;
+  } else {
+    posicao = (f->inicio + f->quantidade) % f->capacidade;
+  }
+  if(f->tamanhoItem > 0){
+    memcpy(&f->dados[(size_t)posicao * f->tamanhoItem], item, f->tamanhoItem);
+  }
+  f->quantidade++;
+  sim::sinalizar(f);
+  return true;
+}
+
+bool retirar(QueueHandle_t f, void* item, bool remover){
+  if(f->quantidade == 0){
+    return false;
+  }
+  if(f->tamanhoItem > 0 && item != nullptr){
+    memcpy(item, &f->dados[(size_t)f->inicio * f->tamanhoItem], f->tamanhoItem);
+  }
+  if(remover){
+    f->inicio = (f->inicio + 1) % f->capacidade;
+    f->quantidade--;
+    sim::sinalizar(&f->espaco);
+  }
+  return true;
+}
+
+BaseType_t enviar(QueueHandle_t f, const void* item, TickType_t ticks, bool naFrente){
+  return esperar(&f->espaco, ticks, [=]{ return colocar(f, item, naFrente); }) ? pdTRUE : errQUEUE_FULL;
+}
+
+} // namespace
+
+BaseType_t xQueueSend(QueueHandle_t fila, const void* item, TickType_t ticks){
+  return enviar(fila, item, ticks, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t fila, const void* item, TickType_t ticks){
+  return enviar(fila, item, ticks, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t fila, const void* item, TickType_t ticks){
+  return enviar(fila, item, ticks, true);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t fila, const void* item, BaseType_t* acordouMaisPrioritaria){
+  if(acordouMaisPrioritaria != nullptr){
+    *acordouMaisPrioritaria = pdFALSE;
+  }
+  return colocar(fila, item, false) ? pdTRUE : errQUEUE_FULL;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t fila, void* item, TickType_t ticks){
+  return esperar(fila, ticks, [=]{ return retirar(fila, item, true); }) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xQueuePeek(QueueHandle_t fila, void* item, TickType_t ticks){
+  return esperar(fila, ticks, [=]{ return retirar(fila, item, false); }) ? pdTRUE : pdFALSE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t fila){
+  return fila->quantidade;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t fila){
+  return fila->capacidade - fila->quantidade;
+}
+
+BaseType_t xQueueReset(QueueHandle_t fila){
+  fila->inicio = 0;
+  fila->quantidade = 0;
+  sim::sinalizar(&fila->espaco);
+  return pdPASS;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(){
+  return xQueueCreate(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(){
+  SemaphoreHandle_t s = xQueueCreate(1, 0);
+  s->mutex = true;
+  s->quantidade = 1; // O mutex nasce livre.
+  return s;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaforo, TickType_t ticks){
+  bool ok = esperar(semaforo, ticks, [=]{ return retirar(semaforo, nullptr, true); });
+  if(ok && semaforo->mutex){
+    semaforo->dono = corrente;
+  }
+  return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaforo){
+  if(semaforo->mutex){
+    if(semaforo->dono != corrente){
+      return pdFALSE; // Como no FreeRTOS: só o dono devolve o mutex.
+    }
+    semaforo->dono = nullptr;
+  }
+  return colocar(semaforo, nullptr, false) ? pdTRUE : pdFALSE;
+}
+
+// =================================================================================
+// --- ESP_TIMER, REINÍCIO E WATCHDOG ---
+// =================================================================================
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* criado){
+  esp_timer_handle_t t = new esp_timer();
+  t->callback = args->callback;
+  t->arg = args->arg;
+  t->nome = args->name;
+  *criado = t;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodoUs){
+  if(timer->ativo){
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->periodoUs = periodoUs;
+  timer->ativo = true;
+  uint64_t geracao = ++timer->geracao;
+  sim::agendar(relogioUs + periodoUs, [timer, geracao]{ dispararTimer(timer, geracao); });
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t esperaUs){
+  if(timer->ativo){
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->periodoUs = 0;
+  timer->ativo = true;
+  uint64_t geracao = ++timer->geracao;
+  sim::agendar(relogioUs + esperaUs, [timer, geracao]{ dispararTimer(timer, geracao); });
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer){
+  if(!timer->ativo){
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->ativo = false;
+  return ESP_OK;
+}
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t tratador){
+  sim::SemContagem sem;
+  tratadoresDesligamento().push_back(tratador);
+  return ESP_OK;
+}
+
+void esp_restart(){
+  sim::executarTratadoresDesligamento();
+  sim::produzirSaida(sim::SAIDA_REINICIO, 0);
+  reinicioPedido = true;
+  if(corrente == nullptr){
+    exit(0);
+  }
+  for(;;){
+    corrente->terminada = true;
+    voltarAoSimulador(); // O simulador para; esta pilha nunca mais roda.
+  }
+}
+
+esp_err_t esp_task_wdt_add(TaskHandle_t){ return ESP_OK; }
+esp_err_t esp_task_wdt_delete(TaskHandle_t){ return ESP_OK; }
+esp_err_t esp_task_wdt_reset(){ return ESP_OK; }
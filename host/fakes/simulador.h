@@ -0,0 +1,127 @@
+// Simulador da bancada no host: relógio virtual, escalonador das tarefas do FreeRTOS,
+// injeção de eventos (pinos, RF, Telegram, Wi-Fi) e observação das saídas do sketch.
+//
+// O tempo só anda quando todas as tarefas estão bloqueadas: o código do sketch roda em
+// tempo virtual zero, e as latências virtuais vêm dos prazos do próprio firmware (trabalhos
+// do loop, debounce, esperas das tarefas) e das latências simuladas da rede. O custo real
+// de CPU de cada evento é medido à parte, no relógio do host.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+// --- Relógio e agenda ---
+
+/** Instante virtual, em microssegundos desde o boot simulado. */
+uint64_t agoraUs();
+
+/** Agenda `acao` para o instante virtual dado. Roda no contexto do simulador, como uma ISR. */
+void agendar(uint64_t instanteUs, std::function<void()> acao);
+
+/** Cria a tarefa do loop (`setup()` e depois `loop()` para sempre), como o Arduino-ESP32. */
+void iniciar(void (*setup)(), void (*loop)());
+
+/** Avança a simulação até o instante virtual dado (ou até o firmware reiniciar). */
+void executarAte(uint64_t instanteUs);
+
+/** Tempo real do host, em nanossegundos (relógio monotônico). */
+uint64_t nsHost();
+
+/** `true` depois que o firmware chamou `esp_restart()`. */
+bool reiniciou();
+
+// --- Parâmetros do mundo simulado ---
+
+struct Parametros {
+  uint32_t latenciaWiFiMs = 1500;   // Do `WiFi.begin()` ao IP.
+  uint32_t latenciaTlsMs = 300;     // Handshake TLS de uma conexão nova.
+  uint32_t latenciaEnvioMs = 200;   // Ida e volta de uma chamada à API do Telegram.
+  uint32_t latenciaNtpMs = 500;     // Do IP à primeira sincronização do relógio.
+  uint32_t epochNtp = 1760000000;   // Horário Unix entregue pelo "NTP" no boot simulado.
+  bool wifiDisponivel = true;       // Estado inicial da rede.
+  bool serialVisivel = false;       // Copia o `Serial` para a saída padrão.
+  uint32_t pilhaMinimaBytes = 256 * 1024; // Pilha mínima de cada tarefa no host (64 bits e sem -Os).
+};
+Parametros& parametros();
+
+// --- Injeção de eventos ---
+
+/** Muda o nível de um pino de entrada e chama a ISR ligada a ele, se a borda casar. */
+void definirPino(uint8_t pino, uint8_t nivel);
+
+/** Entrega `quadros` quadros iguais ao decodificador RF, um a cada `intervaloUs`. */
+void receberRF(uint32_t codigo, uint32_t quadros = 1, uint32_t intervaloUs = 40000, uint8_t bits = 24,
+               uint8_t protocolo = 1);
+
+/** Coloca uma mensagem na caixa de entrada do bot (entregue no próximo `getUpdates`). */
+void receberTelegram(const std::string& chat, const std::string& texto);
+
+/** Liga ou derruba a rede. Uma queda fecha as conexões abertas. */
+void definirWiFi(bool disponivel);
+
+// --- Saídas observáveis ---
+
+enum TipoSaida { SAIDA_GPIO, SAIDA_TELEGRAM, SAIDA_EDICAO, SAIDA_DOCUMENTO, SAIDA_REINICIO };
+
+struct Saida {
+  TipoSaida tipo;
+  uint64_t instanteUs;
+  uint32_t valor;    // GPIO: pino << 1 | nível; Telegram/edição: id da mensagem; documento: bytes.
+  std::string texto; // Texto da mensagem, ou nome do documento.
+};
+
+/** Registra quem recebe cada saída, no momento em que ela acontece. */
+void aoProduzirSaida(std::function<void(const Saida&)> observador);
+
+/** Chamado internamente pelos fakes. */
+void produzirSaida(TipoSaida tipo, uint32_t valor, const std::string& texto = std::string());
+
+// --- Contadores ---
+
+struct Contadores {
+  uint64_t alocacoes = 0;       // `new`/`malloc` feitos pelo código do sketch.
+  uint64_t bytesAlocados = 0;
+  uint64_t trocasContexto = 0;
+  uint64_t nsEmTarefas = 0;     // Tempo real de CPU gasto dentro das tarefas e ISRs.
+  uint64_t escritasNvs = 0;
+  uint64_t bytesGravadosFs = 0;
+};
+Contadores& contadores();
+
+struct EstatisticaTarefa {
+  std::string nome;
+  uint32_t pilhaPedida;  // Bytes pedidos pelo sketch (a pilha real no host é maior).
+  uint32_t pilhaUsada;   // Marca d'água da pilha no host.
+  uint64_t nsCpu;
+  uint64_t execucoes;
+};
+std::vector<EstatisticaTarefa> estatisticasTarefas();
+
+/** Desliga a contagem de alocações enquanto existir (internos dos fakes e da bancada). */
+class SemContagem {
+ public:
+  SemContagem();
+  ~SemContagem();
+  SemContagem(const SemContagem&) = delete;
+  SemContagem& operator=(const SemContagem&) = delete;
+};
+
+// --- Primitivas para os fakes (só no contexto de uma tarefa) ---
+
+/** Bloqueia a tarefa atual pelo tempo virtual dado. */
+void dormirUs(uint64_t duracaoUs);
+
+/** Bloqueia até `sinalizar(objeto)` ou até o prazo. @return `false` se o prazo venceu. */
+bool esperarSinal(const void* objeto, uint64_t prazoUs);
+
+/** Acorda quem espera por `objeto`. Pode ser chamada de qualquer contexto. */
+void sinalizar(const void* objeto);
+
+/** Roda um callback do sketch fora das tarefas (ISR, timer, evento), contando o que ele aloca. */
+void executarNoSketch(const std::function<void()>& acao);
+
+} // namespace sim
@@ -0,0 +1,13 @@
+// Fake do ESP-IDF para a bancada no host: endereços dos registradores de GPIO do ESP32.
+#pragma once
+#include "soc.h"
+
+#define GPIO_OUT_W1TS_REG 0x3FF44008
+#define GPIO_OUT_W1TC_REG 0x3FF4400C
+#define GPIO_OUT1_W1TS_REG 0x3FF44014
+#define GPIO_OUT1_W1TC_REG 0x3FF44018
+#define GPIO_IN_REG 0x3FF4403C
+#define GPIO_IN1_REG 0x3FF44040
+#define GPIO_PIN0_REG 0x3FF44088
+#define GPIO_PIN0_INT_TYPE_V 0x7
+#define GPIO_PIN0_INT_TYPE_S 7
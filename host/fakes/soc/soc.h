@@ -0,0 +1,16 @@
+// Fake do ESP-IDF para a bancada no host: o acesso a registradores vira chamadas ao
+// simulador de GPIO (`hardware.cpp`), com os endereços reais do ESP32.
+#pragma once
+#include <stdint.h>
+
+namespace sim {
+uint32_t lerRegistrador(uint32_t endereco);
+void escreverRegistrador(uint32_t endereco, uint32_t valor);
+}
+
+#define REG_READ(reg) sim::lerRegistrador((uint32_t)(reg))
+#define REG_WRITE(reg, valor) sim::escreverRegistrador((uint32_t)(reg), (uint32_t)(valor))
+#define REG_SET_FIELD(reg, campo, valor) \
+  REG_WRITE((reg), (REG_READ(reg) & ~((uint32_t)(campo##_V) << (campo##_S))) | \
+                   (((uint32_t)(valor) & (campo##_V)) << (campo##_S)))
+#define REG_GET_FIELD(reg, campo) ((REG_READ(reg) >> (campo##_S)) & (campo##_V))
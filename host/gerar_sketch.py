@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""Prepara o sketch para compilar no host, como o construtor do Arduino faz com um .ino.
+
+Lê a saída do pré-processador (para pular o código desligado por `#if`), encontra as
+definições de função no nível de arquivo do sketch e grava uma cópia dele com
+`#include <Arduino.h>` no topo e os protótipos antes da primeira função, com diretivas
+`#line` apontando para o arquivo original (os erros e avisos citam `sentinela.cpp`).
+
+Uso: gerar_sketch.py --pre sentinela.ii --fonte ../sentinela.cpp --saida sentinela_host.cpp
+"""
+import argparse
+import os
+import re
+import sys
+
+MARCADOR = re.compile(r'#\s*(\d+)\s+"((?:[^"\\]|\\.)*)"')
+FUNCAO = re.compile(
+    r'^(?:[A-Za-z_][\w:]*(?:<[^(){};]*>)?[\s*&]+)+'  # Tipo de retorno.
+    r'(?P<nome>[A-Za-z_]\w*)\s*\((?P<args>.*)\)\s*(?:const\s*)?(?:noexcept\s*)?$',
+    re.S)
+NAO_FUNCAO = {'static', 'inline', 'template', 'struct', 'class', 'enum', 'union', 'namespace',
+              'typedef', 'extern', 'using', 'constexpr'}
+PALAVRAS_DE_CONTROLE = {'if', 'for', 'while', 'switch', 'return', 'sizeof', 'catch'}
+
+
+def linhas_do_sketch(pre, fonte):
+    """Devolve as linhas de `fonte` que sobraram no pré-processado, com o número original."""
+    alvo = os.path.realpath(fonte)
+    atual, numero, linhas = None, 0, []
+    with open(pre, encoding='utf-8', errors='surrogateescape') as f:
+        for linha in f:
+            m = MARCADOR.match(linha)
+            if m:
+                numero = int(m.group(1))
+                atual = os.path.realpath(m.group(2).encode().decode('unicode_escape'))
+                continue
+            if atual == alvo and not linha.lstrip().startswith('#'):
+                linhas.append((numero, linha.rstrip('\n')))
+            numero += 1
+    return linhas
+
+
+def definicoes(linhas):
+    """Percorre o código no nível de arquivo e devolve (linha, protótipo) de cada função."""
+    texto = '\n'.join(t for _, t in linhas)
+    numero_da_linha = []
+    for n, t in linhas:
+        numero_da_linha.extend([n] * (len(t) + 1))
+
+    achadas = []
+    profundidade = 0
+    comando, inicio = [], None
+    i, fim = 0, len(texto)
+    while i < fim:
+        c = texto[i]
+        # Comentários, strings (inclusive cruas) e caracteres não contam chaves.
+        if texto.startswith('//', i):
+            i = texto.find('\n', i)
+            i = fim if i < 0 else i
+            continue
+        if texto.startswith('/*', i):
+            i = texto.find('*/', i + 2)
+            i = fim if i < 0 else i + 2
+            continue
+        cru = re.match(r'(?:u8|u|U|L)?R"([^()\\ ]{0,16})\(', texto[i:i + 24])
+        if cru and (i == 0 or not (texto[i - 1].isalnum() or texto[i - 1] == '_')):
+            final = ')' + cru.group(1) + '"'
+            j = texto.find(final, i + cru.end())
+            i = fim if j < 0 else j + len(final)
+            if profundidade == 0:
+                comando.append('""')
+            continue
+        if c in '"\'':
+            j = i + 1
+            while j < fim and texto[j] != c:
+                j += 2 if texto[j] == '\\' else 1
+            i = j + 1
+            if profundidade == 0:
+                comando.append('""')
+            continue
+
+        if profundidade == 0:
+            if c == '{':
+                assinatura = ' '.join(''.join(comando).split())
+                m = FUNCAO.match(assinatura)
+                if (m and '=' not in assinatura and assinatura.split()[0] not in NAO_FUNCAO
+                        and m.group('nome') not in PALAVRAS_DE_CONTROLE and 'operator' not in assinatura):
+                    achadas.append((inicio, assinatura + ';'))
+                profundidade = 1
+                comando, inicio = [], None
+            elif c == ';' or c == '}':
+                comando, inicio = [], None
+            else:
+                if inicio is None and not c.isspace():
+                    inicio = numero_da_linha[i]
+                comando.append(c)
+        elif c == '{':
+            profundidade += 1
+        elif c == '}':
+            profundidade -= 1
+            if profundidade == 0:
+                comando, inicio = [], None
+        i += 1
+    return achadas
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    p.add_argument('--pre', required=True, help='saída do pré-processador (-E) para o sketch')
+    p.add_argument('--fonte', required=True, help='o sketch original')
+    p.add_argument('--saida', required=True, help='arquivo gerado para compilar no host')
+    a = p.parse_args()
+
+    achadas = definicoes(linhas_do_sketch(a.pre, a.fonte))
+    if not achadas:
+        sys.exit('gerar_sketch: nenhuma função encontrada em ' + a.fonte)
+    primeira = min(n for n, _ in achadas)
+    fonte = os.path.realpath(a.fonte)
+    with open(a.fonte, encoding='utf-8') as f:
+        original = f.read().split('\n')
+
+    saida = ['#include <Arduino.h>', '#line 1 "%s"' % fonte]
+    saida += original[:primeira - 1]
+    saida += [prototipo for _, prototipo in achadas]
+    saida += ['#line %d "%s"' % (primeira, fonte)]
+    saida += original[primeira - 1:]
+    with open(a.saida, 'w', encoding='utf-8') as f:
+        f.write('\n'.join(saida))
+
+
+if __name__ == '__main__':
+    main()
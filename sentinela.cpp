@@ -15,23 +15,145 @@
  * 3. Um botão físico conectado diretamente ao ESP32.
  *
  * Funcionalidades Adicionais:
- * - Reconexão automática ao Wi-Fi com monitoramento de status.
- * - Sistema de logs de eventos persistente, salvo no sistema de arquivos LittleFS.
+ * - Inicialização rápida: um instantâneo do estado (armado ou disparado, zonas e
+ *   cursores do Telegram) é restaurado da RTC ou da flash e os sensores ficam
+ *   ativos antes do Wi-Fi, do NTP e do Telegram, que sobem em segundo plano.
+ * - Reconexão automática ao Wi-Fi, orientada a eventos e sem bloqueio, com
+ *   espera exponencial entre tentativas e registro da duração das quedas.
+ * - Sistema de logs de eventos persistente, salvo no sistema de arquivos LittleFS,
+ *   com gravação em lotes por uma tarefa de baixa prioridade, em registros binários
+ *   compactos e segmentos rotativos com orçamento fixo de espaço. Opcionalmente
+ *   (`SENTINELA_DIARIO_PARTICAO`), num diário circular direto numa partição da flash.
  * - Sincronização de horário com servidores NTP para timestamps precisos nos logs.
- * - Prevenção de "flood" (envio excessivo) de mensagens no Telegram.
+ * - Caixa de saída persistente para os alertas: sem Wi-Fi ou após um reinício, eles
+ *   ficam na flash e saem em ordem, agrupados, quando a conexão volta.
+ * - Prevenção de "flood" (envio excessivo) de mensagens no Telegram: alertas têm
+ *   prioridade, avisos repetidos viram um resumo e um balde de tokens limita o ritmo.
  * - Lógica de "debounce" para o botão físico, evitando acionamentos múltiplos.
+ * - PIR e botão tratados por interrupção, com eventos carimbados no tempo e
+ *   entregues ao loop por um buffer circular sem travas (nenhuma borda perdida).
+ * - Tarefa de rede dedicada (núcleo 0) para o Telegram: o sensoriamento e a
+ *   sirene (núcleo 1) nunca ficam bloqueados esperando a internet.
+ * - Operações longas (relatório e upload do log) numa tarefa de trabalho com conexão
+ *   própria, que alimenta o watchdog, mostra o progresso, aceita `/cancelar` e pausa
+ *   enquanto houver um alerta por enviar.
+ * - Loop organizado como escalonador cooperativo: trabalhos periódicos e únicos
+ *   com prioridade e orçamento de tempo, e sono até o próximo prazo.
+ * - Até 16 zonas (PIR, contatos e sensores RF) instantâneas, retardadas ou 24 h, com
+ *   atrasos de entrada/saída, bypass e máquina de estados dirigida por tabela.
+ * - Tabela de controles RF (hash) salva na flash, com funções de armar, desarmar,
+ *   pânico e sensor de zona, cadastro pelo `/aprender` e códigos desconhecidos agregados.
+ * - Métricas de desempenho (histogramas de tempo, memória, pilhas e Wi-Fi) pelo
+ *   comando `/metricas` e pela serial, num formato fácil de processar.
+ * - Recepção de comandos por "long polling": o comando chega em uma ida e volta,
+ *   sem consultas periódicas vazias ao servidor.
+ * - Correlação de incidentes: acionamentos próximos viram um só incidente, com um
+ *   alerta, uma mensagem reescrita no lugar e um único registro agregado no log.
+ * - Atualização pelo ar (`/atualizar`): a imagem é gravada em fatias na partição OTA
+ *   inativa com SHA-256 conferido, e a versão nova volta sozinha para a anterior se não
+ *   passar na verificação de saúde.
+ * - Comandos numa tabela constante com índice de hash perfeito montado pelo
+ *   compilador: só o `CHAT_ID` comanda pelo Telegram, e cada comando diz por quais
+ *   canais é aceito.
+ * - Variantes de montagem na compilação (`SENTINELA_COM_TELEGRAM`, `SENTINELA_COM_RF`,
+ *   `SENTINELA_COM_BOTAO`): recursos desligados não entram no binário. Pinos
+ *   conferidos por `static_assert` e relé acionado direto pelos registradores do GPIO.
+ * - Canal MQTT opcional (`SENTINELA_COM_MQTT`) com o broker da rede local: eventos com
+ *   QoS 1 e comandos em milissegundos, atrás de uma interface de transportes em que o
+ *   Telegram fica de reserva.
+ * - Telemetria opcional para frotas (`SENTINELA_TELEMETRIA`): um quadro CBOR compacto por
+ *   minuto, por UDP ou HTTP, com estado, Wi-Fi, memória, sequência do log e métricas.
+ * - Modo de baixo consumo opcional (`SENTINELA_ECONOMIA_ENERGIA`): clock dinâmico, Wi-Fi
+ *   em modem-sleep e, sem RF, sono leve com despertar pelas zonas e pelo botão; o ciclo
+ *   ativo medido aparece nas métricas.
  *********************************************************************************/
 
 
+// =================================================================================
+// --- RECURSOS DO FIRMWARE (ALTERE AQUI) ---
+// =================================================================================
+// Cada recurso pode ser desligado (0) aqui ou na linha de compilação (por exemplo
+// `-DSENTINELA_COM_RF=0`). Um recurso desligado não entra no firmware: bibliotecas,
+// objetos, tarefas e funções dele não são compilados, e o binário fica menor.
+#ifndef SENTINELA_COM_TELEGRAM
+#define SENTINELA_COM_TELEGRAM 1    // Notificações e comandos pelo Telegram (sem ele, os avisos saem na serial).
+#endif
+#ifndef SENTINELA_COM_RF
+#define SENTINELA_COM_RF 1          // Receptor RF 433MHz: controles remotos e sensores RF.
+#endif
+#ifndef SENTINELA_COM_BOTAO
+#define SENTINELA_COM_BOTAO 1       // Botão físico de armar/desarmar.
+#endif
+#ifndef SENTINELA_COM_MQTT
+#define SENTINELA_COM_MQTT 0        // Broker MQTT na rede local como canal principal (o Telegram fica de reserva).
+#endif
+#ifndef SENTINELA_TELEMETRIA
+#define SENTINELA_TELEMETRIA 0      // Relatório periódico compacto (CBOR) para um coletor da frota.
+#endif
+#ifndef SENTINELA_ECONOMIA_ENERGIA
+#define SENTINELA_ECONOMIA_ENERGIA 0 // Baixo consumo, para unidades com bateria (ver "Economia de Energia").
+#endif
+#ifndef SENTINELA_COM_OTA
+#define SENTINELA_COM_OTA SENTINELA_COM_TELEGRAM // Atualização do firmware pelo ar com o comando `/atualizar`.
+#endif
+#if SENTINELA_COM_MQTT && !SENTINELA_COM_TELEGRAM
+#error "O MQTT usa o Telegram como reserva e a mesma fila de notificações: ligue SENTINELA_COM_TELEGRAM."
+#endif
+#if SENTINELA_COM_OTA && !SENTINELA_COM_TELEGRAM
+#error "A atualização pelo ar é pedida e confirmada pelo Telegram: ligue SENTINELA_COM_TELEGRAM ou desligue SENTINELA_COM_OTA."
+#endif
+
+// --- Armazenamento do Log ---
+// 0: segmentos rotativos em arquivos do LittleFS (padrão, nenhuma configuração extra).
+// 1: diário circular gravado direto numa partição de 64 KB, sem o custo de metadados do
+//    sistema de arquivos. Exige uma tabela de partições (`partitions.csv` na pasta do
+//    sketch) com a linha:  diario, data, 0x40, , 64K,
+#ifndef SENTINELA_DIARIO_PARTICAO
+#define SENTINELA_DIARIO_PARTICAO 0
+#endif
+
+
 // =================================================================================
 // --- INCLUSÃO DE BIBLIOTECAS ---
 // =================================================================================
 #include <WiFi.h>                   // Para gerenciamento da conexão Wi-Fi.
+#if SENTINELA_COM_TELEGRAM
 #include <WiFiClientSecure.h>       // Para criar uma conexão segura (HTTPS) para o Telegram.
 #include <UniversalTelegramBot.h>   // Biblioteca principal para interagir com a API do Telegram.
+#endif
+#if SENTINELA_COM_MQTT
+#include <mqtt_client.h>            // Cliente MQTT do ESP-IDF (QoS 1, tarefa e reconexão próprias).
+#endif
+#if SENTINELA_TELEMETRIA
+#include <WiFiUdp.h>                // Quadros de telemetria por UDP.
+#endif
+#if SENTINELA_TELEMETRIA || SENTINELA_COM_OTA
+#include <HTTPClient.h>             // POST da telemetria (`TELEMETRIA_HTTP`) e download do firmware.
+#endif
+#if SENTINELA_COM_OTA
+#include <esp_ota_ops.h>            // Gravação na partição OTA inativa, troca de partição e reversão.
+#include <mbedtls/sha256.h>         // SHA-256 da imagem, calculado a cada fatia recebida.
+#endif
+#if SENTINELA_COM_RF
 #include <RCSwitch.h>               // Para receber sinais de rádio frequência (RF 433MHz).
+#include <esp_timer.h>              // Amostragem periódica do decodificador RF, fora do loop.
+#endif
 #include <LittleFS.h>               // Para criar um sistema de arquivos e salvar logs.
 #include <time.h>                   // Para obter o tempo de servidores NTP e gerar timestamps.
+#include <esp_sntp.h>               // Aviso de sincronização do NTP (invalida o cache de horário).
+#include <freertos/FreeRTOS.h>      // Núcleo do FreeRTOS (tarefas).
+#include <freertos/queue.h>         // Filas para troca de mensagens entre tarefas.
+#include <freertos/semphr.h>        // Mutex para proteger recursos compartilhados.
+#include <soc/gpio_reg.h>           // Leitura direta do registrador de entrada dentro das ISRs.
+#include <atomic>                   // Índices do buffer de eventos compartilhado com as ISRs.
+#include <esp_system.h>             // Tratador de desligamento (descarrega os logs antes de reiniciar).
+#include <esp_task_wdt.h>           // Watchdog de tarefas, alimentado pelas operações longas.
+#include <esp_partition.h>          // Diário de eventos numa partição própria (opcional).
+#include <esp_rom_crc.h>            // CRCs dos setores e registros desse diário.
+#include <esp_pm.h>                 // Gerenciador de energia: clock dinâmico e sono leve automático.
+#include <esp_sleep.h>              // Bordas dos sensores como fonte de despertar do sono leve.
+#include <driver/gpio.h>            // Despertar por nível nos GPIOs das zonas e do botão.
+#include <Preferences.h>            // Armazenamento chave-valor (NVS) para o instantâneo do estado.
 
 
 // =================================================================================
@@ -46,40 +168,1169 @@ const char* password = "SUA_SENHA_WIFI"; // Senha da sua rede Wi-Fi.
 #define BOT_TOKEN "SEU_BOT_TELEGRAM_TOKEN" // Token do seu Bot, obtido com o @BotFather.
 #define CHAT_ID "SEU_CHAT_ID_TELEGRAM"     // ID do chat para onde as mensagens serão enviadas.
 
+// --- Broker MQTT na Rede Local (só com `SENTINELA_COM_MQTT`) ---
+#define MQTT_URI "mqtt://192.168.0.10:1883" // Endereço do broker (ex.: Mosquitto no servidor local).
+#define MQTT_USUARIO ""                     // Usuário do broker (vazio se não houver autenticação).
+#define MQTT_SENHA ""                       // Senha do broker.
+// Sem usuário, qualquer aparelho da rede fala com o broker: o Sentinela só publica e não
+// assina o tópico de comandos. Com usuário, prefira também `mqtts://` no `MQTT_URI`.
+constexpr bool MQTT_ACEITA_COMANDOS = sizeof(MQTT_USUARIO) > 1;
+#define MQTT_PREFIXO "sentinela"            // Tópicos: <prefixo>/eventos, /comandos, /estado e /incidente.
+
+// --- Coletor de Telemetria da Frota (só com `SENTINELA_TELEMETRIA`) ---
+#define TELEMETRIA_HOST "192.168.0.10"      // Servidor que recebe os quadros de todas as unidades.
+const uint16_t TELEMETRIA_PORTA = 5700;     // Porta UDP (ou HTTP) do coletor.
+const bool TELEMETRIA_HTTP = false;         // `true`: POST em http://<host>:<porta>/telemetria; `false`: UDP.
+const uint32_t TELEMETRIA_INTERVALO_S = 60; // Um quadro por intervalo.
+const uint16_t TELEMETRIA_ESPERA_HTTP_MS = 300; // Conexão + resposta do POST; o coletor fora do ar custa só isso.
+
+// --- Atualização pelo Ar (só com `SENTINELA_COM_OTA`) ---
+// A imagem vem de um endereço HTTP(S) e só é aceita se o SHA-256 enviado junto com o
+// comando conferir; a integridade vem do chat autorizado, não do servidor que hospeda o arquivo.
+const bool OTA_VIA_MQTT = false;              // `true` aceita o `/atualizar` também pelo broker local.
+const uint32_t OTA_PRAZO_SAUDE_MS = 600000;  // Tempo para o firmware novo chegar ao Telegram (senão, reverte).
+
 // --- Mapeamento de Pinos do Hardware ---
-const int PIR_PIN = 13;           // Pino onde o sensor de movimento PIR está conectado.
-const int RELAY_PIN = 12;         // Pino conectado ao módulo relé que aciona a sirene.
-const int RF_RECEIVER_PIN = 14;   // Pino de dados (DATA) do receptor RF 433MHz.
-const int BUTTON_PIN = 27;        // Pino para o botão físico de armar/desarmar.
+// Conferidos na compilação: um pino inválido para a função é erro, não surpresa na bancada.
+constexpr int PIR_PIN = 13;           // Pino onde o sensor de movimento PIR está conectado.
+constexpr int RELAY_PIN = 12;         // Pino conectado ao módulo relé que aciona a sirene.
+constexpr int RF_RECEIVER_PIN = 14;   // Pino de dados (DATA) do receptor RF 433MHz.
+constexpr int BUTTON_PIN = 27;        // Pino para o botão físico de armar/desarmar.
+
+static_assert(RELAY_PIN >= 0 && RELAY_PIN < 34, "RELAY_PIN: os GPIOs 34-39 do ESP32 são só de entrada.");
+static_assert(PIR_PIN >= 0 && PIR_PIN < 40, "PIR_PIN: GPIO inexistente no ESP32.");
+static_assert(!SENTINELA_COM_BOTAO || (BUTTON_PIN >= 0 && BUTTON_PIN < 40), "BUTTON_PIN: GPIO inexistente no ESP32.");
+static_assert(!SENTINELA_COM_RF || (RF_RECEIVER_PIN >= 0 && RF_RECEIVER_PIN < 40), "RF_RECEIVER_PIN: GPIO inexistente no ESP32.");
 
 // --- Códigos do Controle Remoto RF ---
-// Configure aqui os códigos que o seu controle remoto envia.
+// Configure aqui os códigos que o seu controle remoto envia. Eles são sempre aceitos;
+// outros controles (pânico, sensores de zona, mais controles) são cadastrados com `/aprender`.
 const unsigned long CODE_ARM = 1234567;    // Código para ARMAR o sistema.
 const unsigned long CODE_DISARM = 7654321; // Código para DESARMAR o sistema.
 
+// --- Zonas de Sensores ---
+// Cada zona é um sensor: PIR ou contato de porta/janela num GPIO (menor que 32), ou um
+// sensor RF (pino -1) cadastrado com `/aprender zona <n>`. A zona n desta lista é a
+// "zona n" dos comandos (a primeira é a zona 1). Tipos:
+//   ZONA_INSTANTANEA: dispara assim que aciona, com o sistema armado.
+//   ZONA_RETARDADA:   com o sistema armado, dá `atrasoEntradaS` para desarmar (porta de entrada).
+//   ZONA_24H:         dispara a qualquer momento, mesmo desarmado (pânico com fio, tamper).
+// `atrasoSaidaS` é o tempo, após armar, até a zona passar a valer (para sair pela porta).
+enum TipoZona : uint8_t {
+  ZONA_INSTANTANEA,
+  ZONA_RETARDADA,
+  ZONA_24H
+};
+
+struct ConfigZona {
+  const char* nome;
+  int8_t pino;              // GPIO do sensor, ou -1 para zona só RF.
+  bool ativoEmAlto;         // `true` se o sensor aciona em HIGH (PIR, contato NF com pull-up).
+  TipoZona tipo;
+  uint16_t atrasoEntradaS;  // Só para ZONA_RETARDADA.
+  uint16_t atrasoSaidaS;
+};
+
+constexpr ConfigZona CONFIG_ZONAS[] = {
+  { "Sensor PIR",  PIR_PIN, true, ZONA_INSTANTANEA, 0, 0 },
+#if SENTINELA_COM_RF
+  { "Sensores RF", -1,      true, ZONA_INSTANTANEA, 0, 0 },
+#endif
+  // Exemplo: contato magnético da porta de entrada no GPIO 26, com 30 s de entrada e saída.
+  // { "Porta de entrada", 26, true, ZONA_RETARDADA, 30, 30 },
+};
+
 
 // =================================================================================
 // --- VARIÁVEIS GLOBAIS DE CONTROLE DO SISTEMA ---
 // =================================================================================
 
 // --- Instâncias de Objetos ---
-WiFiClientSecure client;                      // Cliente seguro para a conexão HTTPS com o Telegram.
-UniversalTelegramBot bot(BOT_TOKEN, client);  // Objeto do Bot, que gerencia a comunicação.
+#if SENTINELA_COM_TELEGRAM
+WiFiClientSecure client;                      // Cliente seguro para a conexão HTTPS com o Telegram (envios).
+UniversalTelegramBot bot(BOT_TOKEN, client);  // Objeto do Bot, que gerencia a comunicação (envios).
+WiFiClientSecure clientPolling;               // Segunda conexão, dedicada ao long polling dos comandos.
+UniversalTelegramBot botPolling(BOT_TOKEN, clientPolling); // Bot usado apenas para `getUpdates`.
+WiFiClientSecure clientTrabalho;              // Terceira conexão, aberta só durante uma operação longa.
+UniversalTelegramBot botTrabalho(BOT_TOKEN, clientTrabalho); // Bot usado pela tarefa de trabalho (uploads).
+#endif
+#if SENTINELA_COM_RF
 RCSwitch rfReceiver = RCSwitch();             // Objeto para gerenciar o receptor RF.
+#endif
+
+// --- Estado do Alarme ---
+// Máquina de estados dirigida por tabela: cada volta do loop resume todas as zonas em
+// alguns eventos (com operações de bits) e `TRANSICOES_ALARME[estado][evento]` dá o
+// próximo estado. O custo por volta não cresce com o número de zonas.
+enum EstadoAlarme : uint8_t {
+  ALARME_DESARMADO,
+  ALARME_SAIDA,       // Armado, com zonas ainda no atraso de saída.
+  ALARME_ARMADO,
+  ALARME_ENTRADA,     // Zona retardada acionada: contando o atraso de entrada.
+  ALARME_DISPARADO,   // Sirene ligada.
+  TOTAL_ESTADOS_ALARME
+};
+
+constexpr const char* NOMES_ESTADO_ALARME[TOTAL_ESTADOS_ALARME] = {
+  "DESARMADO",          // ALARME_DESARMADO
+  "ARMANDO (saída)",    // ALARME_SAIDA
+  "ARMADO",             // ALARME_ARMADO
+  "ARMADO (entrada)",   // ALARME_ENTRADA
+  "DISPARADO",          // ALARME_DISPARADO
+};
+
+enum EventoAlarme : uint8_t {
+  EA_ARMAR,
+  EA_DESARMAR,
+  EA_FIM_SAIDA,            // Todas as zonas saíram do atraso de saída.
+  EA_ZONA_RETARDADA,       // Zona retardada armada acionada.
+  EA_ZONA_INSTANTANEA,     // Zona instantânea armada acionada.
+  EA_FIM_ENTRADA,          // O atraso de entrada acabou sem desarme.
+  EA_ZONA_24H,             // Zona 24 h acionada (vale mesmo desarmado).
+  EA_PANICO,               // Controle RF de pânico.
+  TOTAL_EVENTOS_ALARME
+};
+
+#define D ALARME_DESARMADO
+#define S ALARME_SAIDA
+#define A ALARME_ARMADO
+#define E ALARME_ENTRADA
+#define X ALARME_DISPARADO
+constexpr EstadoAlarme TRANSICOES_ALARME[TOTAL_ESTADOS_ALARME][TOTAL_EVENTOS_ALARME] = {
+  //        ARMAR DESARMAR FIM_SAIDA RETARDADA INSTANT. FIM_ENTRADA 24H PANICO
+  /* D */ { S,    D,       D,        D,        D,       D,          X,  X },
+  /* S */ { S,    D,       A,        E,        X,       S,          X,  X },
+  /* A */ { A,    D,       A,        E,        X,       A,          X,  X },
+  /* E */ { E,    D,       E,        E,        X,       X,          X,  X },
+  /* X */ { X,    D,       X,        X,        X,       X,          X,  X },
+};
+#undef D
+#undef S
+#undef A
+#undef E
+#undef X
 
-// --- Flags de Estado ---
-bool sistemaAtivo = false;     // `true` se o alarme estiver armado, `false` se desarmado.
-bool alarmeDisparado = false;  // `true` se a sirene estiver tocando.
+EstadoAlarme estadoAlarme = ALARME_DESARMADO;
+volatile bool disparoPendente = false; // `true` se o log e a notificação do último disparo ainda não foram feitos.
+
+// --- Tabela de Zonas (estrutura de arrays + máscaras de bits) ---
+// `CONFIG_ZONAS` é expandida em `iniciarZonas()`: os campos usados a cada volta viram
+// arrays e máscaras (bit z = zona z + 1), e a avaliação é feita com operações de bits.
+const uint8_t ZONAS_MAX = 16;
+constexpr uint8_t TOTAL_ZONAS = sizeof(CONFIG_ZONAS) / sizeof(CONFIG_ZONAS[0]);
+static_assert(TOTAL_ZONAS > 0 && TOTAL_ZONAS <= ZONAS_MAX, "configure de 1 a 16 zonas");
+
+DRAM_ATTR int8_t pinoZona[ZONAS_MAX];           // Lido pelas ISRs (por isso em DRAM).
+uint32_t atrasoEntradaZonaUs[ZONAS_MAX];
+uint32_t atrasoSaidaZonaUs[ZONAS_MAX];
+uint32_t instanteZonaUs[ZONAS_MAX];             // Última borda de acionamento de cada zona.
+
+uint16_t mascaraInstantaneas = 0;               // Zonas ZONA_INSTANTANEA.
+uint16_t mascaraRetardadas = 0;                 // Zonas ZONA_RETARDADA.
+uint16_t mascara24h = 0;                        // Zonas ZONA_24H.
+uint16_t mascaraAtivoEmAlto = 0;                // Zonas que acionam em HIGH.
+uint16_t zonasAbertas = 0;                      // Sensores acionados agora (nível).
+uint16_t zonasAcionadas = 0;                    // Acionamentos desde a última avaliação (bordas e RF).
+uint16_t zonasArmadas = 0;                      // Zonas valendo (fora do atraso de saída).
+uint16_t zonasEmSaida = 0;                      // Zonas ainda no atraso de saída.
+uint16_t zonasIgnoradas = 0;                    // Zonas em bypass (`/ignorar`) até o próximo desarme.
+uint16_t zonasDisparadas = 0;                   // Zonas que causaram o disparo atual.
+uint32_t inicioSaidaUs = 0;                     // Instante em que o sistema foi armado.
+uint32_t inicioEntradaUs = 0;                   // Instante em que o atraso de entrada começou.
+uint32_t atrasoEntradaAtualUs = 0;              // Atraso de entrada da zona que o iniciou.
+
+// O que causou o último disparo (define a mensagem e o registro de `concluirDisparo()`).
+enum CausaDisparo : uint8_t {
+  CAUSA_ZONA,
+  CAUSA_PANICO        // Controle RF com a função pânico.
+};
+CausaDisparo causaDisparo = CAUSA_ZONA;
+uint8_t zonaDisparo = 0;       // Índice da zona (0 = zona 1), em CAUSA_ZONA.
+
+// --- Correlação de Incidentes ---
+// Acionamentos próximos no tempo formam um só incidente, mesmo que o sistema seja desarmado
+// e rearmado no meio. O primeiro disparo gera o alerta e o registro crítico de sempre; os
+// acionamentos seguintes (movimento contínuo com a sirene tocando, ou um novo disparo da
+// mesma zona depois de rearmar) só são contados, e a mensagem do incidente é reescrita no
+// lugar, no máximo a cada `INCIDENTE_ATUALIZACAO_US`. Só uma escalada (uma zona que ainda
+// não tinha sido acionada, ou o pânico) gera um alerta novo. Após `INCIDENTE_JANELA_S` sem
+// acionamentos, o incidente é encerrado com um único registro agregado no log. Janela 0
+// desliga a correlação: cada disparo gera o seu alerta.
+const uint32_t INCIDENTE_JANELA_S = 120;             // Silêncio que encerra o incidente.
+static_assert(INCIDENTE_JANELA_S < 4000, "a janela é medida com o relógio de 32 bits em us");
+const uint32_t INCIDENTE_JANELA_US = INCIDENTE_JANELA_S * 1000000;
+const uint32_t INCIDENTE_ATUALIZACAO_US = 15000000;  // Intervalo mínimo entre reescritas da mensagem.
+
+struct Incidente {
+  bool aberto;
+  bool pendente;             // Há acionamentos que a mensagem ainda não mostra.
+  bool divulgado;            // A mensagem do incidente já saiu ao menos uma vez.
+  bool panico;               // O pânico foi acionado durante o incidente.
+  uint32_t numero;           // Distingue a mensagem de cada incidente na tarefa de rede.
+  uint16_t acertos;          // Acionamentos agrupados (satura em 65535).
+  uint16_t zonas;            // Zonas acionadas durante o incidente.
+  uint32_t duracaoMs;        // Do primeiro ao último acionamento.
+  uint32_t ultimoAcertoUs;   // `micros()` do último acionamento.
+  uint32_t ultimaAtualizacaoUs;
+};
+
+Incidente incidente = {};
+
+// --- Estado Persistente e Tempos de Inicialização ---
+// Um instantâneo compacto do estado (armado ou disparado, zonas, cursor do Telegram e da
+// caixa de saída) é restaurado logo no início do `setup()`, antes de qualquer trabalho de
+// rede, para que um reinício não deixe o local desprotegido. Ele fica em dois lugares: na
+// memória RTC, que sobrevive a watchdog, pânico e brownout e é lida sem tocar na flash, e
+// na NVS, em duas chaves usadas alternadamente (uma gravação interrompida estraga só a
+// cópia nova). Só se grava quando o conteúdo muda: mudanças do alarme vão para a flash na
+// hora; as dos cursores, no máximo a cada `INSTANTANEO_INTERVALO_NVS_US`. O núcleo 1 só
+// escreve a RTC e deixa a cópia em `instantaneoNvs`; a gravação na NVS (que apaga setores
+// e para o cache da flash por milissegundos) é feita pela tarefa de log, no núcleo 0.
+Preferences preferencias;
+const char* NVS_NAMESPACE = "sentinela";        // Namespace das chaves na NVS.
+const char* NVS_CHAVE_ARMADO = "armado";        // Formato antigo (só o armado), lido se não houver instantâneo.
+const char* NVS_CHAVES_INSTANTANEO[2] = {"estado_a", "estado_b"}; // Cópias alternadas do instantâneo.
+const uint8_t INSTANTANEO_VERSAO = 1;
+const uint32_t INSTANTANEO_INTERVALO_NVS_US = 60000000; // Intervalo mínimo de gravação só dos cursores.
+
+struct InstantaneoEstado {
+  uint32_t geracao;                // Cresce a cada mudança; vale a cópia íntegra mais nova.
+  uint8_t versao;                  // INSTANTANEO_VERSAO.
+  uint8_t estado;                  // ALARME_DESARMADO, ALARME_ARMADO ou ALARME_DISPARADO.
+  uint8_t causa;                   // CausaDisparo (em ALARME_DISPARADO).
+  uint8_t zonaDisparo;             // Idem.
+  uint16_t zonasIgnoradas;         // Bypass em vigor.
+  uint16_t zonasDisparadas;        // Zonas do disparo (em ALARME_DISPARADO).
+  int32_t ultimaMensagemTelegram;  // `last_message_received` do polling.
+  uint32_t saidaConfirmada;        // Última sequência entregue da caixa de saída.
+  uint32_t soma;                   // FNV-1a dos campos anteriores.
+};
+
+enum OrigemInstantaneo : uint8_t {
+  INST_NENHUM,        // Primeiro boot: começa desarmado.
+  INST_RTC,           // Reinício sem corte de energia.
+  INST_NVS,           // Cópia da flash.
+  INST_LEGADO         // Só a chave `armado` do formato antigo.
+};
+
+constexpr const char* NOMES_ORIGEM_INSTANTANEO[] = {"nenhum", "rtc", "nvs", "legado"};
+
+RTC_NOINIT_ATTR InstantaneoEstado instantaneoRtc; // Não é zerada no boot (só perdida num corte de energia).
+InstantaneoEstado instantaneoSalvo = {};          // Última versão gravada, para detectar mudanças.
+uint8_t chaveNvsInstantaneo = 0;                  // Próxima chave de `NVS_CHAVES_INSTANTANEO` a gravar.
+bool nvsDesatualizada = false;                    // A RTC tem uma mudança que a flash ainda não tem.
+InstantaneoEstado instantaneoNvs = {};            // Cópia entregue à tarefa de log (protegida por `muxInstantaneo`).
+bool instantaneoNvsPendente = false;              // `instantaneoNvs` ainda não foi gravada.
+portMUX_TYPE muxInstantaneo = portMUX_INITIALIZER_UNLOCKED;
+uint32_t ultimaGravacaoNvsUs = 0;
+uint32_t gravacoesRtc = 0;
+uint32_t gravacoesNvs = 0;
+OrigemInstantaneo origemInstantaneo = INST_NENHUM;
+int32_t ultimaMensagemRestaurada = 0;             // Entregue ao `botPolling` quando o polling começa.
+uint32_t saidaConfirmadaRestaurada = 0;           // Conferida com o marcador da caixa de saída.
+uint32_t bootProtegidoMs = 0;                   // `millis()` em que os sensores ficaram ativos.
+bool bootOnline = false;                        // `true` depois do primeiro contato com o Telegram.
+uint32_t ultimaVerificacaoOnline = 0;           // `millis()` da última tentativa de contato inicial.
+const uint32_t INTERVALO_VERIFICACAO_ONLINE = 5000; // Intervalo entre tentativas de contato inicial.
+
+// --- Latência do Disparo ---
+// Tempo entre a borda do PIR (carimbada na ISR) e o acionamento do relé.
+// O histograma com o máximo fica nas métricas (`MET_PIR_SIRENE`).
+uint32_t latenciaDisparoUs = 0;       // Latência medida no último disparo.
 
 // --- Controle de Tempo e Conexão ---
-unsigned long lastMsgTime = 0;                  // Armazena o tempo do último polling de mensagens no Telegram.
-const long msgInterval = 3000;                  // Intervalo (em ms) para checar novas mensagens (evita flood).
-unsigned long lastWiFiCheck = 0;                // Armazena o tempo da última verificação de Wi-Fi.
-const long wifiCheckInterval = 10000;           // Intervalo (em ms) para verificar se o Wi-Fi ainda está conectado.
-bool wifiConectadoAnterior = false;             // Flag para detectar transições no status do Wi-Fi (queda/retorno).
+const long msgInterval = 3000;                  // Intervalo (em ms) do polling curto e espera após falhas (evita flood).
+const long FUSO_HORARIO_S = -3 * 3600;          // GMT-3 (fuso de Brasília): NTP e datas do log antigo.
+
+#if SENTINELA_COM_TELEGRAM
+// --- Long Polling do Telegram ---
+// O `getUpdates` é feito com timeout no servidor: a requisição fica aberta até chegar
+// uma mensagem (que então é entregue em uma ida e volta) ou até o timeout expirar.
+// Como a chamada fica presa por até `TELEGRAM_LONG_POLL_S`, ela roda numa tarefa e
+// conexão TLS próprias; os envios (alertas) continuam livres na tarefa de rede.
+const uint32_t TELEGRAM_LONG_POLL_S = 50;       // Timeout do servidor (s). 0 volta ao polling curto a cada `msgInterval`.
+const uint32_t POLLING_STACK = 10240;           // Pilha da tarefa de polling (o TLS consome bastante).
+TaskHandle_t tarefaPollingHandle = nullptr;
+
+// --- Sessão TLS com o Telegram ---
+// A conexão HTTPS com api.telegram.org é mantida aberta entre as chamadas (HTTP/1.1
+// keep-alive), então o handshake completo só acontece quando o servidor ou a rede
+// a derrubam. Cada handshake é contado e cronometrado para as métricas.
+uint32_t tlsHandshakes = 0;                     // Handshakes concluídos com sucesso.
+uint32_t tlsFalhas = 0;                         // Handshakes que falharam.
+uint32_t tlsUltimoHandshakeMs = 0;              // Duração do último handshake.
+uint32_t tlsMaiorHandshakeMs = 0;               // Maior duração registrada.
+uint32_t tlsTotalHandshakeMs = 0;               // Soma das durações (para a média).
+portMUX_TYPE muxTls = portMUX_INITIALIZER_UNLOCKED; // As duas conexões atualizam as métricas.
+#endif
+
+// --- Métricas de Desempenho ---
+// Cada medição de tempo entra num histograma com faixas por década (até 100 us, até 1 ms, ...).
+// As métricas são acumuladas desde a inicialização e lidas pelo `/metricas` e pela serial,
+// sempre no formato `nome chave=valor ...`, uma métrica por linha.
+enum MetricaTempo : uint8_t {
+  MET_LOOP,           // Uma passada do escalonador no `loop()` (sem o sono).
+  MET_GET_UPDATES,    // `getUpdates` (no long polling, inclui a espera no servidor).
+  MET_SEND_MESSAGE,   // `sendMessage` na tarefa de rede.
+  MET_LOG_EVENTO,     // `logEvento()` / `logEventoCritico()`.
+  MET_PIR_SIRENE,     // Borda do PIR até o relé.
+  MET_MQTT_PUBACK,    // Publicação MQTT até o PUBACK do broker.
+  TOTAL_METRICAS
+};
+
+constexpr const char* NOMES_METRICA[TOTAL_METRICAS] = {
+  "loop_us",          // MET_LOOP
+  "get_updates_us",   // MET_GET_UPDATES
+  "send_message_us",  // MET_SEND_MESSAGE
+  "log_evento_us",    // MET_LOG_EVENTO
+  "pir_sirene_us",    // MET_PIR_SIRENE
+  "mqtt_puback_us",   // MET_MQTT_PUBACK
+};
+
+const uint8_t FAIXAS_HISTOGRAMA = 7;
+// Limite superior (inclusivo) de cada faixa; a última recebe o que passar de 10 s.
+constexpr uint32_t LIMITES_HISTOGRAMA_US[FAIXAS_HISTOGRAMA - 1] = {
+  100, 1000, 10000, 100000, 1000000, 10000000
+};
+
+struct Histograma {
+  uint32_t amostras;
+  uint64_t somaUs;
+  uint32_t maxUs;
+  uint32_t faixas[FAIXAS_HISTOGRAMA];
+};
+
+Histograma metricas[TOTAL_METRICAS];
+portMUX_TYPE muxMetricas = portMUX_INITIALIZER_UNLOCKED; // Medições chegam dos dois núcleos.
+TaskHandle_t tarefaLoopHandle = nullptr;         // Tarefa do Arduino que roda `setup()` e `loop()`.
+const uint32_t METRICAS_INTERVALO_SERIAL_MS = 60000; // Intervalo do despejo periódico na serial.
+const size_t METRICAS_TEXTO_MAX = 2048;          // Capacidade do texto das métricas (bytes).
+
+// --- Máquina de Estados do Wi-Fi ---
+// Os eventos do driver (`WiFi.onEvent`) só marcam bits; a tarefa de rede avança a
+// máquina de estados sem nunca bloquear. Entre tentativas falhas a espera dobra
+// (com variação aleatória, para unidades vizinhas não tentarem juntas) até o teto.
+enum EstadoWiFi : uint8_t {
+  WIFI_CONECTANDO,   // `WiFi.begin()` chamado, aguardando o IP.
+  WIFI_CONECTADO,
+  WIFI_AGUARDANDO    // Esperando o fim da espera para uma nova tentativa.
+};
+
+const uint32_t WIFI_TIMEOUT_TENTATIVA_MS = 15000; // Tempo máximo de uma tentativa de conexão.
+const uint32_t WIFI_ESPERA_INICIAL_MS = 1000;     // Espera após a primeira falha.
+const uint32_t WIFI_ESPERA_MAXIMA_MS = 60000;     // Teto da espera exponencial.
+const uint32_t WIFI_BIT_CONECTOU = 0x01;          // Recebeu IP.
+const uint32_t WIFI_BIT_CAIU = 0x02;              // Desconectou (ou a tentativa falhou).
+
+EstadoWiFi estadoWiFi = WIFI_AGUARDANDO;
+std::atomic<uint32_t> eventosWiFi(0);           // Bits WIFI_BIT_*, marcados no callback do driver.
+uint32_t inicioTentativaWiFi = 0;               // `millis()` do último `WiFi.begin()`.
+uint32_t proximaTentativaWiFi = 0;              // `millis()` em que a próxima tentativa pode começar.
+uint32_t inicioQuedaWiFi = 0;                   // `millis()` em que a queda atual começou.
+uint32_t quedasWiFi = 0;                        // Quedas desde a inicialização.
+uint32_t reconexoesWiFi = 0;                    // Reconexões bem-sucedidas após uma queda.
+bool quedaWiFiEmAndamento = false;              // `true` entre uma queda e a reconexão.
+uint8_t falhasSeguidasWiFi = 0;                 // Tentativas falhas desde a última conexão.
+
+// --- Eventos e Origens do Log ---
+// Cada evento é gravado como um registro binário de tamanho fixo; o texto só é
+// montado a partir destas tabelas quando um relatório é pedido (ou no serial).
+enum CodigoEvento : uint8_t {
+  EVT_SISTEMA_INICIADO,
+  EVT_WIFI_CONECTADO,         // valor = duração da tentativa (ms).
+  EVT_WIFI_FALHA,             // valor = falhas seguidas.
+  EVT_WIFI_PERDIDO,
+  EVT_WIFI_RESTABELECIDO,     // valor = duração da queda (s).
+  EVT_ALARME_DISPARADO,       // valor = latência borda -> relé (us).
+  EVT_SISTEMA_ARMADO,
+  EVT_SISTEMA_DESARMADO,
+  EVT_RF_DESCONHECIDO,        // valor = código recebido.
+  EVT_BOOT_PROTEGIDO,         // valor = ms do boot até os sensores ficarem ativos.
+  EVT_BOOT_ONLINE,            // valor = ms do boot até o primeiro contato com o Telegram.
+  EVT_ESTADO_RESTAURADO,
+  EVT_RF_DESCONHECIDOS,       // valor = códigos desconhecidos no período.
+  EVT_CONTROLE_APRENDIDO,     // valor = código cadastrado.
+  EVT_PANICO,
+  EVT_SENSOR_RF,              // valor = zona do sensor (registros anteriores às zonas).
+  EVT_ZONA_DISPARADA,         // valor = zona que disparou.
+  EVT_ZONA_IGNORADA,          // valor = zona posta em bypass.
+  EVT_INCIDENTE,              // valor = zonas (bits 0-15), acionamentos (16-23) e minutos (24-31).
+  EVT_FIRMWARE_INSTALADO,     // valor = tamanho da imagem (bytes).
+  EVT_FIRMWARE_CONFIRMADO,    // valor = ms do boot até a verificação de saúde.
+  EVT_FIRMWARE_REVERTIDO,
+  EVT_DISPARO_RESTAURADO,     // valor = zona do disparo (0 = pânico).
+  TOTAL_EVENTOS
+};
+
+enum OrigemEvento : uint8_t {
+  ORIGEM_SISTEMA,
+  ORIGEM_TELEGRAM,
+  ORIGEM_RF,
+  ORIGEM_BOTAO,
+  ORIGEM_PIR,
+  ORIGEM_MQTT,
+  TOTAL_ORIGENS
+};
+
+// Categorias usadas pelo filtro `/logs tipo <categoria>`.
+enum CategoriaEvento : uint8_t {
+  CAT_SISTEMA,
+  CAT_ALARME,
+  CAT_WIFI,
+  CAT_RF,
+  TOTAL_CATEGORIAS
+};
+
+constexpr const char* NOMES_CATEGORIA[TOTAL_CATEGORIAS] = {
+  "sistema",  // CAT_SISTEMA
+  "alarme",   // CAT_ALARME
+  "wifi",     // CAT_WIFI
+  "rf",       // CAT_RF
+};
+
+// Como o texto de cada evento usa os campos do registro.
+enum FormatoEvento : uint8_t {
+  FMT_SIMPLES,    // Apenas o texto.
+  FMT_ORIGEM,     // Texto com "%s" para o nome da origem.
+  FMT_VALOR,      // Texto com "%lu" para o valor.
+  FMT_INCIDENTE   // Texto com "%u" acionamentos, "%u" minutos e "%s" zonas (EVT_INCIDENTE).
+};
+
+struct DescricaoEvento {
+  const char* texto;
+  FormatoEvento formato;
+  CategoriaEvento categoria;
+};
+
+constexpr DescricaoEvento DESCRICAO_EVENTOS[TOTAL_EVENTOS] = {
+  { "Sistema iniciado e configurado.",                            FMT_SIMPLES, CAT_SISTEMA }, // EVT_SISTEMA_INICIADO
+  { "WiFi conectado (tentativa de %lu ms).",                      FMT_VALOR,   CAT_WIFI    }, // EVT_WIFI_CONECTADO
+  { "Falha na conexão WiFi (%lu falhas seguidas).",               FMT_VALOR,   CAT_WIFI    }, // EVT_WIFI_FALHA
+  { "Conexão Wi-Fi perdida.",                                     FMT_SIMPLES, CAT_WIFI    }, // EVT_WIFI_PERDIDO
+  { "Conexão Wi-Fi restabelecida após %lu s de queda.",           FMT_VALOR,   CAT_WIFI    }, // EVT_WIFI_RESTABELECIDO
+  { "Sensor acionado, alarme disparado (latência: %lu us).",     FMT_VALOR,   CAT_ALARME  }, // EVT_ALARME_DISPARADO
+  { "Sistema ARMADO com sucesso pela origem: %s",                 FMT_ORIGEM,  CAT_ALARME  }, // EVT_SISTEMA_ARMADO
+  { "Sistema DESARMADO com sucesso pela origem: %s",              FMT_ORIGEM,  CAT_ALARME  }, // EVT_SISTEMA_DESARMADO
+  { "Código RF desconhecido recebido: %lu",                       FMT_VALOR,   CAT_RF      }, // EVT_RF_DESCONHECIDO
+  { "Sensores ativos %lu ms após o boot.",                        FMT_VALOR,   CAT_SISTEMA }, // EVT_BOOT_PROTEGIDO
+  { "Telegram online %lu ms após o boot.",                        FMT_VALOR,   CAT_SISTEMA }, // EVT_BOOT_ONLINE
+  { "Estado ARMADO restaurado da flash após reinício.",           FMT_SIMPLES, CAT_ALARME  }, // EVT_ESTADO_RESTAURADO
+  { "%lu códigos RF desconhecidos recebidos no período.",         FMT_VALOR,   CAT_RF      }, // EVT_RF_DESCONHECIDOS
+  { "Controle RF cadastrado: código %lu",                         FMT_VALOR,   CAT_RF      }, // EVT_CONTROLE_APRENDIDO
+  { "Pânico acionado pelo controle RF, alarme disparado.",        FMT_SIMPLES, CAT_ALARME  }, // EVT_PANICO
+  { "Sensor RF da zona %lu acionado, alarme disparado.",          FMT_VALOR,   CAT_ALARME  }, // EVT_SENSOR_RF
+  { "Zona %lu acionada, alarme disparado.",                       FMT_VALOR,   CAT_ALARME  }, // EVT_ZONA_DISPARADA
+  { "Zona %lu ignorada até o próximo desarme.",                   FMT_VALOR,   CAT_ALARME  }, // EVT_ZONA_IGNORADA
+  { "Incidente: %u acionamento(s) em até %u min, zonas %s.",      FMT_INCIDENTE, CAT_ALARME }, // EVT_INCIDENTE
+  { "Firmware novo gravado (%lu bytes), reiniciando.",            FMT_VALOR,   CAT_SISTEMA }, // EVT_FIRMWARE_INSTALADO
+  { "Firmware novo confirmado %lu ms após o boot.",               FMT_VALOR,   CAT_SISTEMA }, // EVT_FIRMWARE_CONFIRMADO
+  { "Firmware novo reprovado: versão anterior restaurada.",       FMT_SIMPLES, CAT_SISTEMA }, // EVT_FIRMWARE_REVERTIDO
+  { "Disparo (zona %lu) restaurado após reinício: sirene religada.", FMT_VALOR, CAT_ALARME  }, // EVT_DISPARO_RESTAURADO
+};
+
+constexpr const char* NOMES_ORIGEM[TOTAL_ORIGENS] = {
+  "Sistema",        // ORIGEM_SISTEMA
+  "Telegram",       // ORIGEM_TELEGRAM
+  "Controle RF",    // ORIGEM_RF
+  "Botão físico",   // ORIGEM_BOTAO
+  "Sensor PIR",     // ORIGEM_PIR
+  "MQTT",           // ORIGEM_MQTT
+};
+
+// --- Registro Binário do Log (12 bytes) ---
+const uint8_t REG_RELOGIO_SINCRONIZADO = 0x01; // `instante` é epoch Unix; senão, segundos desde o boot.
+
+struct RegistroLog {
+  uint32_t instante;  // Epoch (s) ou segundos desde o boot, conforme `flags`.
+  uint32_t valor;     // Dado extra do evento (latência, código RF...).
+  uint8_t codigo;     // CodigoEvento.
+  uint8_t origem;     // OrigemEvento.
+  uint8_t flags;      // REG_*.
+  uint8_t crc;        // CRC-8 dos 11 bytes anteriores (só no diário em partição).
+};
+
+// --- Arquivos de Log Rotativos ---
+// O log é dividido em `LOG_SEGMENTOS` arquivos de tamanho fixo. Quando o segmento
+// atual enche, o mais antigo é reaproveitado; o total nunca passa de `LOG_ORCAMENTO_BYTES`.
+// Cada segmento começa com um cabeçalho que guarda a sequência do primeiro registro,
+// então a sequência de qualquer registro é `sequenciaInicial + índice`.
+const char* LOG_FILE_LEGADO = "/log_sentinela.txt";          // Log em texto das versões anteriores.
+const size_t LOG_LEGADO_MAX_BYTES = 16 * 1024;  // Final do log antigo convertido em registros.
+const uint32_t LOG_MAGIA = 0x534E4C31;          // "SNL1": identifica um segmento válido.
+
+struct CabecalhoSegmento {
+  uint32_t magia;
+  uint32_t sequenciaInicial;
+};
+
+#if SENTINELA_DIARIO_PARTICAO
+// No diário em partição, cada segmento é um setor de flash: o cabeçalho (com CRC) abre o
+// setor, os registros vêm logo em seguida, e um registro ainda não escrito é lido como
+// 0xFF (flash apagada). A rotação apaga o setor mais antigo. A leitura é feita direto
+// pelo mapeamento da partição na memória (`esp_partition_mmap`), sem cópias.
+const char* DIARIO_ROTULO = "diario";           // Nome da partição na tabela de partições.
+const size_t DIARIO_SETOR = 4096;               // Unidade de apagamento da flash.
+const uint8_t LOG_SEGMENTOS = 16;               // Setores da partição na rotação.
+const size_t LOG_ORCAMENTO_BYTES = LOG_SEGMENTOS * DIARIO_SETOR; // Tamanho exigido da partição.
+
+struct CabecalhoSetor {
+  CabecalhoSegmento segmento;
+  uint32_t crc;               // CRC-32 de `segmento`.
+  uint32_t reservado;         // Completa 16 bytes: 340 registros fecham o setor.
+};
+
+const size_t LOG_BYTES_CABECALHO = sizeof(CabecalhoSetor);
+#else
+const uint8_t LOG_SEGMENTOS = 4;                // Quantidade de arquivos na rotação.
+const size_t LOG_ORCAMENTO_BYTES = 64 * 1024;   // Espaço total reservado para o log.
+const size_t LOG_BYTES_CABECALHO = sizeof(CabecalhoSegmento);
+#endif
+
+const size_t LOG_REGISTROS_POR_SEGMENTO =
+  (LOG_ORCAMENTO_BYTES / LOG_SEGMENTOS - LOG_BYTES_CABECALHO) / sizeof(RegistroLog);
+
+uint8_t segmentoAtual = 0;                      // Índice do segmento sendo escrito.
+size_t registrosNoSegmento = 0;                 // Registros já gravados no segmento atual.
+uint32_t proximaSequencia = 0;                  // Sequência do próximo registro gravado.
+
+// --- Conversão do Log Antigo ---
+// No primeiro boot desta versão, o final do log em texto (`LOG_FILE_LEGADO`) vira registros
+// binários antes de o arquivo ser apagado. Só as frases com um evento equivalente exato
+// entram; as outras (que dependeriam de um valor que o texto não tinha) são contadas.
+enum LeituraLegado : uint8_t {
+  LEG_FIXO,       // O evento e o valor da tabela.
+  LEG_ORIGEM,     // O nome da origem vem depois do trecho.
+  LEG_NUMERO      // O valor (código RF) vem depois do trecho.
+};
+
+struct EquivalenciaLegado {
+  const char* trecho;
+  CodigoEvento codigo;
+  OrigemEvento origem;
+  uint32_t valor;
+  LeituraLegado leitura;
+};
+
+constexpr EquivalenciaLegado EQUIVALENCIAS_LEGADO[] = {
+  { "Sistema iniciado e configurado.",           EVT_SISTEMA_INICIADO,  ORIGEM_SISTEMA, 0, LEG_FIXO   },
+  { "Movimento detectado, disparando alarme",    EVT_ZONA_DISPARADA,    ORIGEM_PIR,     1, LEG_FIXO   },
+  { "Conexão Wi-Fi perdida.",                    EVT_WIFI_PERDIDO,      ORIGEM_SISTEMA, 0, LEG_FIXO   },
+  { "Sistema ARMADO com sucesso pela origem: ",  EVT_SISTEMA_ARMADO,    ORIGEM_SISTEMA, 0, LEG_ORIGEM },
+  { "Sistema DESARMADO com sucesso pela origem: ", EVT_SISTEMA_DESARMADO, ORIGEM_SISTEMA, 0, LEG_ORIGEM },
+  { "Código RF desconhecido recebido: ",         EVT_RF_DESCONHECIDO,   ORIGEM_RF,      0, LEG_NUMERO },
+};
+
+uint32_t legadoImportados = 0;                  // Linhas do log antigo convertidas no boot.
+uint32_t legadoSemEquivalente = 0;              // Linhas sem evento equivalente (descartadas).
+
+// --- Índice dos Segmentos e Exportação Incremental ---
+// Um resumo de cada segmento fica em RAM. Com ele, o `/logs` pula segmentos inteiros
+// e posiciona a leitura (`seek`) direto no primeiro registro que interessa, lendo só
+// os bytes necessários. A sequência do último registro exportado fica salva em flash.
+struct IndiceSegmento {
+  bool valido;
+  uint32_t sequenciaInicial;
+  uint32_t registros;
+  uint32_t primeiroInstante;  // Epoch do primeiro registro com relógio sincronizado (0 se nenhum).
+  uint32_t ultimoInstante;    // Epoch do último registro com relógio sincronizado (0 se nenhum).
+};
+
+IndiceSegmento indiceLog[LOG_SEGMENTOS];
+const char* LOG_EXPORTADO = "/log_exportado.bin"; // Sequência do próximo registro ainda não exportado.
+uint32_t proximaExportacao = 0;
+
+// Filtros aceitos pelo `/logs` (combináveis). Campos zerados não filtram.
+struct FiltroLogs {
+  uint32_t desde;             // `/logs desde <data|hora|2h>`: só registros a partir deste epoch.
+  uint32_t ultimos;           // `/logs ultimos <n>`: só os `n` registros mais recentes.
+  int8_t categoria;           // `/logs tipo <categoria>`: CategoriaEvento, ou -1 para todas.
+  bool novos;                 // `/logs novos`: só o que ainda não foi exportado.
+};
+
+const size_t LOG_MENSAGEM_MAX = 3500;           // Relatórios até este tamanho vão como mensagem, não documento.
+
+// O relatório não é gravado em lugar nenhum: o texto é montado direto dos segmentos, fatia
+// por fatia, à medida que o upload pede. Um cursor guarda onde a leitura parou. Como o
+// upload precisa do tamanho antes da primeira fatia, uma passada anterior só mede o texto.
+struct CursorLogs {
+  FiltroLogs filtro;
+  uint32_t sequencia;         // Próximo registro a ler.
+  uint32_t fim;               // Sequência em que a leitura para (fixada no pedido).
+  uint32_t pular;             // Registros aprovados que ainda serão ignorados (`ultimos`).
+  uint32_t registros;         // Registros aprovados já entregues.
+  char linha[160];            // Linha formatada que não coube inteira na última fatia.
+  uint8_t tamLinha;
+  uint8_t posLinha;           // Quanto de `linha` já foi entregue.
+};
+
+// --- Cache do Horário Formatado ---
+// O relatório percorre os registros em ordem, e os vizinhos quase sempre caem no mesmo
+// dia. O cache guarda o texto do último instante e o início do dia local: dentro do
+// mesmo dia, só os campos de hora, minuto e segundo são reescritos, sem `localtime_r()`
+// nem `strftime()`. Uma nova sincronização do NTP esvazia o cache. Usado apenas pela
+// tarefa de trabalho, ao gerar relatórios.
+struct CacheInstante {
+  uint32_t inicioDia;         // Epoch da meia-noite local do dia em cache (0 = vazio).
+  uint32_t ultimoMinuto;      // Minuto do dia (0..1439) de `texto`.
+  char texto[20];             // "AAAA-MM-DD HH:MM:SS" do último instante formatado.
+};
+
+CacheInstante cacheInstante = {};
+volatile bool relogioRessincronizado = false;   // Sinalizado pelo SNTP; esvazia o cache.
+
+// --- Gravação de Logs em Lotes ---
+// `logEvento()` só copia o registro para um buffer circular em RAM. A tarefa de gravação
+// (baixa prioridade) descarrega o buffer no segmento atual, que fica aberto entre as escritas,
+// quando acumula `LOG_LIMITE_REGISTROS`, a cada `LOG_INTERVALO_MS` ou num evento crítico.
+// Quem registra nunca grava na flash: os últimos `LOG_RESERVA_CRITICOS` lugares do buffer
+// ficam para os eventos críticos, que assim cabem mesmo com uma rajada de eventos comuns.
+const size_t LOG_BUFFER_REGISTROS = 256;        // Capacidade do buffer de logs em RAM (registros).
+const size_t LOG_LIMITE_REGISTROS = 64;         // Acúmulo que antecipa a gravação.
+const size_t LOG_RESERVA_CRITICOS = 32;         // Lugares que só os eventos críticos ocupam.
+const uint32_t LOG_INTERVALO_MS = 5000;         // Intervalo máximo entre gravações.
+const uint32_t LOG_STACK = 4096;                // Pilha da tarefa de gravação.
+const UBaseType_t LOG_PRIORIDADE = 1;           // Abaixo da tarefa de rede.
+
+RegistroLog bufferLog[LOG_BUFFER_REGISTROS];    // Buffer circular com os registros ainda não gravados.
+size_t inicioBufferLog = 0;                     // Posição do registro mais antigo ainda não gravado.
+size_t usadosBufferLog = 0;                     // Quantidade de registros aguardando gravação.
+uint32_t logsDescartados = 0;                   // Registros perdidos por buffer cheio.
+portMUX_TYPE muxBufferLog = portMUX_INITIALIZER_UNLOCKED; // Protege o buffer (usado pelos dois núcleos).
+#if SENTINELA_DIARIO_PARTICAO
+const esp_partition_t* particaoDiario = nullptr; // Partição do diário (nula se não existir).
+const uint8_t* mapaDiario = nullptr;            // Partição mapeada na memória, só leitura.
+esp_partition_mmap_handle_t handleMapaDiario;
+
+// Leitura sequencial de um segmento: aponta direto para o mapeamento da partição.
+struct LeitorSegmento {
+  const RegistroLog* registros;
+  size_t posicao;
+};
+#else
+File arquivoLog;                                // Segmento atual, mantido aberto pela tarefa de gravação.
+
+// Leitura sequencial de um segmento: lê blocos do arquivo para um buffer local.
+struct LeitorSegmento {
+  File arquivo;
+  RegistroLog bloco[16];
+};
+#endif
+TaskHandle_t tarefaLogHandle = nullptr;
+
+// --- Tabela de Controles RF ---
+// Cada código RF cadastrado tem uma função. A busca é O(1) numa tabela hash de
+// endereçamento aberto (sondagem linear), mantida abaixo de 75% de ocupação. A tabela
+// fica em RAM e é regravada no LittleFS só quando um controle é cadastrado.
+enum FuncaoControle : uint8_t {
+  RF_VAZIO,           // Posição livre na tabela.
+  RF_ARMAR,
+  RF_DESARMAR,
+  RF_PANICO,          // Dispara a sirene mesmo com o sistema desarmado.
+  RF_ZONA,            // Sensor RF (porta, janela): dispara com o sistema armado.
+  TOTAL_FUNCOES_RF
+};
+
+constexpr const char* NOMES_FUNCAO_RF[TOTAL_FUNCOES_RF] = {
+  "vazio",     // RF_VAZIO
+  "armar",     // RF_ARMAR
+  "desarmar",  // RF_DESARMAR
+  "panico",    // RF_PANICO
+  "zona",      // RF_ZONA
+};
+
+struct ControleRF {
+  uint32_t codigo;
+  FuncaoControle funcao;
+  uint8_t zona;        // Usado por RF_ZONA (1 a `TOTAL_ZONAS`).
+  uint16_t reservado;
+};
+
+struct CabecalhoControles {
+  uint32_t magia;      // `RF_MAGIA`; outro valor indica arquivo inválido.
+  uint16_t total;      // Registros `ControleRF` que seguem o cabeçalho.
+  uint16_t reservado;
+};
+
+const uint8_t RF_BITS_TABELA = 6;
+const size_t RF_TABELA_CAPACIDADE = 1 << RF_BITS_TABELA; // 64 posições.
+const size_t RF_MAX_CONTROLES = 48;              // 75% da capacidade.
+const uint32_t RF_MAGIA = 0x534E5246;            // "SNRF".
+const char* RF_ARQUIVO = "/controles_rf.bin";
+const uint32_t RF_TEMPO_APRENDIZADO_US = 30000000;  // Janela do `/aprender` (30 s).
+const uint32_t RF_PERIODO_DESCONHECIDOS_US = 600000000; // Agregação dos desconhecidos (10 min).
+
+#if SENTINELA_COM_RF
+ControleRF tabelaRF[RF_TABELA_CAPACIDADE];
+size_t totalControlesRF = 0;
+
+// Códigos desconhecidos (vizinhos, interferência) só incrementam contadores; um único
+// registro de log por período resume quantos chegaram.
+uint32_t rfDesconhecidosTotal = 0;              // Desde a inicialização.
+uint32_t rfDesconhecidosPeriodo = 0;            // No período atual (vai para o log).
+uint32_t inicioPeriodoRF = 0;                   // Instante (us) do primeiro desconhecido do período.
+uint32_t ultimoRFDesconhecido = 0;              // Último código desconhecido recebido.
+
+// Supressão de repetições: quadros iguais (código, protocolo e número de bits) separados
+// por menos de `RF_INTERVALO_RAJADA_US` pertencem à mesma rajada e geram um só evento.
+// O decodificador é lido por um `esp_timer` a cada `RF_AMOSTRAGEM_US`, não pelo loop: o
+// instante de cada quadro é o da recepção, e uma demora do loop não parte uma rajada em
+// duas (o que faria um toque armar e desarmar). Só o primeiro quadro vai para `filaRF`.
+const uint32_t RF_INTERVALO_RAJADA_US = 250000; // Silêncio que encerra uma rajada.
+const uint32_t RF_AMOSTRAGEM_US = 5000;         // Bem abaixo da duração de um quadro (~40 ms).
+const UBaseType_t TAMANHO_FILA_RF = 4;
+
+struct RajadaRF {
+  bool ativa;
+  uint32_t codigo;
+  uint8_t protocolo;
+  uint8_t bits;
+  uint32_t ultimoQuadroUs;   // `micros()` do último quadro da rajada.
+};
+
+struct QuadroRF {
+  uint32_t codigo;
+  uint8_t protocolo;
+  uint8_t bits;
+  uint32_t instanteUs;       // `micros()` da recepção.
+};
+
+RajadaRF rajadaRF = {};                         // Só a amostragem (`amostrarRF()`) usa.
+uint32_t rfRepeticoesSuprimidas = 0;            // Quadros descartados como repetição.
+QueueHandle_t filaRF = nullptr;                 // Amostragem -> loop: um quadro por rajada.
+esp_timer_handle_t amostradorRF = nullptr;
+
+bool aprendendoRF = false;                      // `true` durante a janela do `/aprender`.
+uint32_t inicioAprendizadoRF = 0;               // Instante (us) em que a janela abriu.
+FuncaoControle funcaoAprendizado = RF_VAZIO;    // Função do controle a ser cadastrado.
+uint8_t zonaAprendizado = 0;
+#endif
+
+// --- Comunicação entre Tarefas (FreeRTOS) ---
+// A tarefa de rede roda no núcleo 0 e é a única dona de `client` e `bot`.
+// O restante do firmware (loop, no núcleo 1) conversa com ela apenas por filas:
+// alertas entram em `filaAlertas`, as demais notificações em `filaNotificacoes`, e comandos
+// já interpretados saem em `filaComandos`.
+enum TipoComando : uint8_t {
+  CMD_ARMAR,
+  CMD_DESARMAR,
+  CMD_STATUS,
+  CMD_LOGS,
+  CMD_METRICAS,
+  CMD_APRENDER,
+  CMD_IGNORAR,
+  CMD_CANCELAR,
+  CMD_ATUALIZAR
+};
+
+const size_t OTA_URL_MAX = 160;                 // Endereço mais longo aceito pelo `/atualizar`.
+
+struct Comando {
+  TipoComando tipo;
+  OrigemEvento origem; // Canal por onde o comando chegou (Telegram ou MQTT).
+  FiltroLogs filtro;  // Usado por CMD_LOGS.
+  FuncaoControle funcaoRF; // Usado por CMD_APRENDER.
+  uint8_t zonaRF;          // Zona (1..TOTAL_ZONAS) de CMD_APRENDER com `RF_ZONA` e de CMD_IGNORAR.
+#if SENTINELA_COM_OTA
+  char url[OTA_URL_MAX];   // Usados por CMD_ATUALIZAR.
+  uint8_t sha256[32];
+#endif
+};
+
+enum TipoNotificacao : uint8_t {
+  NOTIF_TEXTO,        // Mensagem de texto comum para o chat.
+  NOTIF_ENVIAR_LOGS,  // Pedido de envio do arquivo de log.
+  NOTIF_METRICAS,     // Pedido de envio das métricas de desempenho.
+  NOTIF_INCIDENTE     // Mensagem do incidente em andamento, reescrita no lugar.
+};
+
+// Prioridade de envio. Alertas furam a fila e têm crédito reservado no balde de tokens;
+// mensagens informativas esperam uma janela e saem agrupadas num único resumo.
+enum PrioridadeNotificacao : uint8_t {
+  PRIO_ALERTA,        // Disparo do alarme: sai antes de qualquer outra mensagem.
+  PRIO_NORMAL,        // Respostas a comandos e mudanças de estado: saem na ordem de chegada.
+  PRIO_INFO           // Avisos repetitivos (reconexão, "já armado"): agrupados por janela.
+};
+
+const size_t NOTIF_TEXTO_MAX = 256;             // Capacidade do texto de uma notificação (bytes).
+const size_t STATUS_TEXTO_MAX = 640;            // Resposta do `/status`, enfileirada em partes.
+
+struct Notificacao {
+  TipoNotificacao tipo;
+  PrioridadeNotificacao prioridade;
+  bool markdown;      // `true` para enviar com parse_mode "Markdown".
+  FiltroLogs filtro;  // Usado por NOTIF_ENVIAR_LOGS.
+  uint32_t incidente; // Usado por NOTIF_INCIDENTE.
+  char texto[NOTIF_TEXTO_MAX];
+};
+
+const int REDE_CORE = 0;                        // Núcleo onde a tarefa de rede é fixada.
+const uint32_t REDE_STACK = 10240;              // Pilha da tarefa de rede (o TLS consome bastante).
+const UBaseType_t REDE_PRIORIDADE = 2;          // Prioridade da tarefa de rede.
+const UBaseType_t TAMANHO_FILA_ALERTAS = 4;
+const UBaseType_t TAMANHO_FILA_NOTIFICACOES = 8;
+const UBaseType_t TAMANHO_FILA_COMANDOS = 8;
+
+QueueHandle_t filaAlertas = nullptr;            // Núcleo 1 -> tarefa de rede (só PRIO_ALERTA).
+QueueHandle_t filaNotificacoes = nullptr;       // Núcleo 1 e polling -> tarefa de rede.
+QueueHandle_t filaComandos = nullptr;           // Tarefa de rede -> núcleo 1.
+SemaphoreHandle_t mutexLog = nullptr;           // Serializa o acesso ao arquivo de log (gravação e leitura).
+TaskHandle_t tarefaRedeHandle = nullptr;
+
+#if SENTINELA_COM_TELEGRAM
+// --- Operações Longas (tarefa de trabalho, núcleo 0) ---
+// A varredura do log e o upload do relatório podem levar dezenas de segundos. Eles rodam
+// numa tarefa própria, abaixo da de rede e com conexão TLS própria, então um alerta nunca
+// espera pelo upload. A operação alimenta o watchdog de tarefas, publica o progresso no
+// `/status` e pode ser interrompida pelo `/cancelar`. Enquanto houver um disparo ainda
+// não notificado, o upload fica parado entre duas fatias.
+enum TipoOperacao : uint8_t {
+  OP_ENVIAR_LOGS,     // Gera o relatório do `/logs` e o envia ao chat.
+  OP_ATUALIZAR_FIRMWARE // Baixa o firmware do `/atualizar` para a partição OTA inativa.
+};
+
+enum EtapaOperacao : uint8_t {
+  ETAPA_OCIOSA,
+  ETAPA_VARRENDO,     // Lendo os segmentos do log.
+  ETAPA_ENVIANDO,     // Enviando o relatório ao Telegram.
+  ETAPA_PAUSADA,      // Upload parado à espera de um alerta.
+  ETAPA_ATUALIZANDO   // Gravando o firmware novo.
+};
+
+struct OperacaoLonga {
+  TipoOperacao tipo;
+  FiltroLogs filtro;  // Usado por OP_ENVIAR_LOGS.
+#if SENTINELA_COM_OTA
+  char url[OTA_URL_MAX];   // Usados por OP_ATUALIZAR_FIRMWARE.
+  uint8_t sha256[32];
+#endif
+};
+
+const uint32_t TRABALHO_STACK = 8192;           // Pilha da tarefa de trabalho (o TLS consome bastante).
+const UBaseType_t TRABALHO_PRIORIDADE = 1;      // Abaixo da tarefa de rede.
+const UBaseType_t TAMANHO_FILA_OPERACOES = 1;   // Uma operação por vez; outro pedido é recusado.
+const uint32_t OPERACAO_PAUSA_MAX_MS = 20000;   // Pausa máxima por alerta (o servidor derruba uploads parados).
+const size_t OPERACAO_BLOCO = 512;              // Bytes por fatia do upload.
+
+QueueHandle_t filaOperacoes = nullptr;          // Tarefa de rede -> tarefa de trabalho.
+TaskHandle_t tarefaTrabalhoHandle = nullptr;
+volatile EtapaOperacao etapaOperacao = ETAPA_OCIOSA;
+volatile bool cancelarOperacao = false;         // Pedido do `/cancelar`, lido entre as fatias.
+volatile uint32_t progressoFeito = 0;           // Bytes enviados do relatório.
+volatile uint32_t progressoTotal = 0;           // Tamanho do relatório.
+CursorLogs cursorUpload;                        // Posição do relatório durante o upload.
+uint8_t blocoUpload[OPERACAO_BLOCO];            // Fatia entregue à biblioteca a cada chamada.
+int tamanhoBlocoUpload = 0;
+
+#if SENTINELA_COM_OTA
+// --- Atualização pelo Ar (A/B) ---
+// A imagem é gravada, fatia por fatia, na partição OTA que não está rodando, com o SHA-256
+// calculado no caminho; nada da imagem fica inteiro na RAM. Só depois de o hash conferir a
+// partição nova vira a de boot. No primeiro boot dela, o firmware fica em teste: precisa
+// chegar ao Telegram em `OTA_PRAZO_SAUDE_MS`, ou volta sozinho para a versão anterior
+// (o bootloader também reverte se ele reiniciar antes disso, por travamento ou watchdog).
+const uint16_t OTA_TIMEOUT_MS = 4000;           // Espera máxima por uma fatia (abaixo dos 5 s do watchdog).
+const uint32_t OTA_ESPERA_REINICIO_MS = 5000;   // Tempo para o aviso sair antes de reiniciar.
+const uint32_t OTA_ESPERA_MAX_REINICIO_MS = 15000; // Limite da espera por um disparo recém-acontecido.
+const char* NVS_CHAVE_OTA = "ota_alvo";         // Endereço da partição gravada, até o veredito.
+bool firmwareEmTeste = false;                   // Primeiro boot de uma imagem ainda não confirmada.
+#endif
+
+// --- Agendador de Envios ---
+// Um balde de tokens limita o ritmo de mensagens ao chat: cada envio gasta um token e um
+// novo token entra a cada `ENVIO_INTERVALO_TOKEN_MS` (20 por minuto, o limite do Telegram
+// para grupos e bem abaixo do limite de chats privados). Mensagens que não são alertas só
+// saem enquanto sobrar mais que `ENVIO_RESERVA_ALERTA` tokens, então um disparo nunca
+// encontra o chat em 429.
+const uint8_t ENVIO_CAPACIDADE_BALDE = 5;        // Rajada máxima de mensagens seguidas.
+const uint32_t ENVIO_INTERVALO_TOKEN_MS = 3000;  // Reposição de um token.
+const uint8_t ENVIO_RESERVA_ALERTA = 2;          // Tokens que só alertas podem gastar.
+const uint8_t ENVIO_MAX_TENTATIVAS_ALERTA = 10;  // Falhas seguidas, com conexão, antes de descartar um lote de alertas.
+const uint32_t ENVIO_ESPERA_FALHA_MS = 2000;     // Pausa após uma falha de envio.
+
+uint8_t tokensEnvio = ENVIO_CAPACIDADE_BALDE;    // Tokens disponíveis agora.
+uint32_t ultimaReposicaoTokens = 0;              // `millis()` da última reposição contabilizada.
+uint32_t inicioPausaEnvio = 0;                   // `millis()` da última falha de envio.
+bool envioPausado = false;                       // `true` durante a pausa após uma falha.
+
+// Mensagens PRIO_INFO ficam num resumo em RAM; textos repetidos só incrementam um contador.
+// O resumo sai `RESUMO_JANELA_MS` depois da primeira mensagem, ou antes se encher.
+const uint32_t RESUMO_JANELA_MS = 15000;         // Janela de agrupamento.
+const uint8_t RESUMO_MAX_ITENS = 6;              // Textos distintos por resumo.
+
+struct ItemResumo {
+  char texto[96];
+  uint16_t vezes;
+};
+
+ItemResumo itensResumo[RESUMO_MAX_ITENS];
+uint8_t totalItensResumo = 0;                    // Itens ocupados em `itensResumo`.
+uint32_t inicioJanelaResumo = 0;                 // `millis()` da primeira mensagem do resumo.
+uint16_t resumoExcedente = 0;                    // Avisos que não couberam no resumo.
+
+// --- Transportes das Notificações ---
+// Cada canal remoto é um `Transporte`, registrado por `iniciarTransportes()` em ordem de
+// preferência. A tarefa de rede entrega cada mensagem ao primeiro transporte disponível
+// e, se ele não confirmar a entrega, tenta o seguinte. Com o MQTT ligado, o broker local
+// vem primeiro (milissegundos na rede local, sem handshake TLS por sessão) e o Telegram
+// fica de reserva. Os comandos de qualquer canal passam por `interpretarComando()`.
+struct Transporte {
+  const char* nome;
+  bool (*disponivel)();                                     // Conectado e pronto para enviar.
+  bool (*enviar)(const char* texto, const char* parseMode); // `true` se o canal aceitou (MQTT: o PUBACK vem depois).
+  bool (*atualizar)(const char* texto, int& mensagem);      // Reescreve `mensagem` (0 = envia uma nova).
+  int mensagemFixa;                                         // Mensagem do incidente atual neste canal.
+  uint32_t envios;
+  uint32_t falhas;
+};
+
+const uint8_t MAX_TRANSPORTES = 2;
+Transporte transportes[MAX_TRANSPORTES];
+uint8_t totalTransportes = 0;
+uint32_t incidenteNaMensagem = 0;              // Incidente a que as `mensagemFixa` pertencem.
+
+// --- Tabela de Comandos Remotos ---
+// Os comandos ficam numa tabela constante (`COMANDOS_REMOTOS`, junto dos handlers) com um
+// índice de hash perfeito calculado pelo compilador: achar o comando custa um hash do nome
+// e uma comparação, sem alocar nada. Cada entrada diz por quais canais o comando é aceito;
+// pelo Telegram, só mensagens do `CHAT_ID` chegam até a tabela.
+constexpr uint8_t VIA_TELEGRAM = 1 << ORIGEM_TELEGRAM;
+constexpr uint8_t VIA_MQTT = 1 << ORIGEM_MQTT;
+
+struct DefinicaoComando {
+  const char* nome;                                    // Sem a barra ("armar", "logs"...).
+  TipoComando tipo;
+  bool (*interpretar)(const char* args, Comando& cmd); // nullptr: comando sem argumentos.
+  const char* uso;                                     // Resposta a argumentos inválidos.
+  uint8_t origens;                                     // VIA_TELEGRAM e/ou VIA_MQTT.
+  bool apelido;                                        // Nome alternativo, fora da ajuda.
+};
+
+const size_t POSICOES_INDICE_COMANDOS = 32;    // Potência de 2, maior que a tabela.
+
+struct IndiceComandos {
+  uint32_t semente;                            // Semente do hash sem colisões.
+  int8_t posicao[POSICOES_INDICE_COMANDOS];    // Entrada em `COMANDOS_REMOTOS`, ou -1.
+};
+
+#if SENTINELA_COM_MQTT
+// O cliente do ESP-IDF roda numa tarefa própria, mantém a sessão (clean session desligado)
+// e reenvia as publicações QoS 1 sem PUBACK. Eventos saem em `<prefixo>/eventos`; comandos
+// chegam em `<prefixo>/comandos` com o mesmo texto do Telegram ("/armar", "/status"...);
+// `<prefixo>/estado` fica retido com "online", ou "offline" pelo testamento do broker.
+// Publicar só põe a mensagem na fila do cliente (`esp_mqtt_client_enqueue`): a tarefa de
+// rede não espera pelo broker. O PUBACK chega depois (`MQTT_EVENT_PUBLISHED`) e é conferido
+// por `processarPubacks()`. Uma publicação sem PUBACK em `MQTT_ESPERA_PUBACK_MS` tira o
+// MQTT da frente por `MQTT_PAUSA_SEM_PUBACK_MS`, e as mensagens seguintes vão pelo Telegram.
+// A própria mensagem também: cada publicação acompanhada guarda uma cópia dela, que volta
+// para a fila de notificações (o lote da caixa de saída volta a sair da flash). Se o PUBACK
+// só estava atrasado, a mensagem chega pelos dois canais: a entrega é "ao menos uma vez".
+const uint32_t MQTT_ESPERA_PUBACK_MS = 1000;     // Prazo do PUBACK de cada publicação.
+const uint32_t MQTT_PAUSA_SEM_PUBACK_MS = 30000; // MQTT fora da frente depois de um PUBACK perdido.
+const size_t MQTT_COMANDO_MAX = 128;             // Maior comando aceito no tópico de comandos.
+const UBaseType_t TAMANHO_FILA_PUBACKS = 8;
+const uint8_t MQTT_MAX_PENDENTES = 8;            // Publicações acompanhadas à espera do PUBACK.
+
+struct PublicacaoMqtt {
+  bool ativa;
+  int msgId;
+  uint32_t inicioUs;        // `micros()` da publicação, para `MET_MQTT_PUBACK`.
+  Notificacao reenvio;      // Devolvida à fila se o PUBACK não chegar no prazo.
+};
+
+esp_mqtt_client_handle_t clienteMqtt = nullptr;
+QueueHandle_t filaPubacks = nullptr;             // `msg_id` confirmados pelo broker (tarefa MQTT -> rede).
+volatile bool mqttConectado = false;
+uint32_t mqttConexoes = 0;                       // Sessões abertas com o broker desde o boot.
+PublicacaoMqtt publicacoesMqtt[MQTT_MAX_PENDENTES]; // Só a tarefa de rede usa.
+int ultimaPublicacaoMqtt = -1;                   // `msg_id` do último envio aceito pelo MQTT (-1: outro canal).
+bool mqttSemPuback = false;                      // Um PUBACK estourou o prazo; vale até `inicioSemPubackMs`.
+uint32_t inicioSemPubackMs = 0;
+uint32_t pubacksPerdidos = 0;
+int loteSaidaMqtt = -1;                          // Lote da caixa de saída esperando o PUBACK (`msg_id`).
+uint32_t fimLoteSaidaMqtt = 0;                   // Sequência que esse PUBACK confirma.
+#endif
+
+
+// --- Caixa de Saída Persistente (alertas) ---
+// Antes de qualquer tentativa de envio, a tarefa de rede grava cada alerta num anel de
+// tamanho fixo no LittleFS (uma escrita por alerta), com número de sequência. O anel sai
+// em ordem quando há conexão, vários alertas por mensagem, e a última sequência entregue
+// fica num arquivo à parte: as posições confirmadas voltam a ficar livres para novos
+// alertas. Uma queda do Wi-Fi ou um reinício não perdem nenhum alerta.
+const char* SAIDA_ARQUIVO = "/caixa_saida.bin";
+const char* SAIDA_CONFIRMADOS = "/caixa_saida_ok.bin"; // Última sequência entregue ao chat.
+const uint8_t SAIDA_CAPACIDADE = 64;             // Alertas guardados à espera de envio.
+const size_t SAIDA_TEXTO_MAX = 176;              // Texto de um alerta (registro de 192 bytes).
+const uint8_t SAIDA_POR_MENSAGEM = 25;           // Alertas juntados numa única mensagem.
+const size_t SAIDA_MENSAGEM_MAX = 3500;          // Tamanho máximo dessa mensagem (bytes).
+
+struct RegistroSaida {
+  uint32_t sequencia;         // 0 = posição nunca usada.
+  uint32_t instante;          // Epoch Unix, ou segundos desde o boot sem `REG_RELOGIO_SINCRONIZADO`.
+  uint8_t flags;
+  uint8_t reservado[3];
+  uint32_t soma;              // FNV-1a do registro: descarta uma escrita interrompida.
+  char texto[SAIDA_TEXTO_MAX];
+};
+
+volatile uint32_t proximaSequenciaSaida = 1;     // Sequência do próximo alerta gravado.
+volatile uint32_t ultimaConfirmadaSaida = 0;     // Última sequência entregue (lida pela tarefa de trabalho).
+uint32_t alertasDescartados = 0;                 // Sobrescritos com o anel cheio ou recusados pelo Telegram.
+uint8_t falhasSaida = 0;                         // Falhas seguidas do lote atual com a conexão de pé.
+#endif
+
+// --- Eventos de Entrada (ISR -> loop) ---
+// As interrupções das zonas com GPIO e do botão publicam cada borda, com o instante em
+// microssegundos, num buffer circular de produtor único / consumidor único.
+// As ISRs são despachadas pelo mesmo tratador de GPIO do núcleo 1 e nunca
+// se sobrepõem, então funcionam como um só produtor; o loop é o único consumidor.
+enum TipoEntrada : uint8_t {
+  ENTRADA_ZONA,
+  ENTRADA_BOTAO
+};
+
+struct EventoEntrada {
+  uint32_t instanteUs;  // `micros()` no momento da borda.
+  TipoEntrada tipo;
+  uint8_t zona;         // Índice da zona, em ENTRADA_ZONA.
+  uint8_t nivel;        // Nível do pino logo após a borda (HIGH/LOW).
+};
+
+const uint32_t TAMANHO_BUFFER_ENTRADAS = 64;    // Precisa ser potência de 2.
+const uint32_t DEBOUNCE_BOTAO_US = 50000;       // Tempo (em us) que o botão precisa ficar estável.
+
+EventoEntrada bufferEntradas[TAMANHO_BUFFER_ENTRADAS];
+std::atomic<uint32_t> cabecaEntradas(0);        // Próxima posição a ser escrita (só a ISR altera).
+std::atomic<uint32_t> caudaEntradas(0);         // Próxima posição a ser lida (só o loop altera).
+volatile uint32_t entradasPerdidas = 0;         // Bordas descartadas por buffer cheio.
+
+// --- Acesso Direto aos GPIOs ---
+// Pinos fixos em tempo de compilação viram tipos: `PinoGPIO<RELAY_PIN>::escrever()` é
+// uma única escrita no registrador W1TS/W1TC do banco certo, sem a consulta de tabelas
+// e as verificações que `digitalWrite()` e `digitalRead()` fazem a cada chamada.
+template <int PINO>
+struct PinoGPIO {
+  static_assert(PINO >= 0 && PINO < 40, "GPIO inexistente no ESP32.");
+  static constexpr uint32_t MASCARA = 1u << (PINO % 32);
+
+  static inline bool ler(){
+    if constexpr(PINO < 32) return (REG_READ(GPIO_IN_REG) & MASCARA) != 0;
+    else return (REG_READ(GPIO_IN1_REG) & MASCARA) != 0;
+  }
+
+  static inline void escrever(bool nivel){
+    if constexpr(PINO < 32) REG_WRITE(nivel ? GPIO_OUT_W1TS_REG : GPIO_OUT_W1TC_REG, MASCARA);
+    else REG_WRITE(nivel ? GPIO_OUT1_W1TS_REG : GPIO_OUT1_W1TC_REG, MASCARA);
+  }
+};
+
+using PinoRele = PinoGPIO<RELAY_PIN>;
+
+// --- Escalonador Cooperativo (núcleo 1) ---
+// O loop não gira sem parar: cada verificação é um trabalho com prazo. A cada passada,
+// os trabalhos vencidos rodam em ordem de prioridade (sensores antes dos comandos que
+// chegam da rede) e o loop dorme até o próximo prazo, liberando a CPU para a tarefa
+// ociosa. Uma borda de zona ou do botão acorda o loop na hora, pela notificação da ISR.
+enum PrioridadeTrabalho : uint8_t {
+  TRAB_SENSORES,      // Zonas, botão e RF: o caminho da sirene.
+  TRAB_ALARME,        // Segundo estágio do disparo (notificação e log).
+  TRAB_COMANDOS       // Comandos vindos da rede.
+};
+
+struct Trabalho {
+  const char* nome;
+  void (*funcao)();
+  uint32_t periodoUs;     // 0 = execução única, agendada com `agendarTrabalho()`.
+  uint32_t orcamentoUs;   // Duração máxima esperada de uma execução.
+  PrioridadeTrabalho prioridade;
+  bool agendado;          // `true` se há uma execução pendente em `prazoUs`.
+  uint32_t prazoUs;       // Instante (us) da próxima execução.
+  uint32_t execucoes;
+  uint32_t estouros;      // Execuções que passaram do orçamento.
+  uint32_t maiorUs;       // Execução mais longa.
+};
 
-// --- Arquivo de Log ---
-const char* LOG_FILE = "/log_sentinela.txt";    // Nome do arquivo onde os logs serão salvos no LittleFS.
+const uint8_t MAX_TRABALHOS = 8;
+const uint32_t ESCALONADOR_ESPERA_MAX_US = 100000; // Teto do sono entre passadas.
+
+Trabalho trabalhos[MAX_TRABALHOS];
+uint8_t totalTrabalhos = 0;
+uint8_t idTrabalhoEntradas = 0;                 // Reagendado na hora quando uma ISR acorda o loop.
+uint8_t idTrabalhoDisparo = 0;                  // Execução única agendada por `dispararAlarme()`.
+
+// --- Economia de Energia ---
+// Com `SENTINELA_ECONOMIA_ENERGIA`, o clock cai para `ECONOMIA_FREQ_MIN_MHZ` quando nada
+// roda e o Wi-Fi fica em modem-sleep: o rádio só liga a cada poucos beacons (DTIM), o que
+// atrasa a chegada de um comando em algumas centenas de ms, mas não os envios. Sem o
+// receptor RF, o chip ainda entra em sono leve sempre que as duas CPUs ficam ociosas
+// (exige `CONFIG_FREERTOS_USE_TICKLESS_IDLE` no sdkconfig; sem ela, fica só o clock
+// dinâmico), e as zonas e o botão o acordam. Com RF, o sono leve fica desligado: a linha
+// de dados do receptor tem ruído o tempo todo e o RCSwitch precisa de cada borda dela.
+// Caminho do alarme: a borda acorda o chip e o loop na hora (ISR -> notificação). O que se
+// mede é ISR -> relé: o carimbo da borda é tomado na ISR, que só roda depois que o chip
+// acordou, então o despertar do sono leve (a religação dos clocks e da flash) fica de fora
+// da medida. As métricas comparam ISR -> relé com `ECONOMIA_LATENCIA_MAX_US` e dizem se o
+// despertar estava incluído (só sem sono leve, quando a ISR roda logo depois da borda).
+constexpr bool ECONOMIA_ENERGIA = SENTINELA_ECONOMIA_ENERGIA;
+constexpr bool ECONOMIA_SONO_LEVE = ECONOMIA_ENERGIA && !SENTINELA_COM_RF;
+const uint32_t PERIODO_SENSORES_US = ECONOMIA_ENERGIA ? 50000 : 10000; // Debounce, atrasos e RF (as bordas não esperam por ele).
+const uint32_t REDE_ESPERA_MS = ECONOMIA_ENERGIA ? 500 : 100;         // Sono da tarefa de rede sem alertas novos.
+const uint32_t ECONOMIA_FREQ_MIN_MHZ = 80;       // Clock com as CPUs ociosas.
+const uint32_t ECONOMIA_LATENCIA_MAX_US = 2000;  // Limite declarado de ISR -> relé (sem o despertar).
+
+esp_pm_lock_handle_t travaSirene = nullptr;      // Impede o sono leve enquanto a sirene toca.
+bool sonoLeveAtivo = false;                      // `true` se o ESP-IDF aceitou o sono leve automático.
+uint64_t loopDormindoUs = 0;                     // Tempo do loop na espera (o ciclo ativo é o resto).
+uint32_t despertaresBorda = 0;                   // Esperas encerradas por uma ISR.
+uint32_t despertaresPrazo = 0;                   // Esperas encerradas pelo prazo de um trabalho.
+
+#if SENTINELA_TELEMETRIA
+// --- Telemetria da Frota ---
+// A cada `TELEMETRIA_INTERVALO_S`, a tarefa de rede junta o estado e os contadores num
+// único mapa CBOR (RFC 8949) com chaves inteiras, de pouco mais de 100 bytes: um datagrama
+// por unidade por minuto, sem TLS. As chaves nunca mudam de significado; campos novos
+// ganham chaves novas e o coletor ignora as que não conhece. `TEL_QUADRO` cresce a cada
+// quadro, então o coletor percebe perdas e reinícios (`TEL_UPTIME_S` volta a zero).
+enum ChaveTelemetria : uint8_t {
+  TEL_VERSAO,            // Versão do formato (`TELEMETRIA_VERSAO`).
+  TEL_DISPOSITIVO,       // MAC da unidade (identifica a unidade na frota).
+  TEL_QUADRO,            // Número do quadro desde o boot.
+  TEL_UPTIME_S,
+  TEL_ESTADO,            // EstadoAlarme (disparado = `ALARME_DISPARADO`).
+  TEL_ZONAS_ABERTAS,     // Máscara de bits.
+  TEL_ZONAS_DISPARADAS,  // Máscara de bits.
+  TEL_RSSI,              // dBm.
+  TEL_HEAP_LIVRE,
+  TEL_HEAP_MINIMO,       // Marca d'água do heap desde o boot.
+  TEL_SEQUENCIA_LOG,     // Sequência do próximo registro do log.
+  TEL_METRICAS,          // [[amostras, max_us], ...] na ordem de `MetricaTempo`.
+  TEL_PERDAS,            // [logs, entradas, alertas] descartados.
+  TEL_WIFI_QUEDAS,
+  TOTAL_CHAVES_TELEMETRIA
+};
+
+const uint8_t TELEMETRIA_VERSAO = 1;
+const size_t TELEMETRIA_QUADRO_MAX = 256;        // Bytes; o quadro atual fica bem abaixo.
+
+// Tipos maiores do CBOR usados nos quadros.
+const uint8_t CBOR_INTEIRO = 0;
+const uint8_t CBOR_NEGATIVO = 1;
+const uint8_t CBOR_LISTA = 4;
+const uint8_t CBOR_MAPA = 5;
+
+// Escreve CBOR num buffer fixo. `pos` continua contando além de `tam`: o estouro é
+// percebido no fim, sem checagem a cada campo.
+struct EscritorCbor {
+  uint8_t* dados;
+  size_t tam;
+  size_t pos;
+};
+
+WiFiUDP udpTelemetria;
+uint32_t quadrosTelemetria = 0;                  // Quadros montados desde o boot.
+uint32_t falhasTelemetria = 0;                   // Quadros que o coletor não recebeu (ou recusou).
+uint32_t ultimaTelemetriaMs = 0;                 // `millis()` do último quadro.
+#endif
 
 
 // =================================================================================
@@ -89,11 +1340,13 @@ const char* LOG_FILE = "/log_sentinela.txt";    // Nome do arquivo onde os logs
 // do servidor do Telegram. Sem um certificado válido, a conexão segura (HTTPS) falhará.
 // Este certificado pode expirar. Se a comunicação com o Telegram parar,
 // obtenha um novo certificado para "api.telegram.org".
+#if SENTINELA_COM_TELEGRAM
 const char TELEGRAM_CERTIFICATE_ROOT[] PROGMEM = R"EOF(
 -----BEGIN CERTIFICATE-----
 MIID... (COLE SEU CERTIFICADO ROOT CA VÁLIDO AQUI)
 -----END CERTIFICATE-----
 )EOF";
+#endif
 
 
 // =================================================================================
@@ -102,34 +1355,122 @@ MIID... (COLE SEU CERTIFICADO ROOT CA VÁLIDO AQUI)
 void setup() {
   // Inicia a comunicação serial para debug via monitor serial.
   Serial.begin(115200);
+  tarefaLoopHandle = xTaskGetCurrentTaskHandle(); // Para a marca d'água da pilha do loop.
+
+  // Cria as filas e o mutex antes de qualquer log ou comunicação entre tarefas.
+  mutexLog = xSemaphoreCreateMutex();
+#if SENTINELA_COM_TELEGRAM
+  filaAlertas = xQueueCreate(TAMANHO_FILA_ALERTAS, sizeof(Notificacao));
+  filaNotificacoes = xQueueCreate(TAMANHO_FILA_NOTIFICACOES, sizeof(Notificacao));
+  filaComandos = xQueueCreate(TAMANHO_FILA_COMANDOS, sizeof(Comando));
+  filaOperacoes = xQueueCreate(TAMANHO_FILA_OPERACOES, sizeof(OperacaoLonga));
+#endif
+
+  // --- Estágio 1: proteção. Nada aqui depende da rede ou do sistema de arquivos. ---
 
   // Configura os pinos de hardware.
-  pinMode(PIR_PIN, INPUT);          // Pino do sensor PIR como entrada.
   pinMode(RELAY_PIN, OUTPUT);       // Pino do relé como saída.
-  digitalWrite(RELAY_PIN, LOW);     // Garante que a sirene comece desligada.
+  PinoRele::escrever(false);        // Garante que a sirene comece desligada.
+#if SENTINELA_COM_BOTAO
   pinMode(BUTTON_PIN, INPUT_PULLUP);// Pino do botão como entrada com resistor de pull-up interno.
+#endif
 
-  // Inicializa o sistema de arquivos LittleFS.
-  if(!LittleFS.begin()){
-    Serial.println("Erro crítico ao iniciar o LittleFS.");
+  // Monta a tabela de zonas e configura os pinos dos sensores.
+  iniciarZonas();
+
+  // Restaura o instantâneo do estado: da RTC (sem flash) ou da NVS (poucos milissegundos).
+  restaurarEstado();
+
+  // Liga as interrupções de borda. A partir daqui nenhuma transição é perdida,
+  // mesmo que o loop demore para passar pela verificação das entradas.
+  for(uint8_t z = 0; z < TOTAL_ZONAS; z++){
+    if(pinoZona[z] >= 0){
+      attachInterruptArg(digitalPinToInterrupt(pinoZona[z]), isrZona, (void*)(uintptr_t)z, CHANGE);
+    }
   }
+#if SENTINELA_COM_BOTAO
+  attachInterrupt(digitalPinToInterrupt(BUTTON_PIN), isrBotao, CHANGE);
+#endif
+  iniciarEconomiaEnergia(); // Sem efeito fora do modo de baixo consumo.
+  manterAcordado(estadoAlarme == ALARME_DISPARADO); // Sirene religada pelo instantâneo.
 
+#if SENTINELA_COM_RF
   // Ativa o receptor de RF no pino configurado.
   rfReceiver.enableReceive(RF_RECEIVER_PIN);
+  filaRF = xQueueCreate(TAMANHO_FILA_RF, sizeof(QuadroRF));
+  esp_timer_create_args_t amostragem = {};
+  amostragem.callback = amostrarRF;
+  amostragem.name = "rf";
+  esp_timer_create(&amostragem, &amostradorRF);
+  esp_timer_start_periodic(amostradorRF, RF_AMOSTRAGEM_US);
+#endif
 
-  // Tenta conectar ao Wi-Fi. Esta função é bloqueante na primeira execução.
-  conectaWiFi();
+  // Registra os trabalhos do loop: verificações periódicas e o disparo (execução única).
+  idTrabalhoEntradas = registrarTrabalho("entradas", trabalhoEntradas, PERIODO_SENSORES_US, 25000, TRAB_SENSORES);
+#if SENTINELA_COM_RF
+  registrarTrabalho("rf", checarRF, PERIODO_SENSORES_US, 25000, TRAB_SENSORES);
+#endif
+  idTrabalhoDisparo = registrarTrabalho("disparo", concluirDisparo, 0, 5000, TRAB_ALARME);
+  registrarTrabalho("incidente", verificarIncidente, 1000000, 5000, TRAB_ALARME);
+  registrarTrabalho("estado", verificarInstantaneo, 1000000, 25000, TRAB_ALARME);
+#if SENTINELA_COM_TELEGRAM
+  registrarTrabalho("comandos", checarComandos, 20000, 25000, TRAB_COMANDOS);
+#endif
+  bootProtegidoMs = millis();
 
-  // Sincroniza o relógio interno do ESP32 com um servidor de tempo na internet (NTP).
-  // GMT-3 (fuso de Brasília), 0 para horário de verão, "pool.ntp.org" é o servidor.
-  // Essencial para que os timestamps nos logs estejam corretos.
-  configTime(-3 * 3600, 0, "pool.ntp.org");
+  // --- Estágio 2: logs. Os eventos acima já podem ser registrados no buffer. ---
 
-  // Associa o certificado de segurança ao cliente Wi-Fi.
-  client.setCACert(TELEGRAM_CERTIFICATE_ROOT);
+  // Inicializa o sistema de arquivos LittleFS.
+  if(!LittleFS.begin()){
+    Serial.println("Erro crítico ao iniciar o LittleFS.");
+  }
+
+  // Localiza o segmento de log atual e inicia a tarefa que grava os logs em lotes,
+  // garantindo a gravação antes de reinícios.
+  iniciarLogs();
+#if SENTINELA_COM_TELEGRAM
+  iniciarCaixaSaida(); // Alertas que não saíram antes do reinício voltam para a fila de envio.
+#endif
+#if SENTINELA_COM_RF
+  carregarControlesRF(); // Antes do loop: nenhum código RF é tratado até aqui.
+#endif
+  xTaskCreatePinnedToCore(tarefaLog, "log", LOG_STACK, nullptr, LOG_PRIORIDADE,
+                          &tarefaLogHandle, REDE_CORE);
+  esp_register_shutdown_handler(descarregarLogsAoReiniciar);
 
   // Registra o primeiro evento no log.
-  logEvento("Sistema iniciado e configurado.");
+  logEvento(EVT_SISTEMA_INICIADO, ORIGEM_SISTEMA, 0);
+  logEvento(EVT_BOOT_PROTEGIDO, ORIGEM_SISTEMA, bootProtegidoMs);
+  if(estadoAlarme == ALARME_DISPARADO){
+    uint32_t zona = causaDisparo == CAUSA_PANICO ? 0 : zonaDisparo + 1;
+    logEventoCritico(EVT_DISPARO_RESTAURADO, ORIGEM_SISTEMA, zona);
+    notificar("🚨 Sentinela reiniciado durante um disparo: sirene religada. Use /desarmar para parar.", false, PRIO_ALERTA);
+  } else if(sistemaArmado()){
+    logEventoCritico(EVT_ESTADO_RESTAURADO, ORIGEM_SISTEMA, 0);
+    notificar("🔒 Sentinela reiniciado: sistema restaurado como ARMADO.", false, PRIO_NORMAL);
+  }
+  if(legadoImportados > 0 || legadoSemEquivalente > 0){
+    char aviso[NOTIF_TEXTO_MAX];
+    snprintf(aviso, sizeof(aviso), "🗂️ Log antigo convertido para o novo formato: %lu eventos importados, "
+             "%lu linhas sem equivalente descartadas.", (unsigned long)legadoImportados,
+             (unsigned long)legadoSemEquivalente);
+    notificar(aviso, false, PRIO_INFO);
+  }
+#if SENTINELA_COM_OTA
+  iniciarVerificacaoFirmware(); // Imagem nova em teste, ou revertida no boot anterior?
+#endif
+
+  // --- Estágio 3: rede. Wi-Fi, NTP e Telegram sobem em segundo plano, no núcleo 0. ---
+
+  // Inicia a tarefa de rede no núcleo 0. A partir daqui, somente ela usa `client` e `bot`.
+  xTaskCreatePinnedToCore(tarefaRede, "rede", REDE_STACK, nullptr, REDE_PRIORIDADE,
+                          &tarefaRedeHandle, REDE_CORE);
+#if SENTINELA_COM_TELEGRAM
+  xTaskCreatePinnedToCore(tarefaPolling, "polling", POLLING_STACK, nullptr, REDE_PRIORIDADE,
+                          &tarefaPollingHandle, REDE_CORE);
+  xTaskCreatePinnedToCore(tarefaTrabalho, "trabalho", TRABALHO_STACK, nullptr, TRABALHO_PRIORIDADE,
+                          &tarefaTrabalhoHandle, REDE_CORE);
+#endif
 
   Serial.println("Setup concluído. Sentinela operacional.");
 }
@@ -139,275 +1480,4317 @@ void setup() {
 // --- FUNÇÃO LOOP: Executada repetidamente após o setup ---
 // =================================================================================
 void loop() {
-  // Funções de verificação contínua (polling).
-  checarWiFi();      // Monitora e tenta reconectar o Wi-Fi se necessário.
-  checarTelegram();  // Verifica se há novos comandos via Telegram.
-  checarRF();        // Verifica se há novos comandos via controle RF.
-  checarBotao();     // Verifica se o botão físico foi pressionado.
+  // Roda os trabalhos vencidos. Nenhum deles acessa a rede:
+  // Wi-Fi e Telegram são tratados pelas tarefas do núcleo 0.
+  uint32_t inicioVolta = micros();
+  executarTrabalhosVencidos();
+  registrarMetrica(MET_LOOP, micros() - inicioVolta);
 
-  // Lógica principal de detecção de movimento.
-  // Se o sistema está ativo (armado), o alarme ainda não foi disparado, e o sensor PIR detecta movimento...
-  if (sistemaAtivo && !alarmeDisparado && digitalRead(PIR_PIN) == HIGH) {
-    logEvento("Movimento detectado, disparando alarme");
-    dispararAlarme(); // ...então, dispara o alarme.
+  // Dorme até o próximo prazo. Uma borda notificada pela ISR encerra o sono e
+  // antecipa o trabalho das entradas (o caminho da sirene).
+  uint32_t esperaUs = esperaAteProximoPrazo();
+  uint32_t inicioEspera = micros();
+  bool acordouPorBorda = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(esperaUs / 1000)) > 0;
+  registrarEspera(micros() - inicioEspera, acordouPorBorda);
+  if(acordouPorBorda){
+    agendarTrabalho(idTrabalhoEntradas, 0);
   }
 }
 
+/**
+ * @brief Trabalho das entradas: esvazia o buffer das ISRs e avança a máquina de estados.
+ */
+void trabalhoEntradas(){
+  checarEntradas();  // Processa as bordas das zonas e do botão.
+  avaliarZonas();    // Avança a máquina de estados do alarme com as zonas acionadas.
+}
+
 
 // =================================================================================
-// --- FUNÇÕES DE VERIFICAÇÃO E CONTROLE ---
+// --- ESCALONADOR COOPERATIVO ---
 // =================================================================================
 
 /**
- * @brief Verifica o status da conexão Wi-Fi em intervalos regulares.
+ * @brief Registra um trabalho do loop. Chamada só no `setup()`.
+ * @param periodoUs Intervalo entre execuções; 0 para um trabalho de execução única.
+ * @param orcamentoUs Duração acima da qual uma execução conta como estouro.
+ * @return O identificador do trabalho, usado por `agendarTrabalho()`.
  */
-void checarWiFi(){
-  if(millis() - lastWiFiCheck > wifiCheckInterval){
-    lastWiFiCheck = millis(); // Reseta o contador de tempo.
+uint8_t registrarTrabalho(const char* nome, void (*funcao)(), uint32_t periodoUs, uint32_t orcamentoUs, PrioridadeTrabalho prioridade){
+  if(totalTrabalhos >= MAX_TRABALHOS){
+    Serial.printf("Erro: trabalho %s não registrado (limite de %u).\n", nome, (unsigned)MAX_TRABALHOS);
+    return MAX_TRABALHOS - 1;
+  }
+  Trabalho& t = trabalhos[totalTrabalhos];
+  t.nome = nome;
+  t.funcao = funcao;
+  t.periodoUs = periodoUs;
+  t.orcamentoUs = orcamentoUs;
+  t.prioridade = prioridade;
+  t.agendado = periodoUs > 0; // Os periódicos começam na primeira passada.
+  t.prazoUs = micros();
+  t.execucoes = 0;
+  t.estouros = 0;
+  t.maiorUs = 0;
+  return totalTrabalhos++;
+}
 
-    if(WiFi.status() != WL_CONNECTED){
-      if(wifiConectadoAnterior){ // Se estava conectado e caiu...
-        logEvento("Conexão Wi-Fi perdida.");
-      }
-      wifiConectadoAnterior = false;
-      conectaWiFi(); // Tenta reconectar.
-    } else {
-      if(!wifiConectadoAnterior){ // Se estava desconectado e conseguiu reconectar...
-        logEvento("Conexão Wi-Fi restabelecida.");
-        bot.sendMessage(CHAT_ID, "✅ Sentinela: Conexão Wi-Fi restabelecida!", "");
-      }
-      wifiConectadoAnterior = true;
-    }
+/**
+ * @brief Agenda (ou antecipa) a execução de um trabalho.
+ * @param atrasoUs Daqui a quanto tempo; 0 para a próxima passada.
+ */
+void agendarTrabalho(uint8_t id, uint32_t atrasoUs){
+  Trabalho& t = trabalhos[id];
+  uint32_t prazo = micros() + atrasoUs;
+  if(!t.agendado || (int32_t)(prazo - t.prazoUs) < 0){
+    t.prazoUs = prazo;
   }
+  t.agendado = true;
 }
 
 /**
- * @brief Tenta se conectar à rede Wi-Fi configurada.
+ * @brief Roda, um por vez, o trabalho vencido de maior prioridade até não sobrar nenhum.
+ * A lista é revista após cada execução, então um sensor que vence durante um trabalho
+ * longo passa à frente dos que já esperavam.
  */
-void conectaWiFi(){
-  if(WiFi.status() != WL_CONNECTED){
-    WiFi.begin(ssid, password);
-    Serial.print("Conectando ao WiFi");
-    unsigned long startAttemptTime = millis();
-    // Tenta por 15 segundos antes de desistir temporariamente.
-    while(WiFi.status() != WL_CONNECTED && millis() - startAttemptTime < 15000){
-      delay(500);
-      Serial.print(".");
+void executarTrabalhosVencidos(){
+  for(uint8_t rodadas = 0; rodadas < 2 * MAX_TRABALHOS; rodadas++){
+    uint32_t agora = micros();
+    int8_t escolhido = -1;
+    for(uint8_t i = 0; i < totalTrabalhos; i++){
+      const Trabalho& t = trabalhos[i];
+      if(t.agendado && (int32_t)(agora - t.prazoUs) >= 0 &&
+         (escolhido < 0 || t.prioridade < trabalhos[escolhido].prioridade)){
+        escolhido = i;
+      }
+    }
+    if(escolhido < 0){
+      return;
     }
-    Serial.println();
 
-    if(WiFi.status() == WL_CONNECTED){
-      Serial.println("WiFi conectado com sucesso.");
-      logEvento("WiFi conectado.");
-      wifiConectadoAnterior = true;
+    Trabalho& t = trabalhos[escolhido];
+    if(t.periodoUs > 0){
+      t.prazoUs += t.periodoUs;
+      if((int32_t)(agora - t.prazoUs) >= 0){
+        t.prazoUs = agora + t.periodoUs; // Atrasou mais de um período: não tenta recuperar.
+      }
     } else {
-      Serial.println("Falha ao conectar no WiFi.");
-      logEvento("Falha na conexão WiFi.");
+      t.agendado = false;
     }
-  }
-}
 
-/**
- * @brief Verifica se há novas mensagens do Telegram.
- */
-void checarTelegram(){
-  // Só executa se o WiFi estiver conectado e o intervalo de tempo tiver passado.
-  if (millis() - lastMsgTime > msgInterval && WiFi.status() == WL_CONNECTED) {
-    // Pede ao bot por novas mensagens.
-    int numNewMessages = bot.getUpdates(bot.last_message_received + 1);
-    // Itera sobre cada nova mensagem recebida.
-    for (int i = 0; i < numNewMessages; i++) {
-      handleNewMessage(bot.messages[i]);
+    uint32_t inicio = micros();
+    t.funcao();
+    uint32_t duracao = micros() - inicio;
+    t.execucoes++;
+    if(duracao > t.maiorUs){
+      t.maiorUs = duracao;
+    }
+    if(duracao > t.orcamentoUs){
+      t.estouros++;
+      if(t.estouros <= 3 || t.estouros % 100 == 0){
+        Serial.printf("Aviso: trabalho %s levou %lu us (orçamento de %lu us, %lu estouros).\n", t.nome,
+                      (unsigned long)duracao, (unsigned long)t.orcamentoUs, (unsigned long)t.estouros);
+      }
     }
-    lastMsgTime = millis(); // Reseta o contador.
   }
 }
 
 /**
- * @brief Verifica se um sinal de RF foi recebido.
+ * @brief Tempo até o próximo prazo, limitado a `ESCALONADOR_ESPERA_MAX_US`.
  */
-void checarRF(){
-  if(rfReceiver.available()){ // Se um código foi decodificado...
-    unsigned long value = rfReceiver.getReceivedValue();
-    Serial.printf("Sinal RF recebido: %lu\n", value);
-    handleRF(value); // Processa o código.
-    rfReceiver.resetAvailable(); // Prepara para receber o próximo.
+uint32_t esperaAteProximoPrazo(){
+  uint32_t agora = micros();
+  uint32_t espera = ESCALONADOR_ESPERA_MAX_US;
+  for(uint8_t i = 0; i < totalTrabalhos; i++){
+    const Trabalho& t = trabalhos[i];
+    if(!t.agendado){
+      continue;
+    }
+    int32_t falta = (int32_t)(t.prazoUs - agora);
+    if(falta <= 0){
+      return 0;
+    }
+    if((uint32_t)falta < espera){
+      espera = falta;
+    }
   }
+  return espera;
 }
 
+
+// =================================================================================
+// --- ECONOMIA DE ENERGIA ---
+// =================================================================================
+
 /**
- * @brief Verifica se o botão físico foi pressionado, com lógica de debounce.
+ * @brief Liga o clock dinâmico e, sem RF, o sono leve automático com despertar pelas
+ * zonas e pelo botão. Chamada no `setup()`, depois que as interrupções foram ligadas.
  */
-void checarBotao(){
-  static bool ultimoEstado = HIGH;
-  static unsigned long ultimoDebounce = 0;
-  const unsigned long debounceDelay = 50; // Tempo (em ms) para ignorar ruídos no botão.
-
-  int leitura = digitalRead(BUTTON_PIN);
-  if(leitura != ultimoEstado){ // Se o estado mudou...
-    ultimoDebounce = millis(); // ...reseta o contador do debounce.
+void iniciarEconomiaEnergia(){
+  if(!ECONOMIA_ENERGIA){
+    return;
+  }
+  esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "sirene", &travaSirene);
+  esp_pm_config_esp32_t config = {};
+  config.max_freq_mhz = getCpuFrequencyMhz();
+  config.min_freq_mhz = ECONOMIA_FREQ_MIN_MHZ;
+  config.light_sleep_enable = ECONOMIA_SONO_LEVE;
+  esp_err_t err = esp_pm_configure(&config);
+  if(err != ESP_OK && config.light_sleep_enable){
+    config.light_sleep_enable = false; // Firmware sem tickless idle: fica o clock dinâmico.
+    err = esp_pm_configure(&config);
   }
+  sonoLeveAtivo = err == ESP_OK && config.light_sleep_enable;
 
-  // Se o estado permaneceu estável pelo tempo de debounce...
-  if((millis() - ultimoDebounce) > debounceDelay){
-    // E se a mudança foi de HIGH para LOW (botão foi pressionado)...
-    if(leitura == LOW && ultimoEstado == HIGH){
-      // Alterna o estado do sistema.
-      if(sistemaAtivo){
-        desarmarSistema("Botão físico");
-      } else {
-        armarSistema("Botão físico");
+  if(ECONOMIA_SONO_LEVE){
+    // As ISRs passam a usar interrupção por nível, começando pelo oposto do nível atual.
+    for(uint8_t z = 0; z < TOTAL_ZONAS; z++){
+      if(pinoZona[z] >= 0){
+        armarDespertarPino(pinoZona[z]);
       }
     }
+#if SENTINELA_COM_BOTAO
+    armarDespertarPino(BUTTON_PIN);
+#endif
+    esp_sleep_enable_gpio_wakeup();
   }
-  ultimoEstado = leitura; // Salva o estado atual para a próxima iteração.
+  Serial.printf("Economia de energia: clock %s, sono leve %s.\n", err == ESP_OK ? "dinâmico" : "fixo",
+                sonoLeveAtivo ? "ativo" : "desligado");
 }
 
-
-// =================================================================================
-// --- FUNÇÕES DE LÓGICA DO ALARME ---
-// =================================================================================
-
 /**
- * @brief Ativa a sirene e notifica o usuário via Telegram.
+ * @brief Faz um GPIO acordar o chip (e chamar a ISR) quando sair do nível atual.
+ * @param pino O GPIO (0 a 39), lido no banco de registradores dele.
  */
-void dispararAlarme(){
-  digitalWrite(RELAY_PIN, HIGH); // Liga o relé, acionando a sirene.
-  alarmeDisparado = true;        // Atualiza o status do sistema.
-  bot.sendMessage(CHAT_ID, "⚠️ ALERTA! Movimento detectado! Sirene disparada!", "");
-  logEvento("Alarme efetivamente disparado (sirene + notificação).");
+void armarDespertarPino(uint8_t pino){
+  bool alto = (REG_READ(pino < 32 ? GPIO_IN_REG : GPIO_IN1_REG) >> (pino % 32)) & 0x1;
+  gpio_wakeup_enable((gpio_num_t)pino, alto ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
 }
 
 /**
- * @brief Desarma o sistema, desliga a sirene e notifica o usuário.
- * @param origem A fonte do comando (ex: "Telegram", "Controle RF").
+ * @brief Segura (ou libera) o chip acordado. Usada pela sirene: enquanto ela toca,
+ * nenhum sono leve atrasa o tratamento das entradas nem o desarme.
  */
-void desarmarSistema(String origem){
-  digitalWrite(RELAY_PIN, LOW); // Desliga o relé, parando a sirene.
-  alarmeDisparado = false;
-  sistemaAtivo = false;
-  String msg = "✅ Sistema DESARMADO com sucesso pela origem: " + origem;
-  bot.sendMessage(CHAT_ID, msg.c_str(), "");
-  logEvento(msg);
+void manterAcordado(bool acordado){
+  static bool travado = false;
+  if(travaSirene == nullptr || acordado == travado){
+    return;
+  }
+  travado = acordado;
+  if(acordado){
+    esp_pm_lock_acquire(travaSirene);
+  } else {
+    esp_pm_lock_release(travaSirene);
+  }
 }
 
 /**
- * @brief Arma o sistema e notifica o usuário.
- * @param origem A fonte do comando (ex: "Telegram", "Controle RF").
+ * @brief Contabiliza uma espera do loop, para o ciclo ativo das métricas.
+ * @param duracaoUs Quanto tempo o loop ficou esperando.
+ * @param porBorda `true` se a espera foi encerrada por uma ISR.
  */
-void armarSistema(String origem){
-  if(!sistemaAtivo){ // Só arma se já não estiver armado.
-    sistemaAtivo = true;
-    alarmeDisparado = false; // Garante que o status de alarme seja resetado.
-    String msg = "🔒 Sistema ARMADO com sucesso pela origem: " + origem;
-    bot.sendMessage(CHAT_ID, msg.c_str(), "");
-    logEvento(msg);
+void registrarEspera(uint32_t duracaoUs, bool porBorda){
+  portENTER_CRITICAL(&muxMetricas); // O total de 64 bits é lido pela tarefa de rede.
+  loopDormindoUs += duracaoUs;
+  if(porBorda){
+    despertaresBorda++;
   } else {
-    bot.sendMessage(CHAT_ID, "ℹ️ O sistema já se encontra armado.", "");
+    despertaresPrazo++;
   }
+  portEXIT_CRITICAL(&muxMetricas);
 }
 
 
+#if SENTINELA_TELEMETRIA
 // =================================================================================
-// --- FUNÇÕES DE PROCESSAMENTO (HANDLERS) ---
+// --- TELEMETRIA DA FROTA ---
 // =================================================================================
 
 /**
- * @brief Processa os comandos recebidos via Telegram.
- * @param msg O objeto da mensagem do Telegram.
+ * @brief Monta e envia um quadro de telemetria, no máximo um por `TELEMETRIA_INTERVALO_S`.
+ * Chamada a cada volta da tarefa de rede; no LAN, o envio leva poucos milissegundos. O
+ * POST (`TELEMETRIA_HTTP`) trava a tarefa por até `TELEMETRIA_ESPERA_HTTP_MS` e por isso
+ * espera a caixa de saída esvaziar: alerta pendente nunca divide a volta com ele.
  */
-void handleNewMessage(TelegramMessage msg){
-  String text = msg.text;
-  Serial.printf("Comando recebido do Telegram: %s\n", text.c_str());
-
-  if(text == "/armar"){
-    armarSistema("Telegram");
-  } else if(text == "/desarmar"){
-    desarmarSistema("Telegram");
-  } else if(text == "/status"){
-    String status = sistemaAtivo ? "ARMADO" : "DESARMADO";
-    String alarme = alarmeDisparado ? "SIM" : "NÃO";
-    String resp = "📊 *Status do Sentinela*\n\n*Sistema:* " + status + "\n*Sirene Disparada:* " + alarme;
-    bot.sendMessage(CHAT_ID, resp, "Markdown");
-  } else if(text == "/logs"){
-    enviarLogsTelegram();
+void enviarTelemetria(){
+  if(WiFi.status() != WL_CONNECTED ||
+     (quadrosTelemetria > 0 && millis() - ultimaTelemetriaMs < TELEMETRIA_INTERVALO_S * 1000)){
+    return;
+  }
+#if SENTINELA_COM_TELEGRAM
+  if(TELEMETRIA_HTTP && alertasNaSaida() > 0){
+    return; // Fica para uma volta sem alertas.
+  }
+#endif
+  ultimaTelemetriaMs = millis();
+  uint8_t quadro[TELEMETRIA_QUADRO_MAX];
+  EscritorCbor w = { quadro, sizeof(quadro), 0 };
+  montarTelemetria(w);
+  quadrosTelemetria++;
+  if(w.pos > w.tam){
+    Serial.println("Quadro de telemetria maior que TELEMETRIA_QUADRO_MAX: descartado.");
+    falhasTelemetria++;
+    return;
+  }
+
+  bool ok;
+  if(TELEMETRIA_HTTP){
+    HTTPClient http;
+    http.setConnectTimeout(TELEMETRIA_ESPERA_HTTP_MS); // Sem isso, o connect() do lwIP espera ~5 s.
+    http.setTimeout(TELEMETRIA_ESPERA_HTTP_MS);
+    http.begin(TELEMETRIA_HOST, TELEMETRIA_PORTA, "/telemetria");
+    http.addHeader("Content-Type", "application/cbor");
+    ok = http.POST(quadro, w.pos) / 100 == 2;
+    http.end();
   } else {
-    bot.sendMessage(CHAT_ID, "Comando não reconhecido. Use /armar, /desarmar, /status ou /logs.", "");
+    ok = udpTelemetria.beginPacket(TELEMETRIA_HOST, TELEMETRIA_PORTA) &&
+         udpTelemetria.write(quadro, w.pos) == w.pos && udpTelemetria.endPacket();
+  }
+  if(!ok){
+    falhasTelemetria++;
   }
 }
 
 /**
- * @brief Processa os códigos recebidos via RF.
- * @param code O código numérico recebido.
+ * @brief Escreve o mapa de telemetria (chaves de `ChaveTelemetria`, todas presentes).
+ */
+void montarTelemetria(EscritorCbor& w){
+  cborCabecalho(w, CBOR_MAPA, TOTAL_CHAVES_TELEMETRIA);
+  cborPar(w, TEL_VERSAO, TELEMETRIA_VERSAO);
+  cborPar(w, TEL_DISPOSITIVO, (int64_t)ESP.getEfuseMac());
+  cborPar(w, TEL_QUADRO, quadrosTelemetria);
+  cborPar(w, TEL_UPTIME_S, esp_timer_get_time() / 1000000);
+  cborPar(w, TEL_ESTADO, estadoAlarme);
+  cborPar(w, TEL_ZONAS_ABERTAS, zonasAbertas);
+  cborPar(w, TEL_ZONAS_DISPARADAS, zonasDisparadas);
+  cborPar(w, TEL_RSSI, WiFi.RSSI());
+  cborPar(w, TEL_HEAP_LIVRE, ESP.getFreeHeap());
+  cborPar(w, TEL_HEAP_MINIMO, ESP.getMinFreeHeap());
+  cborPar(w, TEL_SEQUENCIA_LOG, proximaSequencia);
+
+  cborCabecalho(w, CBOR_INTEIRO, TEL_METRICAS);
+  cborCabecalho(w, CBOR_LISTA, TOTAL_METRICAS);
+  for(uint8_t m = 0; m < TOTAL_METRICAS; m++){
+    portENTER_CRITICAL(&muxMetricas);
+    uint32_t amostras = metricas[m].amostras, maxUs = metricas[m].maxUs;
+    portEXIT_CRITICAL(&muxMetricas);
+    cborCabecalho(w, CBOR_LISTA, 2);
+    cborInteiro(w, amostras);
+    cborInteiro(w, maxUs);
+  }
+
+#if SENTINELA_COM_TELEGRAM
+  uint32_t alertas = alertasDescartados;
+#else
+  uint32_t alertas = 0;
+#endif
+  cborCabecalho(w, CBOR_INTEIRO, TEL_PERDAS);
+  cborCabecalho(w, CBOR_LISTA, 3);
+  cborInteiro(w, logsDescartados);
+  cborInteiro(w, entradasPerdidas);
+  cborInteiro(w, alertas);
+
+  cborPar(w, TEL_WIFI_QUEDAS, quedasWiFi);
+}
+
+/**
+ * @brief Escreve o cabeçalho de um item CBOR: tipo maior e argumento na menor forma.
+ * @param tipo CBOR_INTEIRO, CBOR_NEGATIVO, CBOR_LISTA ou CBOR_MAPA.
+ * @param valor O número, ou a quantidade de itens da lista/mapa.
+ */
+void cborCabecalho(EscritorCbor& w, uint8_t tipo, uint64_t valor){
+  uint8_t extra = valor < 24 ? 0 : valor <= 0xFF ? 1 : valor <= 0xFFFF ? 2 : valor <= 0xFFFFFFFFull ? 4 : 8;
+  uint8_t b[9];
+  b[0] = (tipo << 5) | (extra == 0 ? valor : extra == 1 ? 24 : extra == 2 ? 25 : extra == 4 ? 26 : 27);
+  for(uint8_t i = 0; i < extra; i++){
+    b[1 + i] = (uint8_t)(valor >> (8 * (extra - 1 - i))); // Big-endian.
+  }
+  if(w.pos + 1 + extra <= w.tam){
+    memcpy(w.dados + w.pos, b, 1 + extra);
+  }
+  w.pos += 1 + extra;
+}
+
+/**
+ * @brief Escreve um inteiro com sinal (tipo 0 ou 1, conforme o sinal).
  */
-void handleRF(unsigned long code){
-  if(code == CODE_ARM){
-    armarSistema("Controle RF");
-  } else if(code == CODE_DISARM){
-    desarmarSistema("Controle RF");
+void cborInteiro(EscritorCbor& w, int64_t valor){
+  if(valor >= 0){
+    cborCabecalho(w, CBOR_INTEIRO, (uint64_t)valor);
   } else {
-    String logMsg = "Código RF desconhecido recebido: " + String(code);
-    logEvento(logMsg.c_str());
+    cborCabecalho(w, CBOR_NEGATIVO, (uint64_t)(-1 - valor));
   }
 }
 
+/**
+ * @brief Escreve um par chave/valor inteiro de um mapa.
+ */
+void cborPar(EscritorCbor& w, ChaveTelemetria chave, int64_t valor){
+  cborCabecalho(w, CBOR_INTEIRO, chave);
+  cborInteiro(w, valor);
+}
+#endif
+
 
 // =================================================================================
-// --- FUNÇÕES DE LOG E TIMESTAMP ---
+// --- INTERRUPÇÕES E BUFFER DE EVENTOS DE ENTRADA ---
 // =================================================================================
 
 /**
- * @brief Salva uma mensagem de evento no arquivo de log e no monitor serial.
- * @param msg A mensagem a ser registrada.
+ * @brief Grava um evento no buffer circular. Chamada somente de dentro das ISRs.
+ * @param tipo A entrada que gerou a borda.
+ * @param zona O índice da zona (em ENTRADA_ZONA).
+ * @param pino O pino GPIO (0 a 39) a ser amostrado, no banco de registradores dele.
  */
-void logEvento(const String& msg){
-  String logMsg = "[" + timestamp() + "] " + msg + "\n";
-  Serial.print(logMsg);
-
-  // Abre o arquivo de log em modo "append" (adiciona ao final).
-  File f = LittleFS.open(LOG_FILE, "a");
-  if(!f){
-    Serial.println("Erro ao abrir arquivo de log para escrita.");
+static inline void IRAM_ATTR publicarEntrada(TipoEntrada tipo, uint8_t zona, int pino){
+  uint32_t cabeca = cabecaEntradas.load(std::memory_order_relaxed);
+  uint32_t cauda = caudaEntradas.load(std::memory_order_acquire);
+  if(cabeca - cauda >= TAMANHO_BUFFER_ENTRADAS){ // Buffer cheio: conta e descarta.
+    entradasPerdidas = entradasPerdidas + 1;
     return;
   }
-  f.print(logMsg);
-  f.close(); // Fecha o arquivo para salvar as alterações.
+  EventoEntrada& e = bufferEntradas[cabeca & (TAMANHO_BUFFER_ENTRADAS - 1)];
+  e.instanteUs = micros();
+  e.tipo = tipo;
+  e.zona = zona;
+  e.nivel = (REG_READ(pino < 32 ? GPIO_IN_REG : GPIO_IN1_REG) >> (pino % 32)) & 0x1;
+  if constexpr(ECONOMIA_SONO_LEVE){
+    // Só a interrupção por nível acorda do sono leve: trocar o nível esperado a cada
+    // disparo faz dela uma interrupção de borda (uma borda no meio vira novo disparo).
+    REG_SET_FIELD(GPIO_PIN0_REG + 4 * pino, GPIO_PIN0_INT_TYPE, e.nivel ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+  }
+  cabecaEntradas.store(cabeca + 1, std::memory_order_release); // Publica o evento ao consumidor.
+
+  // Acorda o loop, que pode estar dormindo até o próximo prazo do escalonador.
+  BaseType_t acordar = pdFALSE;
+  vTaskNotifyGiveFromISR(tarefaLoopHandle, &acordar);
+  if(acordar){
+    portYIELD_FROM_ISR();
+  }
 }
 
 /**
- * @brief Gera uma string de timestamp no formato AAAA-MM-DD HH:MM:SS.
- * @return O timestamp formatado ou uma mensagem de erro se o tempo não estiver sincronizado.
+ * @brief Interrupção de borda (subida e descida) de uma zona com GPIO.
+ * @param arg O índice da zona, registrado em `attachInterruptArg()`.
  */
-String timestamp(){
-  time_t now = time(nullptr);
-  struct tm* timeinfo = localtime(&now);
-  char buffer[30];
-  // Checa se o ano é válido (maior que 2020), indicando que o NTP sincronizou.
-  if(timeinfo->tm_year > (2020 - 1900)){
-    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", timeinfo);
-    return String(buffer);
-  } else {
-    return String("sincronizando relogio...");
-  }
+void IRAM_ATTR isrZona(void* arg){
+  uint8_t zona = (uint8_t)(uintptr_t)arg;
+  publicarEntrada(ENTRADA_ZONA, zona, pinoZona[zona]);
 }
 
+#if SENTINELA_COM_BOTAO
 /**
- * @brief Envia o arquivo de log para o chat do Telegram.
+ * @brief Interrupção de borda (subida e descida) do botão físico.
  */
-void enviarLogsTelegram(){
-  File f = LittleFS.open(LOG_FILE, "r");
-  if(!f){
-    bot.sendMessage(CHAT_ID, "Erro: Não foi possível encontrar o arquivo de log.", "");
-    return;
-  }
-  if(f.size() == 0){
-    bot.sendMessage(CHAT_ID, "O arquivo de log está vazio.", "");
-    f.close();
-    return;
+void IRAM_ATTR isrBotao(){
+  publicarEntrada(ENTRADA_BOTAO, 0, BUTTON_PIN);
+}
+#endif
+
+/**
+ * @brief Retira o próximo evento do buffer circular. Chamada somente pelo loop.
+ * @param e Recebe o evento retirado.
+ * @return `true` se havia um evento disponível.
+ */
+bool consumirEntrada(EventoEntrada& e){
+  uint32_t cauda = caudaEntradas.load(std::memory_order_relaxed);
+  if(cauda == cabecaEntradas.load(std::memory_order_acquire)){
+    return false; // Buffer vazio.
   }
+  e = bufferEntradas[cauda & (TAMANHO_BUFFER_ENTRADAS - 1)];
+  caudaEntradas.store(cauda + 1, std::memory_order_release); // Libera a posição para a ISR.
+  return true;
+}
 
-  // Envia o arquivo como um documento. Isso evita o limite de caracteres
-  // de uma mensagem normal e melhora a formatação.
-  bot.sendDocument(CHAT_ID, f, "log_sentinela.txt");
-  f.close();
-}
\ No newline at end of file
+
+// =================================================================================
+// --- TAREFA DE REDE (NÚCLEO 0) ---
+// =================================================================================
+
+/**
+ * @brief Tarefa FreeRTOS que supervisiona o Wi-Fi e envia as notificações ao Telegram.
+ * O recebimento de comandos fica com `tarefaPolling`. Chamadas lentas aqui não
+ * afetam o sensoriamento no núcleo 1. A ordem e o ritmo dos envios ficam com
+ * `despacharNotificacoes()`.
+ */
+void tarefaRede(void* parametro){
+  // Inicia a conexão ao Wi-Fi sem esperar por ela; `atualizarWiFi()` acompanha o resultado.
+  iniciarWiFi();
+
+  // Sincroniza o relógio interno do ESP32 com um servidor de tempo na internet (NTP).
+  // GMT-3 (fuso de Brasília), 0 para horário de verão, "pool.ntp.org" é o servidor.
+  // Essencial para que os timestamps nos logs estejam corretos. A sincronização
+  // acontece sozinha, em segundo plano, assim que a rede estiver disponível.
+  configTime(FUSO_HORARIO_S, 0, "pool.ntp.org");
+  sntp_set_time_sync_notification_cb(aoSincronizarRelogio);
+
+#if SENTINELA_COM_TELEGRAM
+  // Associa o certificado de segurança ao cliente Wi-Fi.
+  client.setCACert(TELEGRAM_CERTIFICATE_ROOT);
+  iniciarTransportes();
+
+  Notificacao n;
+#endif
+  for(;;){
+#if SENTINELA_COM_TELEGRAM
+    guardarAlertas(); // Grava os alertas novos na caixa de saída, mesmo sem Wi-Fi.
+#endif
+    atualizarWiFi();  // Avança a máquina de estados do Wi-Fi (nunca bloqueia).
+#if SENTINELA_TELEMETRIA
+    enviarTelemetria(); // Um quadro por intervalo, se houver Wi-Fi.
+#endif
+#if SENTINELA_COM_TELEGRAM
+    checarOnline();   // Até o primeiro contato, abre a sessão com o Telegram.
+#if SENTINELA_COM_OTA
+    verificarSaudeFirmware(); // Firmware novo em teste: confirma ou reverte.
+#endif
+
+    // Sem Wi-Fi, as notificações continuam na fila até a conexão voltar.
+    if(WiFi.status() != WL_CONNECTED){
+      vTaskDelay(pdMS_TO_TICKS(REDE_ESPERA_MS));
+      continue;
+    }
+
+    despacharNotificacoes();
+
+    // Dorme até chegar um alerta (que acorda a tarefa na hora) ou por no máximo `REDE_ESPERA_MS`.
+    // `guardarAlertas()` esvazia a fila a cada volta, então ela só tem alertas novos.
+    xQueuePeek(filaAlertas, &n, pdMS_TO_TICKS(REDE_ESPERA_MS));
+#else
+    vTaskDelay(pdMS_TO_TICKS(REDE_ESPERA_MS)); // Sem Telegram, a rede só mantém o Wi-Fi e o NTP.
+#endif
+  }
+}
+
+#if SENTINELA_COM_TELEGRAM
+
+/**
+ * @brief Faz o primeiro contato com o Telegram assim que o Wi-Fi sobe e registra
+ * quanto tempo o sistema levou, desde o boot, para ficar online.
+ */
+void checarOnline(){
+  if(bootOnline || WiFi.status() != WL_CONNECTED ||
+     millis() - ultimaVerificacaoOnline < INTERVALO_VERIFICACAO_ONLINE){
+    return;
+  }
+  ultimaVerificacaoOnline = millis();
+  if(garantirSessaoTelegram(client) && bot.getMe()){ // Deixa a sessão TLS aquecida para as próximas chamadas.
+    bootOnline = true;
+    logEvento(EVT_BOOT_ONLINE, ORIGEM_SISTEMA, millis());
+  }
+}
+
+/**
+ * @brief Envia o que estiver pronto, respeitando prioridade e o balde de tokens.
+ * Alertas saem primeiro e podem gastar todos os tokens. Mensagens normais saem na
+ * ordem de chegada enquanto sobrar mais que a reserva dos alertas. Mensagens
+ * informativas não gastam token ao chegar: vão para o resumo, que sai no fim da janela.
+ */
+void despacharNotificacoes(){
+  reporTokensEnvio();
+  if(envioPausado){
+    if(millis() - inicioPausaEnvio < ENVIO_ESPERA_FALHA_MS) return; // Pausa após uma falha.
+    envioPausado = false;
+  }
+
+  while(tokensEnvio > 0 && alertasNaSaida() > 0){
+    if(!enviarAlertasPendentes()) return;
+  }
+  // Sem tokens para os alertas pendentes, nada mais pode passar na frente deles.
+  if(alertasNaSaida() > 0) return;
+
+  Notificacao n;
+
+  while(xQueuePeek(filaNotificacoes, &n, 0) == pdTRUE){
+    if(n.prioridade == PRIO_INFO){
+      xQueueReceive(filaNotificacoes, &n, 0);
+      agruparNotificacao(n);
+      continue;
+    }
+    if(tokensEnvio <= ENVIO_RESERVA_ALERTA) break;
+    xQueueReceive(filaNotificacoes, &n, 0);
+    if(!processarNotificacao(n)) return;
+    // Um envio pode levar segundos; um alerta que chegou nesse meio tempo passa à frente.
+    if(uxQueueMessagesWaiting(filaAlertas) > 0) return;
+  }
+
+  bool janelaEncerrada = totalItensResumo > 0 &&
+                         millis() - inicioJanelaResumo >= RESUMO_JANELA_MS;
+  if((janelaEncerrada || resumoExcedente > 0) && tokensEnvio > ENVIO_RESERVA_ALERTA){
+    enviarResumo();
+  }
+}
+
+/**
+ * @brief Credita no balde os tokens acumulados desde a última reposição.
+ */
+void reporTokensEnvio(){
+  uint32_t agora = millis();
+  uint32_t novos = (agora - ultimaReposicaoTokens) / ENVIO_INTERVALO_TOKEN_MS;
+  if(novos == 0) return;
+  ultimaReposicaoTokens += novos * ENVIO_INTERVALO_TOKEN_MS;
+  if(tokensEnvio + novos >= ENVIO_CAPACIDADE_BALDE){
+    tokensEnvio = ENVIO_CAPACIDADE_BALDE;
+    ultimaReposicaoTokens = agora; // Balde cheio: o tempo parado não vira crédito extra.
+  } else {
+    tokensEnvio += novos;
+  }
+}
+
+/**
+ * @brief Acrescenta uma mensagem informativa ao resumo da janela atual.
+ * Um texto igual a um já presente só incrementa o contador dele.
+ */
+void agruparNotificacao(const Notificacao& n){
+  for(uint8_t i = 0; i < totalItensResumo; i++){
+    if(strncmp(itensResumo[i].texto, n.texto, sizeof(itensResumo[i].texto) - 1) == 0){
+      itensResumo[i].vezes++;
+      return;
+    }
+  }
+  if(totalItensResumo == RESUMO_MAX_ITENS){
+    resumoExcedente++; // Resumo cheio: conta o aviso e antecipa o envio.
+    return;
+  }
+  if(totalItensResumo == 0) inicioJanelaResumo = millis();
+  ItemResumo& item = itensResumo[totalItensResumo++];
+  strlcpy(item.texto, n.texto, sizeof(item.texto));
+  item.vezes = 1;
+}
+
+/**
+ * @brief Envia o resumo da janela como uma única mensagem e o esvazia.
+ * Um resumo com um só aviso, recebido uma vez, sai com o texto original.
+ */
+void enviarResumo(){
+  Notificacao n;
+  n.tipo = NOTIF_TEXTO;
+  n.prioridade = PRIO_INFO;
+  n.markdown = false;
+  if(totalItensResumo == 1 && itensResumo[0].vezes == 1 && resumoExcedente == 0){
+    strlcpy(n.texto, itensResumo[0].texto, sizeof(n.texto));
+  } else {
+    size_t pos = snprintf(n.texto, sizeof(n.texto), "ℹ️ Resumo dos últimos avisos:\n");
+    for(uint8_t i = 0; i < totalItensResumo && pos < sizeof(n.texto); i++){
+      if(itensResumo[i].vezes > 1){
+        pos += snprintf(n.texto + pos, sizeof(n.texto) - pos, "• %s (%ux)\n",
+                        itensResumo[i].texto, (unsigned)itensResumo[i].vezes);
+      } else {
+        pos += snprintf(n.texto + pos, sizeof(n.texto) - pos, "• %s\n", itensResumo[i].texto);
+      }
+    }
+    if(resumoExcedente > 0 && pos < sizeof(n.texto)){
+      snprintf(n.texto + pos, sizeof(n.texto) - pos, "• e mais %u aviso(s)\n",
+               (unsigned)resumoExcedente);
+    }
+  }
+  totalItensResumo = 0;
+  resumoExcedente = 0;
+  processarNotificacao(n); // Informativo: se falhar, não é reenviado.
+}
+
+/**
+ * @brief Envia uma notificação ao Telegram, gastando um token do balde.
+ * @return `true` se o envio foi concluído.
+ */
+bool processarNotificacao(const Notificacao& n){
+  if(!prepararEnvio()){
+    return false;
+  }
+  if(n.tipo == NOTIF_ENVIAR_LOGS){
+    // O relatório sai pela tarefa de trabalho; a de rede volta logo para a fila.
+    OperacaoLonga op;
+    op.tipo = OP_ENVIAR_LOGS;
+    op.filtro = n.filtro;
+    if(xQueueSend(filaOperacoes, &op, 0) != pdTRUE){
+      return enviarMensagem("⏳ Já há um envio de log em andamento. Use /cancelar para interrompê-lo.", "");
+    }
+    return true;
+  }
+  if(n.tipo == NOTIF_METRICAS){
+    // Estático: só a tarefa de rede monta este texto, que não cabe bem na pilha dela.
+    static char texto[METRICAS_TEXTO_MAX];
+    size_t pos = snprintf(texto, sizeof(texto), "📈 *Métricas do Sentinela*\n```\n");
+    pos += formatarMetricas(texto + pos, sizeof(texto) - pos - 4, "");
+    strlcpy(texto + pos, "```", sizeof(texto) - pos);
+    return enviarMensagem(texto, "Markdown");
+  }
+  if(n.tipo == NOTIF_INCIDENTE){
+    return atualizarMensagem(n.texto, n.incidente);
+  }
+  return enviarMensagem(n.texto, n.markdown ? "Markdown" : "");
+}
+
+/**
+ * @brief Confere se algum transporte pode enviar e gasta um token do balde.
+ * Sem conexão, pausa os envios por `ENVIO_ESPERA_FALHA_MS`.
+ * @return `true` se o envio pode seguir.
+ */
+bool prepararEnvio(){
+  if(WiFi.status() != WL_CONNECTED || !algumTransporteDisponivel()){
+    Serial.println("Nenhum transporte disponível: envio adiado.");
+    envioPausado = true;
+    inicioPausaEnvio = millis();
+    return false;
+  }
+  if(tokensEnvio > 0) tokensEnvio--;
+  return true;
+}
+
+/**
+ * @brief Entrega uma mensagem pelo primeiro transporte disponível que a aceitar.
+ * Se todos falharem, pausa os envios por `ENVIO_ESPERA_FALHA_MS`. O Telegram confirma na
+ * hora; o MQTT confirma com o PUBACK, e sem ele `processarPubacks()` devolve a mensagem à
+ * fila, que sai então pelo próximo transporte.
+ * @return `true` se algum transporte aceitou a mensagem.
+ */
+bool enviarMensagem(const char* texto, const char* parseMode){
+#if SENTINELA_COM_MQTT
+  ultimaPublicacaoMqtt = -1;
+#endif
+  for(uint8_t i = 0; i < totalTransportes; i++){
+    Transporte& t = transportes[i];
+    if(!t.disponivel()) continue;
+    if(t.enviar(texto, parseMode)){
+      t.envios++;
+      return true;
+    }
+    t.falhas++;
+    Serial.printf("Falha ao enviar mensagem por %s.\n", t.nome);
+  }
+  // A biblioteca do Telegram não expõe o `retry_after` de um 429; uma pausa curta cobre os dois casos.
+  envioPausado = true;
+  inicioPausaEnvio = millis();
+  return false;
+}
+
+/**
+ * @brief Reescreve a mensagem de um incidente pelo primeiro transporte disponível que
+ * a confirmar. Cada transporte guarda a sua (`mensagemFixa`); um incidente novo começa
+ * de uma mensagem nova. Transportes sem `atualizar` recebem um envio comum.
+ * @param texto O resumo atual do incidente.
+ * @param incidente O número do incidente.
+ * @return `true` se algum transporte entregou a mensagem.
+ */
+bool atualizarMensagem(const char* texto, uint32_t incidente){
+  if(incidente != incidenteNaMensagem){
+    incidenteNaMensagem = incidente;
+    for(uint8_t i = 0; i < totalTransportes; i++){
+      transportes[i].mensagemFixa = 0;
+    }
+  }
+  for(uint8_t i = 0; i < totalTransportes; i++){
+    Transporte& t = transportes[i];
+    if(!t.disponivel()) continue;
+    bool ok = t.atualizar ? t.atualizar(texto, t.mensagemFixa) : t.enviar(texto, "");
+    if(ok){
+      t.envios++;
+      return true;
+    }
+    t.falhas++;
+    Serial.printf("Falha ao atualizar o incidente por %s.\n", t.nome);
+  }
+  envioPausado = true;
+  inicioPausaEnvio = millis();
+  return false;
+}
+
+
+// =================================================================================
+// --- TRANSPORTES (TELEGRAM E MQTT) ---
+// =================================================================================
+
+/**
+ * @brief Registra os transportes em ordem de preferência. Chamada pela tarefa de rede,
+ * depois que o Wi-Fi foi iniciado.
+ */
+void iniciarTransportes(){
+#if SENTINELA_COM_MQTT
+  registrarTransporte("mqtt", mqttDisponivel, enviarMqtt, atualizarMqtt);
+  iniciarMqtt();
+#endif
+  registrarTransporte("telegram", telegramDisponivel, enviarTelegram, atualizarTelegram);
+}
+
+/**
+ * @brief Acrescenta um transporte ao fim da lista de preferência. `atualizar` pode ser
+ * nullptr num canal que não sabe reescrever mensagens.
+ */
+void registrarTransporte(const char* nome, bool (*disponivel)(), bool (*enviar)(const char* texto, const char* parseMode), bool (*atualizar)(const char* texto, int& mensagem)){
+  if(totalTransportes >= MAX_TRANSPORTES){
+    Serial.printf("Transporte %s não registrado: aumente MAX_TRANSPORTES.\n", nome);
+    return;
+  }
+  Transporte& t = transportes[totalTransportes++];
+  t.nome = nome;
+  t.disponivel = disponivel;
+  t.enviar = enviar;
+  t.atualizar = atualizar;
+  t.mensagemFixa = 0;
+  t.envios = 0;
+  t.falhas = 0;
+}
+
+/**
+ * @brief `true` se algum transporte pode enviar agora.
+ */
+bool algumTransporteDisponivel(){
+  for(uint8_t i = 0; i < totalTransportes; i++){
+    if(transportes[i].disponivel()) return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Transporte Telegram: abre (ou reaproveita) a sessão TLS da tarefa de rede.
+ */
+bool telegramDisponivel(){
+  return garantirSessaoTelegram(client);
+}
+
+/**
+ * @brief Transporte Telegram: `sendMessage` cronometrado.
+ * @return `true` se o Telegram aceitou a mensagem.
+ */
+bool enviarTelegram(const char* texto, const char* parseMode){
+  uint32_t inicio = micros();
+  bool ok = bot.sendMessage(CHAT_ID, texto, parseMode);
+  registrarMetrica(MET_SEND_MESSAGE, micros() - inicio);
+  return ok;
+}
+
+/**
+ * @brief Transporte Telegram: edita a mensagem do incidente (`editMessageText`). Na
+ * primeira vez, ou se a edição falhar (mensagem apagada, antiga demais), envia uma nova
+ * e guarda o `message_id` dela.
+ * @param mensagem O `message_id` a editar; 0 para enviar uma nova.
+ * @return `true` se o Telegram aceitou a mensagem.
+ */
+bool atualizarTelegram(const char* texto, int& mensagem){
+  uint32_t inicio = micros();
+  bool ok = mensagem != 0 && bot.sendMessage(CHAT_ID, texto, "", mensagem);
+  if(!ok){
+    ok = bot.sendMessage(CHAT_ID, texto, "");
+    mensagem = ok ? bot.last_sent_message_id : 0;
+  }
+  registrarMetrica(MET_SEND_MESSAGE, micros() - inicio);
+  return ok;
+}
+
+#if SENTINELA_COM_MQTT
+/**
+ * @brief Cria o cliente MQTT e o inicia. A conexão, a reconexão e as retransmissões
+ * ficam com a tarefa do próprio cliente; quedas do Wi-Fi são recuperadas sozinhas.
+ */
+void iniciarMqtt(){
+  filaPubacks = xQueueCreate(TAMANHO_FILA_PUBACKS, sizeof(int));
+  esp_mqtt_client_config_t config = {};
+  config.broker.address.uri = MQTT_URI;
+  config.credentials.username = MQTT_USUARIO;
+  config.credentials.authentication.password = MQTT_SENHA;
+  config.session.disable_clean_session = true;    // O broker guarda os comandos QoS 1 durante uma queda.
+  config.session.keepalive = 30;
+  config.session.last_will.topic = MQTT_PREFIXO "/estado";
+  config.session.last_will.msg = "offline";
+  config.session.last_will.qos = 1;
+  config.session.last_will.retain = true;
+  config.network.reconnect_timeout_ms = 2000;     // Na rede local, reconectar logo é barato.
+  config.credentials.client_id = MQTT_PREFIXO;
+  clienteMqtt = esp_mqtt_client_init(&config);
+  esp_mqtt_client_register_event(clienteMqtt, MQTT_EVENT_ANY, aoEventoMqtt, nullptr);
+  esp_mqtt_client_start(clienteMqtt);
+}
+
+/**
+ * @brief Callback do cliente MQTT (roda na tarefa dele). Assina os comandos a cada
+ * sessão, repassa os PUBACKs à tarefa de rede e interpreta os comandos recebidos.
+ */
+void aoEventoMqtt(void* arg, esp_event_base_t base, int32_t id, void* dados){
+  esp_mqtt_event_handle_t evento = (esp_mqtt_event_handle_t)dados;
+  switch((esp_mqtt_event_id_t)id){
+    case MQTT_EVENT_CONNECTED:
+      mqttConectado = true;
+      mqttConexoes++;
+      if(MQTT_ACEITA_COMANDOS){
+        esp_mqtt_client_subscribe(clienteMqtt, MQTT_PREFIXO "/comandos", 1);
+      }
+      esp_mqtt_client_enqueue(clienteMqtt, MQTT_PREFIXO "/estado", "online", 0, 1, 1, true);
+      Serial.println(MQTT_ACEITA_COMANDOS ? "MQTT conectado ao broker."
+                                          : "MQTT conectado ao broker sem usuário: comandos pelo broker desligados.");
+      break;
+    case MQTT_EVENT_DISCONNECTED:
+      mqttConectado = false;
+      break;
+    case MQTT_EVENT_PUBLISHED:
+      xQueueSend(filaPubacks, &evento->msg_id, 0);
+      break;
+    case MQTT_EVENT_DATA: {
+      // Só comandos inteiros e curtos: um fragmento de mensagem grande é ignorado.
+      if(evento->current_data_offset != 0 || evento->data_len != evento->total_data_len ||
+         evento->data_len >= (int)MQTT_COMANDO_MAX){
+        break;
+      }
+      if(!MQTT_ACEITA_COMANDOS){
+        break; // Sessão anônima: ninguém garante quem publicou.
+      }
+      char texto[MQTT_COMANDO_MAX];
+      memcpy(texto, evento->data, evento->data_len);
+      texto[evento->data_len] = '\0';
+      interpretarComando(texto, ORIGEM_MQTT);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief Transporte MQTT: pronto enquanto houver sessão com o broker e nenhum PUBACK
+ * perdido nos últimos `MQTT_PAUSA_SEM_PUBACK_MS`.
+ */
+bool mqttDisponivel(){
+  processarPubacks();
+  if(mqttSemPuback && millis() - inicioSemPubackMs >= MQTT_PAUSA_SEM_PUBACK_MS){
+    mqttSemPuback = false; // Dá outra chance ao broker.
+  }
+  return mqttConectado && !mqttSemPuback;
+}
+
+/**
+ * @brief Confere os PUBACKs recebidos pela tarefa do cliente e os prazos das publicações
+ * ainda sem confirmação. Um PUBACK do lote da caixa de saída confirma o lote. Chamada
+ * pela tarefa de rede, a única que mexe em `publicacoesMqtt`.
+ */
+void processarPubacks(){
+  int confirmado;
+  while(xQueueReceive(filaPubacks, &confirmado, 0) == pdTRUE){
+    for(PublicacaoMqtt& p : publicacoesMqtt){
+      if(p.ativa && p.msgId == confirmado){
+        p.ativa = false;
+        registrarMetrica(MET_MQTT_PUBACK, micros() - p.inicioUs);
+        mqttSemPuback = false;
+      }
+    }
+    if(confirmado == loteSaidaMqtt){
+      loteSaidaMqtt = -1;
+      confirmarSaida(fimLoteSaidaMqtt);
+    }
+  }
+  uint32_t agora = micros();
+  for(PublicacaoMqtt& p : publicacoesMqtt){
+    if(p.ativa && agora - p.inicioUs >= MQTT_ESPERA_PUBACK_MS * 1000){
+      // Continua na fila do cliente e pode chegar depois: entrega "ao menos uma vez".
+      p.ativa = false;
+      pubacksPerdidos++;
+      mqttSemPuback = true;
+      inicioSemPubackMs = millis();
+      if(p.msgId == loteSaidaMqtt){
+        loteSaidaMqtt = -1; // O lote volta a ser enviado, agora pelo próximo transporte.
+      } else if(xQueueSend(filaNotificacoes, &p.reenvio, 0) != pdTRUE){
+        Serial.println("Fila de notificações cheia: mensagem sem PUBACK descartada.");
+      }
+    }
+  }
+}
+
+/**
+ * @brief Transporte MQTT: publica em `<prefixo>/eventos` (ver `publicarMqtt()`).
+ */
+bool enviarMqtt(const char* texto, const char* parseMode){
+  PublicacaoMqtt* p = publicarMqtt(MQTT_PREFIXO "/eventos", texto, false);
+  if(p == nullptr){
+    return false;
+  }
+  p->reenvio.markdown = parseMode[0] != '\0';
+  return true;
+}
+
+/**
+ * @brief Transporte MQTT: a "mensagem" do incidente é o valor retido em
+ * `<prefixo>/incidente`, que cada publicação substitui no broker.
+ */
+bool atualizarMqtt(const char* texto, int& mensagem){
+  PublicacaoMqtt* p = publicarMqtt(MQTT_PREFIXO "/incidente", texto, true);
+  if(p == nullptr){
+    return false;
+  }
+  mensagem = 1;
+  p->reenvio.tipo = NOTIF_INCIDENTE; // Sem PUBACK, o Telegram reescreve a mensagem dele.
+  p->reenvio.incidente = incidenteNaMensagem;
+  return true;
+}
+
+/**
+ * @brief Põe a publicação (QoS 1) na fila do cliente, sem esperar pelo broker, e passa a
+ * acompanhar o PUBACK dela em `processarPubacks()`, com uma cópia do texto para o reenvio.
+ * @param retido `true` para o broker guardar a mensagem como valor atual do tópico.
+ * @return O acompanhamento (para ajustar o `reenvio`), ou nullptr se o cliente recusou.
+ */
+PublicacaoMqtt* publicarMqtt(const char* topico, const char* texto, bool retido){
+  int msgId = esp_mqtt_client_enqueue(clienteMqtt, topico, texto, 0, 1, retido ? 1 : 0, true);
+  if(msgId < 0){
+    return nullptr;
+  }
+  // A tabela cheia descarta o acompanhamento mais antigo (e o reenvio dele), não a publicação.
+  PublicacaoMqtt* livre = &publicacoesMqtt[0];
+  for(PublicacaoMqtt& p : publicacoesMqtt){
+    if(!p.ativa){
+      livre = &p;
+      break;
+    }
+    if((int32_t)(p.inicioUs - livre->inicioUs) < 0){
+      livre = &p;
+    }
+  }
+  livre->ativa = true;
+  livre->msgId = msgId;
+  livre->inicioUs = micros();
+  livre->reenvio.tipo = NOTIF_TEXTO;
+  livre->reenvio.prioridade = PRIO_NORMAL;
+  livre->reenvio.markdown = false;
+  livre->reenvio.incidente = 0;
+  strlcpy(livre->reenvio.texto, texto, sizeof(livre->reenvio.texto));
+  ultimaPublicacaoMqtt = msgId;
+  return livre;
+}
+#endif
+
+
+// =================================================================================
+// --- CAIXA DE SAÍDA PERSISTENTE (ALERTAS) ---
+// =================================================================================
+
+/**
+ * @brief Soma de verificação FNV-1a de um registro da caixa de saída (sem o campo `soma`).
+ */
+uint32_t somaRegistroSaida(const RegistroSaida& r){
+  RegistroSaida copia = r;
+  copia.soma = 0;
+  const uint8_t* bytes = (const uint8_t*)&copia;
+  uint32_t h = 2166136261u;
+  for(size_t i = 0; i < sizeof(copia); i++){
+    h = (h ^ bytes[i]) * 16777619u;
+  }
+  return h;
+}
+
+/**
+ * @brief Lê a posição do anel que guarda uma sequência.
+ * @return `true` se a posição contém um registro íntegro dessa sequência.
+ */
+bool lerRegistroSaida(File& f, uint32_t sequencia, RegistroSaida& r){
+  f.seek((sequencia % SAIDA_CAPACIDADE) * sizeof(RegistroSaida));
+  return f.read((uint8_t*)&r, sizeof(r)) == sizeof(r) &&
+         r.sequencia == sequencia && r.soma == somaRegistroSaida(r);
+}
+
+/**
+ * @brief Carrega a caixa de saída no boot: cria o anel se preciso, lê a última
+ * sequência confirmada e localiza a mais recente gravada. Chamada no `setup()`.
+ */
+void iniciarCaixaSaida(){
+  File marca = LittleFS.open(SAIDA_CONFIRMADOS, "r");
+  if(marca){
+    uint32_t confirmada = 0;
+    if(marca.read((uint8_t*)&confirmada, sizeof(confirmada)) == sizeof(confirmada)){
+      ultimaConfirmadaSaida = confirmada;
+    }
+    marca.close();
+  }
+  // Um corte de energia no meio da regravação do marcador o deixa vazio; o instantâneo
+  // lembra até onde os alertas já tinham saído.
+  if((int32_t)(saidaConfirmadaRestaurada - ultimaConfirmadaSaida) > 0){
+    ultimaConfirmadaSaida = saidaConfirmadaRestaurada;
+  }
+
+  const size_t tamanhoAnel = SAIDA_CAPACIDADE * sizeof(RegistroSaida);
+  File f = LittleFS.open(SAIDA_ARQUIVO, "r");
+  if(!f || f.size() != tamanhoAnel){
+    if(f) f.close();
+    // Reserva o anel inteiro de uma vez; depois, cada alerta é uma escrita no lugar.
+    f = LittleFS.open(SAIDA_ARQUIVO, "w");
+    if(!f){
+      Serial.println("Erro: não foi possível criar a caixa de saída.");
+      return;
+    }
+    RegistroSaida vazio;
+    memset(&vazio, 0, sizeof(vazio));
+    for(uint8_t i = 0; i < SAIDA_CAPACIDADE; i++){
+      f.write((const uint8_t*)&vazio, sizeof(vazio));
+    }
+    f.close();
+    proximaSequenciaSaida = ultimaConfirmadaSaida + 1;
+    return;
+  }
+
+  uint32_t maior = ultimaConfirmadaSaida;
+  RegistroSaida r;
+  for(uint8_t i = 0; i < SAIDA_CAPACIDADE; i++){
+    if(f.read((uint8_t*)&r, sizeof(r)) == sizeof(r) && r.sequencia != 0 &&
+       r.soma == somaRegistroSaida(r) && r.sequencia > maior){
+      maior = r.sequencia;
+    }
+  }
+  f.close();
+  proximaSequenciaSaida = maior + 1;
+  if(alertasNaSaida() > 0){
+    Serial.printf("Caixa de saída: %lu alerta(s) pendente(s) do boot anterior.\n",
+                  (unsigned long)alertasNaSaida());
+  }
+}
+
+/**
+ * @brief Quantos alertas gravados ainda não foram entregues.
+ */
+uint32_t alertasNaSaida(){
+  return proximaSequenciaSaida - 1 - ultimaConfirmadaSaida;
+}
+
+/**
+ * @brief `true` se há algum alerta esperando, na fila em RAM ou na caixa de saída.
+ * Usada também pela tarefa de trabalho para pausar uploads.
+ */
+bool alertasPendentes(){
+  return uxQueueMessagesWaiting(filaAlertas) > 0 || alertasNaSaida() > 0;
+}
+
+/**
+ * @brief Grava a última sequência entregue ao chat, liberando as posições do anel.
+ */
+void confirmarSaida(uint32_t sequencia){
+  ultimaConfirmadaSaida = sequencia;
+  File marca = LittleFS.open(SAIDA_CONFIRMADOS, "w");
+  if(marca){
+    marca.write((const uint8_t*)&sequencia, sizeof(sequencia));
+    marca.close();
+  }
+}
+
+/**
+ * @brief Acrescenta um alerta à caixa de saída com uma única escrita. Com o anel
+ * cheio, o alerta mais antigo é sobrescrito (e contado como descartado).
+ * @return `true` se o alerta ficou gravado na flash.
+ */
+bool gravarAlertaSaida(const char* texto){
+  if(alertasNaSaida() >= SAIDA_CAPACIDADE){
+    alertasDescartados++;
+    confirmarSaida(ultimaConfirmadaSaida + 1);
+  }
+  RegistroSaida r;
+  memset(&r, 0, sizeof(r));
+  r.sequencia = proximaSequenciaSaida;
+  time_t agora = time(nullptr);
+  if(agora > 1577836800){ // 2020-01-01 00:00:00 UTC: o NTP já sincronizou.
+    r.instante = (uint32_t)agora;
+    r.flags = REG_RELOGIO_SINCRONIZADO;
+  } else {
+    r.instante = millis() / 1000;
+  }
+  strlcpy(r.texto, texto, sizeof(r.texto));
+  r.soma = somaRegistroSaida(r);
+
+  File f = LittleFS.open(SAIDA_ARQUIVO, "r+");
+  if(!f){
+    return false;
+  }
+  f.seek((r.sequencia % SAIDA_CAPACIDADE) * sizeof(RegistroSaida));
+  bool ok = f.write((const uint8_t*)&r, sizeof(r)) == sizeof(r);
+  f.close();
+  if(ok){
+    proximaSequenciaSaida++;
+  }
+  return ok;
+}
+
+/**
+ * @brief Move os alertas da `filaAlertas` para a caixa de saída. Se a flash falhar,
+ * o alerta ainda tem uma tentativa direta de envio.
+ */
+void guardarAlertas(){
+  Notificacao n;
+  while(xQueueReceive(filaAlertas, &n, 0) == pdTRUE){
+    if(!gravarAlertaSaida(n.texto)){
+      Serial.println("Erro: falha ao gravar o alerta na caixa de saída; tentando envio direto.");
+      processarNotificacao(n);
+    }
+  }
+}
+
+/**
+ * @brief Envia, numa única mensagem, os alertas mais antigos da caixa de saída. Um só
+ * alerta sai com o texto original; vários saem numa lista com a hora de cada um.
+ * @return `true` se o lote foi entregue (ou descartado após falhas seguidas).
+ */
+bool enviarAlertasPendentes(){
+#if SENTINELA_COM_MQTT
+  processarPubacks();
+  if(loteSaidaMqtt >= 0){
+    return false; // O lote anterior ainda espera o PUBACK (ou o prazo dele).
+  }
+#endif
+  File f = LittleFS.open(SAIDA_ARQUIVO, "r");
+  if(!f){
+    return false;
+  }
+  // Estático: só a tarefa de rede monta este texto, que não cabe bem na pilha dela.
+  static char texto[SAIDA_MENSAGEM_MAX];
+  uint32_t pendentes = alertasNaSaida();
+  uint32_t sequencia = ultimaConfirmadaSaida + 1;
+  uint32_t fimLote = ultimaConfirmadaSaida;
+  uint8_t noLote = 0;
+  size_t pos = 0;
+  RegistroSaida r;
+  if(pendentes == 1){
+    if(lerRegistroSaida(f, sequencia, r)){
+      strlcpy(texto, r.texto, sizeof(texto));
+      noLote = 1;
+    }
+    fimLote = sequencia;
+  } else {
+    pos = snprintf(texto, sizeof(texto), "🚨 Alertas retidos sem conexão (%lu):\n", (unsigned long)pendentes);
+    for(; sequencia < proximaSequenciaSaida && noLote < SAIDA_POR_MENSAGEM; sequencia++){
+      if(!lerRegistroSaida(f, sequencia, r)){
+        fimLote = sequencia; // Posição sobrescrita ou corrompida: não há o que enviar.
+        continue;
+      }
+      char instante[30];
+      if(r.flags & REG_RELOGIO_SINCRONIZADO){
+        time_t t = (time_t)r.instante;
+        struct tm timeinfo;
+        localtime_r(&t, &timeinfo);
+        strftime(instante, sizeof(instante), "%d/%m %H:%M:%S", &timeinfo);
+      } else {
+        snprintf(instante, sizeof(instante), "%lus após um boot", (unsigned long)r.instante);
+      }
+      size_t linha = snprintf(nullptr, 0, "• %s — %s\n", instante, r.texto);
+      if(pos + linha >= sizeof(texto)){
+        break; // O restante vai na próxima mensagem.
+      }
+      pos += snprintf(texto + pos, sizeof(texto) - pos, "• %s — %s\n", instante, r.texto);
+      fimLote = sequencia;
+      noLote++;
+    }
+  }
+  f.close();
+
+  if(noLote == 0){
+    confirmarSaida(fimLote); // Só posições ilegíveis: pula sem gastar token.
+    return true;
+  }
+  if(!prepararEnvio()){
+    return false;
+  }
+  if(!enviarMensagem(texto, "")){
+    if(++falhasSaida < ENVIO_MAX_TENTATIVAS_ALERTA){
+      return false;
+    }
+    // Com a conexão de pé, o Telegram recusa este lote sempre: descarta para não travar a fila.
+    Serial.println("Lote de alertas descartado após várias falhas de envio.");
+    alertasDescartados += noLote;
+  }
+  falhasSaida = 0;
+#if SENTINELA_COM_MQTT
+  if(ultimaPublicacaoMqtt >= 0){
+    // Aceito pelo cliente MQTT: a caixa de saída só avança com o PUBACK do broker.
+    loteSaidaMqtt = ultimaPublicacaoMqtt;
+    fimLoteSaidaMqtt = fimLote;
+    return true;
+  }
+#endif
+  confirmarSaida(fimLote);
+  return true;
+}
+
+/**
+ * @brief Coloca uma mensagem na fila de saída da tarefa de rede, sem bloquear.
+ * @param texto O texto a ser enviado ao chat.
+ * @param markdown `true` para formatar a mensagem como Markdown.
+ * @param prioridade PRIO_ALERTA vai para a fila de alertas; as demais, para a fila comum.
+ */
+void notificar(const char* texto, bool markdown, PrioridadeNotificacao prioridade){
+  Notificacao n;
+  n.tipo = NOTIF_TEXTO;
+  n.prioridade = prioridade;
+  n.markdown = markdown;
+  strlcpy(n.texto, texto, sizeof(n.texto));
+  QueueHandle_t fila = (prioridade == PRIO_ALERTA) ? filaAlertas : filaNotificacoes;
+  if(xQueueSend(fila, &n, 0) != pdTRUE){
+    Serial.println("Fila de notificações cheia: mensagem descartada.");
+  }
+}
+
+/**
+ * @brief Enfileira um texto maior que `NOTIF_TEXTO_MAX` em várias notificações, cortadas
+ * entre linhas: no Markdown, nenhuma entidade (`*...*`) fica aberta numa parte, o que faria
+ * o Telegram recusar a mensagem inteira.
+ * @param texto O texto completo.
+ * @param markdown `true` para formatar as partes como Markdown.
+ * @param prioridade Prioridade de todas as partes.
+ */
+void notificarEmPartes(const char* texto, bool markdown, PrioridadeNotificacao prioridade){
+  char parte[NOTIF_TEXTO_MAX];
+  while(*texto != '\0'){
+    size_t tam = strlen(texto);
+    bool formatada = markdown;
+    if(tam >= sizeof(parte)){
+      size_t corte = sizeof(parte) - 1;
+      while(corte > 0 && texto[corte] != '\n'){
+        corte--;
+      }
+      if(corte == 0){
+        corte = sizeof(parte) - 1;
+        formatada = false; // Uma linha maior que a parte é cortada e vai sem formatação.
+      }
+      tam = corte;
+    }
+    memcpy(parte, texto, tam);
+    parte[tam] = '\0';
+    notificar(parte, formatada, prioridade);
+    texto += tam;
+    if(*texto == '\n'){
+      texto++;
+    }
+  }
+}
+
+/**
+ * @brief Coloca na fila a nova versão da mensagem de um incidente, sem bloquear.
+ * A tarefa de rede reescreve a mensagem anterior do mesmo incidente, se houver.
+ * @param texto O resumo do incidente.
+ * @param incidente O número do incidente (`incidente.numero`).
+ */
+void notificarIncidente(const char* texto, uint32_t incidente){
+  Notificacao n;
+  n.tipo = NOTIF_INCIDENTE;
+  n.prioridade = PRIO_NORMAL;
+  n.markdown = false;
+  n.incidente = incidente;
+  strlcpy(n.texto, texto, sizeof(n.texto));
+  if(xQueueSend(filaNotificacoes, &n, 0) != pdTRUE){
+    Serial.println("Fila de notificações cheia: atualização do incidente descartada.");
+  }
+}
+
+/**
+ * @brief Pede à tarefa de rede que envie o relatório de log, sem bloquear.
+ * @param filtro Os filtros pedidos no comando `/logs`.
+ */
+void solicitarEnvioLogs(const FiltroLogs& filtro){
+  Notificacao n;
+  n.tipo = NOTIF_ENVIAR_LOGS;
+  n.prioridade = PRIO_NORMAL;
+  n.markdown = false;
+  n.filtro = filtro;
+  n.texto[0] = '\0';
+  if(xQueueSend(filaNotificacoes, &n, 0) != pdTRUE){
+    Serial.println("Fila de notificações cheia: envio de logs descartado.");
+  }
+}
+
+/**
+ * @brief Pede à tarefa de rede que envie as métricas ao chat, sem bloquear.
+ */
+void solicitarMetricas(){
+  Notificacao n;
+  n.tipo = NOTIF_METRICAS;
+  n.prioridade = PRIO_NORMAL;
+  n.markdown = true;
+  n.texto[0] = '\0';
+  if(xQueueSend(filaNotificacoes, &n, 0) != pdTRUE){
+    Serial.println("Fila de notificações cheia: envio de métricas descartado.");
+  }
+}
+#else
+/**
+ * @brief Sem o Telegram, as notificações saem só na serial.
+ */
+void notificar(const char* texto, bool markdown, PrioridadeNotificacao prioridade){
+  (void)markdown;
+  Serial.print(prioridade == PRIO_ALERTA ? "[ALERTA] " : "[AVISO] ");
+  Serial.println(texto);
+}
+
+/**
+ * @brief Sem o Telegram, cada versão da mensagem do incidente sai na serial.
+ */
+void notificarIncidente(const char* texto, uint32_t incidente){
+  Serial.printf("[INCIDENTE %lu] %s\n", (unsigned long)incidente, texto);
+}
+#endif
+
+
+// =================================================================================
+// --- FUNÇÕES DE VERIFICAÇÃO E CONTROLE ---
+// =================================================================================
+
+/**
+ * @brief Configura o Wi-Fi em modo estação, registra o callback de eventos e
+ * dispara a primeira tentativa de conexão. Não espera pelo resultado.
+ */
+void iniciarWiFi(){
+  WiFi.mode(WIFI_STA);
+  if(ECONOMIA_ENERGIA){
+    WiFi.setSleep(WIFI_PS_MAX_MODEM); // Rádio ligado a cada 3 beacons; os envios o acordam na hora.
+  }
+  WiFi.setAutoReconnect(false); // As reconexões são controladas por `atualizarWiFi()`.
+  WiFi.onEvent(aoEventoWiFi);
+  iniciarTentativaWiFi();
+}
+
+/**
+ * @brief Callback do driver de Wi-Fi. Roda na tarefa de eventos do sistema, então
+ * apenas marca o que aconteceu para a tarefa de rede tratar.
+ */
+void aoEventoWiFi(arduino_event_id_t evento, arduino_event_info_t info){
+  if(evento == ARDUINO_EVENT_WIFI_STA_GOT_IP){
+    eventosWiFi.fetch_or(WIFI_BIT_CONECTOU);
+  } else if(evento == ARDUINO_EVENT_WIFI_STA_LOST_IP){
+    eventosWiFi.fetch_or(WIFI_BIT_CAIU);
+  } else if(evento == ARDUINO_EVENT_WIFI_STA_DISCONNECTED &&
+            info.wifi_sta_disconnected.reason != WIFI_REASON_ASSOC_LEAVE){
+    // ASSOC_LEAVE é a própria estação saindo: não conta como queda nem como falha.
+    eventosWiFi.fetch_or(WIFI_BIT_CAIU);
+  }
+}
+
+/**
+ * @brief Começa uma tentativa de conexão (não bloqueante).
+ */
+void iniciarTentativaWiFi(){
+  Serial.println("Conectando ao WiFi...");
+  WiFi.begin(ssid, password);
+  inicioTentativaWiFi = millis();
+  estadoWiFi = WIFI_CONECTANDO;
+}
+
+/**
+ * @brief Agenda a próxima tentativa com espera exponencial e variação aleatória:
+ * a espera fica entre metade e o total de `inicial * 2^falhas`, limitada ao teto.
+ */
+void agendarNovaTentativaWiFi(){
+  uint32_t espera = WIFI_ESPERA_INICIAL_MS << min<uint8_t>(falhasSeguidasWiFi, 6);
+  espera = min(espera, WIFI_ESPERA_MAXIMA_MS);
+  espera = espera / 2 + esp_random() % (espera / 2 + 1);
+  proximaTentativaWiFi = millis() + espera;
+  estadoWiFi = WIFI_AGUARDANDO;
+  Serial.printf("Nova tentativa de WiFi em %lu ms.\n", (unsigned long)espera);
+}
+
+/**
+ * @brief Avança a máquina de estados do Wi-Fi. Chamada a cada volta da tarefa de
+ * rede; retorna imediatamente em todos os estados.
+ */
+void atualizarWiFi(){
+  uint32_t eventos = eventosWiFi.exchange(0);
+  uint32_t agora = millis();
+
+  switch(estadoWiFi){
+    case WIFI_CONECTANDO:
+      if(eventos & WIFI_BIT_CONECTOU){
+        estadoWiFi = WIFI_CONECTADO;
+        falhasSeguidasWiFi = 0;
+        Serial.println("WiFi conectado com sucesso.");
+        logEvento(EVT_WIFI_CONECTADO, ORIGEM_SISTEMA, agora - inicioTentativaWiFi);
+        if(quedaWiFiEmAndamento){ // Estava conectado antes e caiu: registra a duração da queda.
+          reconexoesWiFi++;
+          logEvento(EVT_WIFI_RESTABELECIDO, ORIGEM_SISTEMA, (agora - inicioQuedaWiFi) / 1000);
+          notificar("✅ Sentinela: Conexão Wi-Fi restabelecida!", false, PRIO_INFO);
+          quedaWiFiEmAndamento = false;
+        }
+      } else if((eventos & WIFI_BIT_CAIU) || agora - inicioTentativaWiFi > WIFI_TIMEOUT_TENTATIVA_MS){
+        if(falhasSeguidasWiFi < 255){
+          falhasSeguidasWiFi++;
+        }
+        Serial.println("Falha ao conectar no WiFi.");
+        // Numa queda longa, só parte das falhas vai para o log, para não gastar o espaço da rotação.
+        if(falhasSeguidasWiFi <= 3 || falhasSeguidasWiFi % 10 == 0){
+          logEvento(EVT_WIFI_FALHA, ORIGEM_SISTEMA, falhasSeguidasWiFi);
+        }
+        agendarNovaTentativaWiFi();
+      }
+      break;
+
+    case WIFI_CONECTADO:
+      if(eventos & WIFI_BIT_CAIU){ // Estava conectado e caiu...
+#if SENTINELA_COM_TELEGRAM
+        client.stop(); // A sessão TLS morreu com a rede; libera a memória dela.
+#endif
+        inicioQuedaWiFi = agora;
+        quedaWiFiEmAndamento = true;
+        quedasWiFi++;
+        logEvento(EVT_WIFI_PERDIDO, ORIGEM_SISTEMA, 0);
+        agendarNovaTentativaWiFi(); // Sem falhas seguidas, a primeira nova tentativa é rápida.
+      }
+      break;
+
+    case WIFI_AGUARDANDO:
+      if((int32_t)(agora - proximaTentativaWiFi) >= 0){
+        iniciarTentativaWiFi();
+      }
+      break;
+  }
+}
+
+#if SENTINELA_COM_TELEGRAM
+/**
+ * @brief Tarefa FreeRTOS de recepção de comandos. Fica a maior parte do tempo presa
+ * no `getUpdates` com long polling, sem atrasar os envios da tarefa de rede.
+ */
+void tarefaPolling(void* parametro){
+  clientPolling.setCACert(TELEGRAM_CERTIFICATE_ROOT);
+  botPolling.longPoll = TELEGRAM_LONG_POLL_S;
+  botPolling.last_message_received = ultimaMensagemRestaurada; // Não relê comandos já tratados.
+  for(;;){
+    if(WiFi.status() != WL_CONNECTED){
+      clientPolling.stop(); // A sessão morreu com a rede; libera a memória dela.
+      vTaskDelay(pdMS_TO_TICKS(500));
+      continue;
+    }
+    checarTelegram();
+  }
+}
+
+/**
+ * @brief Verifica se há novas mensagens do Telegram. Com long polling, retorna assim
+ * que uma mensagem chega ou quando o timeout do servidor expira.
+ */
+void checarTelegram(){
+  if(!garantirSessaoTelegram(clientPolling)){
+    vTaskDelay(pdMS_TO_TICKS(msgInterval)); // Tenta de novo no próximo intervalo.
+    return;
+  }
+  uint32_t inicio = millis();
+  uint32_t inicioUs = micros();
+  // Pede ao bot por novas mensagens.
+  int numNewMessages = botPolling.getUpdates(botPolling.last_message_received + 1);
+  registrarMetrica(MET_GET_UPDATES, micros() - inicioUs);
+  // Itera sobre cada nova mensagem recebida.
+  for (int i = 0; i < numNewMessages; i++) {
+    handleNewMessage(botPolling.messages[i]);
+  }
+
+  // No polling curto, espera o intervalo. No long polling, uma resposta vazia e
+  // rápida indica erro do servidor: espera também, para não martelar a API.
+  bool respostaVaziaRapida = numNewMessages == 0 && millis() - inicio < 1000;
+  if(TELEGRAM_LONG_POLL_S == 0 || respostaVaziaRapida){
+    vTaskDelay(pdMS_TO_TICKS(msgInterval));
+  }
+}
+
+/**
+ * @brief Garante que uma conexão TLS com o Telegram esteja aberta, reaproveitando a
+ * existente. Só faz um novo handshake se a anterior tiver caído, e mede sua duração.
+ * Cada conexão deve ser usada por uma única tarefa (`client` pela de rede,
+ * `clientPolling` pela de polling, `clientTrabalho` pela de trabalho).
+ * @param conexao A conexão a ser verificada.
+ * @return `true` se há uma conexão pronta para uso.
+ */
+bool garantirSessaoTelegram(WiFiClientSecure& conexao){
+  if(conexao.connected()){
+    return true; // Conexão quente: nenhum handshake necessário.
+  }
+  uint32_t inicio = millis();
+  bool conectou = conexao.connect(TELEGRAM_HOST, TELEGRAM_SSL_PORT);
+  uint32_t duracao = millis() - inicio;
+  portENTER_CRITICAL(&muxTls);
+  if(conectou){
+    tlsHandshakes++;
+    tlsUltimoHandshakeMs = duracao;
+    tlsTotalHandshakeMs += duracao;
+    if(duracao > tlsMaiorHandshakeMs){
+      tlsMaiorHandshakeMs = duracao;
+    }
+  } else {
+    tlsFalhas++;
+  }
+  portEXIT_CRITICAL(&muxTls);
+  if(!conectou){
+    Serial.printf("Falha no handshake TLS com o Telegram (%lu ms).\n", (unsigned long)duracao);
+  }
+  return conectou;
+}
+
+/**
+ * @brief Executa os comandos que a tarefa de rede recebeu do Telegram.
+ * Não bloqueia: apenas esvazia o que já estiver na fila.
+ */
+void checarComandos(){
+  Comando cmd;
+  while(xQueueReceive(filaComandos, &cmd, 0) == pdTRUE){
+    executarComando(cmd);
+  }
+}
+#endif
+
+#if SENTINELA_COM_RF
+
+/**
+ * @brief Callback do `esp_timer` (tarefa do timer, acima da rede): tira o quadro do
+ * RCSwitch e o carimba. Um controle repete o mesmo quadro várias vezes por toque (e sem
+ * parar enquanto o botão fica apertado): só o primeiro de cada rajada entra em `filaRF`.
+ */
+void amostrarRF(void* arg){
+  if(!rfReceiver.available()){
+    return;
+  }
+  QuadroRF q;
+  q.codigo = rfReceiver.getReceivedValue();
+  q.protocolo = rfReceiver.getReceivedProtocol();
+  q.bits = rfReceiver.getReceivedBitlength();
+  q.instanteUs = micros();
+  rfReceiver.resetAvailable(); // Prepara para receber o próximo.
+
+  bool repeticao = rajadaRF.ativa && q.codigo == rajadaRF.codigo && q.protocolo == rajadaRF.protocolo &&
+                   q.bits == rajadaRF.bits && q.instanteUs - rajadaRF.ultimoQuadroUs < RF_INTERVALO_RAJADA_US;
+  rajadaRF.ultimoQuadroUs = q.instanteUs; // Cada repetição prolonga a rajada.
+  if(repeticao){
+    rfRepeticoesSuprimidas++;
+    return;
+  }
+  rajadaRF.ativa = true;
+  rajadaRF.codigo = q.codigo;
+  rajadaRF.protocolo = q.protocolo;
+  rajadaRF.bits = q.bits;
+  xQueueSend(filaRF, &q, 0);
+}
+
+/**
+ * @brief Trata os quadros RF já separados em rajadas por `amostrarRF()`.
+ */
+void checarRF(){
+  QuadroRF q;
+  while(xQueueReceive(filaRF, &q, 0) == pdTRUE){
+    Serial.printf("Sinal RF recebido: %lu (protocolo %u, %u bits)\n", (unsigned long)q.codigo,
+                  (unsigned)q.protocolo, (unsigned)q.bits);
+    handleRF(q.codigo, q.instanteUs); // Processa o código.
+  }
+  verificarPendenciasRF();
+}
+#endif
+
+/**
+ * @brief Esvazia o buffer de eventos das interrupções: as bordas das zonas atualizam as
+ * máscaras de zonas (avaliadas por `avaliarZonas()`) e as do botão passam pelo debounce.
+ * O debounce do botão é feito pelos instantes das bordas: o novo nível só é aceito
+ * depois de ficar estável por `DEBOUNCE_BOTAO_US`.
+ */
+void checarEntradas(){
+#if SENTINELA_COM_BOTAO
+  // O nível inicial é lido do pino na primeira chamada; daí em diante só a ISR o atualiza.
+  static uint8_t nivelBotaoBruto = PinoGPIO<BUTTON_PIN>::ler(); // Último nível visto pela ISR.
+  static uint8_t nivelBotaoEstavel = nivelBotaoBruto;         // Nível já aceito pelo debounce.
+  static uint32_t ultimaBordaBotaoUs = 0;
+#endif
+  static uint32_t perdidasReportadas = 0;
+
+  EventoEntrada e;
+  while(consumirEntrada(e)){
+    if(e.tipo == ENTRADA_ZONA){
+      uint16_t bit = 1u << e.zona;
+      bool ativo = (e.nivel == HIGH) == ((mascaraAtivoEmAlto & bit) != 0);
+      if(ativo){
+        // A borda fica registrada mesmo que o pulso já tenha terminado.
+        zonasAbertas |= bit;
+        zonasAcionadas |= bit;
+        instanteZonaUs[e.zona] = e.instanteUs;
+      } else {
+        zonasAbertas &= ~bit;
+      }
+    } else {
+#if SENTINELA_COM_BOTAO
+      nivelBotaoBruto = e.nivel;
+      ultimaBordaBotaoUs = e.instanteUs;
+#endif
+    }
+  }
+
+#if SENTINELA_COM_BOTAO
+  // Se o nível do botão permaneceu estável pelo tempo de debounce...
+  if(nivelBotaoBruto != nivelBotaoEstavel && (micros() - ultimaBordaBotaoUs) > DEBOUNCE_BOTAO_US){
+    nivelBotaoEstavel = nivelBotaoBruto;
+    // E se a mudança foi de HIGH para LOW (botão foi pressionado)...
+    if(nivelBotaoEstavel == LOW){
+      // Alterna o estado do sistema.
+      if(sistemaArmado()){
+        desarmarSistema(ORIGEM_BOTAO);
+      } else {
+        armarSistema(ORIGEM_BOTAO);
+      }
+    }
+  }
+#endif
+
+  if(entradasPerdidas != perdidasReportadas){
+    perdidasReportadas = entradasPerdidas;
+    Serial.printf("Aviso: %lu bordas de entrada perdidas (buffer cheio).\n", (unsigned long)perdidasReportadas);
+  }
+}
+
+
+// =================================================================================
+// --- FUNÇÕES DE LÓGICA DO ALARME ---
+// =================================================================================
+
+/**
+ * @brief `true` em qualquer estado que não seja o desarmado (inclui saída, entrada e disparo).
+ */
+bool sistemaArmado(){
+  return estadoAlarme != ALARME_DESARMADO;
+}
+
+/** @brief `true` se toda zona com fio usa um GPIO que existe no ESP32 (0 a 39). */
+constexpr bool pinosDasZonasValidos(){
+  for(const ConfigZona& c : CONFIG_ZONAS){
+    if(c.pino < -1 || c.pino >= 40) return false;
+  }
+  return true;
+}
+static_assert(pinosDasZonasValidos(), "CONFIG_ZONAS: GPIO inexistente no ESP32 (use -1 numa zona só RF).");
+
+/**
+ * @brief Expande `CONFIG_ZONAS` nos arrays e máscaras e configura os pinos dos sensores.
+ * Os níveis iniciais dos sensores com GPIO são lidos aqui; depois, só as ISRs os atualizam.
+ */
+void iniciarZonas(){
+  for(uint8_t z = 0; z < TOTAL_ZONAS; z++){
+    const ConfigZona& c = CONFIG_ZONAS[z];
+    uint16_t bit = 1u << z;
+    pinoZona[z] = c.pino;
+    atrasoEntradaZonaUs[z] = (uint32_t)c.atrasoEntradaS * 1000000;
+    atrasoSaidaZonaUs[z] = (uint32_t)c.atrasoSaidaS * 1000000;
+    switch(c.tipo){
+      case ZONA_RETARDADA: mascaraRetardadas |= bit; break;
+      case ZONA_24H:       mascara24h |= bit; break;
+      default:             mascaraInstantaneas |= bit; break;
+    }
+    if(c.ativoEmAlto){
+      mascaraAtivoEmAlto |= bit;
+    }
+    if(c.pino >= 0){
+      pinMode(c.pino, c.ativoEmAlto ? INPUT : INPUT_PULLUP);
+      if((digitalRead(c.pino) == HIGH) == c.ativoEmAlto){
+        zonasAbertas |= bit;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Uma volta da máquina de estados: conclui os atrasos de saída e de entrada e
+ * resume as zonas acionadas em um evento por classe, com operações de bits.
+ * Chamada a cada volta do loop, logo após `checarEntradas()`.
+ */
+void avaliarZonas(){
+  uint32_t agora = micros();
+
+  // Atraso de saída: cada zona passa a valer quando o seu prazo termina.
+  if(zonasEmSaida != 0){
+    for(uint16_t m = zonasEmSaida; m != 0; m &= m - 1){
+      uint8_t z = __builtin_ctz(m);
+      if(agora - inicioSaidaUs >= atrasoSaidaZonaUs[z]){
+        zonasEmSaida &= ~(1u << z);
+        zonasArmadas |= 1u << z;
+      }
+    }
+    if(zonasEmSaida == 0){
+      processarEventoAlarme(EA_FIM_SAIDA, agora, 0);
+    }
+  }
+
+  // Bordas registradas e sensores que continuam acionados (ex.: armou com o PIR em HIGH).
+  uint16_t acionadas = (zonasAcionadas | zonasAbertas) & ~zonasIgnoradas;
+  uint16_t bordas = zonasAcionadas;
+  zonasAcionadas = 0;
+
+  // Com a sirene já tocando, novas bordas não mudam o estado, mas contam no incidente; só
+  // uma zona que o incidente ainda não tinha visto gera um alerta.
+  if(estadoAlarme == ALARME_DISPARADO && INCIDENTE_JANELA_S > 0){
+    uint16_t novas = bordas & (zonasArmadas | mascara24h) & ~zonasIgnoradas;
+    if(novas != 0){
+      alertarEscalada(registrarAcertoIncidente(novas, false));
+    }
+  }
+
+  uint16_t z24 = acionadas & mascara24h;
+  uint16_t instantaneas = acionadas & zonasArmadas & mascaraInstantaneas;
+  uint16_t retardadas = acionadas & zonasArmadas & mascaraRetardadas;
+  uint16_t disparo = z24 ? z24 : instantaneas;
+  if(disparo != 0){
+    uint8_t z = __builtin_ctz(disparo);
+    zonasDisparadas |= disparo;
+    uint32_t instante = (bordas & (1u << z)) ? instanteZonaUs[z] : agora;
+    processarEventoAlarme(z24 ? EA_ZONA_24H : EA_ZONA_INSTANTANEA, instante, z);
+  } else if(retardadas != 0){
+    processarEventoAlarme(EA_ZONA_RETARDADA, agora, __builtin_ctz(retardadas));
+  }
+
+  if(estadoAlarme == ALARME_ENTRADA && agora - inicioEntradaUs >= atrasoEntradaAtualUs){
+    processarEventoAlarme(EA_FIM_ENTRADA, agora, zonaDisparo);
+  }
+}
+
+/**
+ * @brief Aplica um evento à máquina de estados e executa a ação de entrada no novo estado.
+ * Um evento que não muda o estado não faz nada.
+ * @param evento O evento ocorrido.
+ * @param instanteUs O instante (em us, de `micros()`) do sinal que gerou o evento.
+ * @param zona O índice da zona envolvida (eventos de zona).
+ */
+void processarEventoAlarme(EventoAlarme evento, uint32_t instanteUs, uint8_t zona){
+  EstadoAlarme novo = TRANSICOES_ALARME[estadoAlarme][evento];
+  if(novo == estadoAlarme){
+    return;
+  }
+  estadoAlarme = novo;
+  switch(novo){
+    case ALARME_DISPARADO:
+      dispararAlarme(instanteUs, evento == EA_PANICO ? CAUSA_PANICO : CAUSA_ZONA, zona);
+      break;
+    case ALARME_ENTRADA:
+      inicioEntradaUs = instanteUs;
+      atrasoEntradaAtualUs = atrasoEntradaZonaUs[zona];
+      zonaDisparo = zona; // Se o atraso terminar, é esta zona que dispara.
+      zonasDisparadas |= 1u << zona;
+      break;
+    case ALARME_SAIDA: {
+      // Zonas sem atraso de saída valem já; as demais esperam em `zonasEmSaida`.
+      uint16_t todas = (uint16_t)((1u << TOTAL_ZONAS) - 1) & ~zonasIgnoradas;
+      zonasEmSaida = 0;
+      for(uint8_t z = 0; z < TOTAL_ZONAS; z++){
+        if(atrasoSaidaZonaUs[z] > 0){
+          zonasEmSaida |= 1u << z;
+        }
+      }
+      zonasEmSaida &= todas;
+      zonasArmadas = todas & ~zonasEmSaida;
+      inicioSaidaUs = instanteUs;
+      break;
+    }
+    case ALARME_DESARMADO:
+      PinoRele::escrever(false); // Desliga o relé, parando a sirene.
+      manterAcordado(false);
+      zonasArmadas = 0;
+      zonasEmSaida = 0;
+      zonasIgnoradas = 0;
+      zonasDisparadas = 0;
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief Ativa a sirene. O relé é acionado antes de qualquer outra coisa; o log e a
+ * notificação ficam para `concluirDisparo()`, fora do caminho crítico.
+ * @param instanteBordaUs O instante (em us, de `micros()`) do sinal que causou o disparo.
+ * @param causa Zona ou pânico.
+ * @param zona O índice da zona (só para CAUSA_ZONA).
+ */
+void dispararAlarme(uint32_t instanteBordaUs, CausaDisparo causa, uint8_t zona){
+  PinoRele::escrever(true); // Liga o relé, acionando a sirene.
+  latenciaDisparoUs = micros() - instanteBordaUs;
+  manterAcordado(true);
+  causaDisparo = causa;
+  zonaDisparo = zona;
+  disparoPendente = true;        // O restante do trabalho é feito depois.
+  agendarTrabalho(idTrabalhoDisparo, 0);
+}
+
+/**
+ * @brief Segundo estágio do disparo: notifica o usuário e registra no log. Um novo disparo
+ * de uma zona que já está no incidente aberto (ex.: rearmado com alguém ainda circulando)
+ * só entra na contagem e na mensagem do incidente; o pânico sempre gera o alerta.
+ */
+void concluirDisparo(){
+  if(!disparoPendente){
+    return;
+  }
+  disparoPendente = false;
+  if(causaDisparo == CAUSA_PANICO){
+    registrarAcertoIncidente(0, true);
+    notificar("🚨 PÂNICO! Acionado pelo controle RF! Sirene disparada!", false, PRIO_ALERTA);
+    logEventoCritico(EVT_PANICO, ORIGEM_RF, 0);
+    return;
+  }
+  bool medida = pinoZona[zonaDisparo] >= 0; // A latência só é medida a partir da borda de um GPIO.
+  if(medida){
+    registrarMetrica(MET_PIR_SIRENE, latenciaDisparoUs);
+  }
+  if(registrarAcertoIncidente(1u << zonaDisparo, false) == 0){
+    return;
+  }
+  char msg[NOTIF_TEXTO_MAX];
+  snprintf(msg, sizeof(msg), "⚠️ ALERTA! Zona %u (%s) acionada! Sirene disparada!",
+           (unsigned)(zonaDisparo + 1), CONFIG_ZONAS[zonaDisparo].nome);
+  notificar(msg, false, PRIO_ALERTA);
+  logEventoCritico(EVT_ZONA_DISPARADA, ORIGEM_SISTEMA, zonaDisparo + 1);
+  if(medida){
+    logEvento(EVT_ALARME_DISPARADO, ORIGEM_SISTEMA, latenciaDisparoUs);
+  }
+}
+
+/**
+ * @brief Conta um acionamento no incidente aberto, ou abre um novo.
+ * @param zonas Máscara das zonas acionadas (0 para o pânico).
+ * @param panico `true` se o acionamento foi o pânico.
+ * @return As zonas que o incidente ainda não tinha (todas, num incidente novo ou com a
+ * correlação desligada); só elas merecem um alerta.
+ */
+uint16_t registrarAcertoIncidente(uint16_t zonas, bool panico){
+  if(INCIDENTE_JANELA_S == 0){
+    return zonas;
+  }
+  uint32_t agora = micros();
+  if(!incidente.aberto){
+    uint32_t numero = incidente.numero + 1;
+    incidente = {};
+    incidente.aberto = true;
+    incidente.numero = numero;
+    incidente.ultimaAtualizacaoUs = agora; // O alerta vale como primeira notícia do incidente.
+  } else {
+    incidente.duracaoMs += (agora - incidente.ultimoAcertoUs) / 1000;
+    incidente.pendente = true;
+  }
+  incidente.ultimoAcertoUs = agora;
+  uint32_t acertos = incidente.acertos + (zonas ? __builtin_popcount(zonas) : 1);
+  incidente.acertos = acertos > 0xFFFF ? 0xFFFF : acertos;
+  uint16_t novas = zonas & ~incidente.zonas;
+  incidente.zonas |= zonas;
+  incidente.panico |= panico;
+  return novas;
+}
+
+/**
+ * @brief Alerta as zonas que entraram num incidente com a sirene já tocando (a escalada:
+ * o intruso passou para outro cômodo). As que o incidente já tinha só contam.
+ * @param zonas Máscara devolvida por `registrarAcertoIncidente()`.
+ */
+void alertarEscalada(uint16_t zonas){
+  if(zonas == 0){
+    return;
+  }
+  char lista[48];
+  formatarZonas(zonas, lista, sizeof(lista));
+  char msg[NOTIF_TEXTO_MAX];
+  snprintf(msg, sizeof(msg), "⚠️ ALERTA! Mais zonas acionadas com a sirene tocando: %s.", lista);
+  notificar(msg, false, PRIO_ALERTA);
+  for(uint16_t resto = zonas; resto != 0; resto &= resto - 1){
+    logEventoCritico(EVT_ZONA_DISPARADA, ORIGEM_SISTEMA, __builtin_ctz(resto) + 1);
+  }
+}
+
+/**
+ * @brief Trabalho periódico: reescreve a mensagem do incidente quando há acionamentos
+ * novos (no máximo a cada `INCIDENTE_ATUALIZACAO_US`) e o encerra após a janela de silêncio.
+ */
+void verificarIncidente(){
+  if(!incidente.aberto){
+    return;
+  }
+  uint32_t agora = micros();
+  if(agora - incidente.ultimoAcertoUs >= INCIDENTE_JANELA_US){
+    encerrarIncidente();
+    return;
+  }
+  if(incidente.pendente && agora - incidente.ultimaAtualizacaoUs >= INCIDENTE_ATUALIZACAO_US){
+    char texto[NOTIF_TEXTO_MAX];
+    descreverIncidente("🔁 Incidente em andamento", texto, sizeof(texto));
+    notificarIncidente(texto, incidente.numero);
+    incidente.pendente = false;
+    incidente.divulgado = true;
+    incidente.ultimaAtualizacaoUs = agora;
+  }
+}
+
+/**
+ * @brief Fecha o incidente: grava o registro agregado (o único registro dos acionamentos
+ * que não geraram alerta) e, se a mensagem do incidente chegou a ser enviada (ou tinha
+ * algo por mostrar), deixa nela o resumo final.
+ */
+void encerrarIncidente(){
+  incidente.aberto = false;
+  uint32_t minutos = (incidente.duracaoMs + 59999) / 60000;
+  uint32_t acertos = incidente.acertos > 0xFF ? 0xFF : incidente.acertos;
+  uint32_t valor = incidente.zonas | (acertos << 16) | ((minutos > 0xFF ? 0xFF : minutos) << 24);
+  logEventoCritico(EVT_INCIDENTE, ORIGEM_SISTEMA, valor);
+  if(incidente.divulgado || incidente.pendente){
+    char texto[NOTIF_TEXTO_MAX];
+    descreverIncidente("✅ Incidente encerrado", texto, sizeof(texto));
+    notificarIncidente(texto, incidente.numero);
+  }
+}
+
+/**
+ * @brief Resume o incidente atual, ex.: "🔁 Incidente em andamento: 7 acionamento(s)
+ * em 3 min (zonas 1, 3)."
+ */
+void descreverIncidente(const char* titulo, char* destino, size_t tam){
+  char zonas[48];
+  formatarZonas(incidente.zonas, zonas, sizeof(zonas));
+  uint32_t segundos = incidente.duracaoMs / 1000;
+  char duracao[16];
+  if(segundos < 60){
+    snprintf(duracao, sizeof(duracao), "%lu s", (unsigned long)segundos);
+  } else {
+    snprintf(duracao, sizeof(duracao), "%lu min", (unsigned long)(segundos / 60));
+  }
+  snprintf(destino, tam, "%s: %u acionamento(s) em %s (zonas %s)%s.", titulo,
+           (unsigned)incidente.acertos, duracao, zonas, incidente.panico ? ", com pânico" : "");
+}
+
+/**
+ * @brief Desarma o sistema, desliga a sirene e notifica o usuário.
+ * @param origem A fonte do comando (ex: ORIGEM_TELEGRAM, ORIGEM_RF).
+ */
+void desarmarSistema(OrigemEvento origem){
+  processarEventoAlarme(EA_DESARMAR, micros(), 0);
+  salvarEstado();
+  char msg[NOTIF_TEXTO_MAX];
+  snprintf(msg, sizeof(msg), "✅ Sistema DESARMADO com sucesso pela origem: %s", NOMES_ORIGEM[origem]);
+  notificar(msg, false, PRIO_NORMAL);
+  logEventoCritico(EVT_SISTEMA_DESARMADO, origem, 0);
+}
+
+/**
+ * @brief Arma o sistema e notifica o usuário. Zonas com atraso de saída só passam a
+ * valer quando ele termina.
+ * @param origem A fonte do comando (ex: ORIGEM_TELEGRAM, ORIGEM_RF).
+ */
+void armarSistema(OrigemEvento origem){
+  if(sistemaArmado()){ // Só arma se já não estiver armado.
+    notificar("ℹ️ O sistema já se encontra armado.", false, PRIO_INFO);
+    return;
+  }
+  processarEventoAlarme(EA_ARMAR, micros(), 0);
+  salvarEstado();
+  char msg[NOTIF_TEXTO_MAX];
+  snprintf(msg, sizeof(msg), "🔒 Sistema ARMADO com sucesso pela origem: %s", NOMES_ORIGEM[origem]);
+  notificar(msg, false, PRIO_NORMAL);
+  logEventoCritico(EVT_SISTEMA_ARMADO, origem, 0);
+}
+
+/**
+ * @brief Alterna o bypass de uma zona. O bypass vale até o próximo desarme.
+ * @param zona O índice da zona.
+ * @param origem Quem pediu (Telegram ou MQTT), para o log.
+ */
+void alternarBypassZona(uint8_t zona, OrigemEvento origem){
+  uint16_t bit = 1u << zona;
+  zonasIgnoradas ^= bit;
+  bool ignorada = (zonasIgnoradas & bit) != 0;
+  if(ignorada){
+    zonasArmadas &= ~bit;
+    zonasEmSaida &= ~bit;
+    logEvento(EVT_ZONA_IGNORADA, origem, zona + 1);
+  } else if(sistemaArmado()){
+    zonasArmadas |= bit; // Reincluída com o sistema armado (ou na saída): passa a valer na hora.
+  }
+  char msg[NOTIF_TEXTO_MAX];
+  snprintf(msg, sizeof(msg), ignorada ? "🚫 Zona %u (%s) ignorada até o próximo desarme."
+                                      : "✅ Zona %u (%s) voltou a ser monitorada.",
+           (unsigned)(zona + 1), CONFIG_ZONAS[zona].nome);
+  notificar(msg, false, PRIO_NORMAL);
+}
+
+/**
+ * @brief Escreve os números (a partir de 1) das zonas de uma máscara, ex.: "1, 3".
+ */
+void formatarZonas(uint16_t mascara, char* destino, size_t tam){
+  size_t pos = 0;
+  destino[0] = '\0';
+  for(uint16_t m = mascara; m != 0 && pos < tam; m &= m - 1){
+    pos += snprintf(destino + pos, tam - pos, pos ? ", %u" : "%u", (unsigned)(__builtin_ctz(m) + 1));
+  }
+  if(mascara == 0){
+    strlcpy(destino, "nenhuma", tam);
+  }
+}
+
+#if SENTINELA_COM_RF
+/**
+ * @brief Marca uma zona como acionada por um sensor RF; `avaliarZonas()` decide o que fazer.
+ * @param zona O índice da zona.
+ * @param instanteUs Recepção do quadro (`micros()`), para a latência do disparo.
+ */
+void acionarZonaRF(uint8_t zona, uint32_t instanteUs){
+  zonasAcionadas |= 1u << zona;
+  instanteZonaUs[zona] = instanteUs;
+}
+#endif
+
+
+/**
+ * @brief Soma de verificação FNV-1a de um instantâneo (sem o campo `soma`).
+ */
+uint32_t somaInstantaneo(const InstantaneoEstado& e){
+  const uint8_t* bytes = (const uint8_t*)&e;
+  uint32_t h = 2166136261u;
+  for(size_t i = 0; i < offsetof(InstantaneoEstado, soma); i++){
+    h = (h ^ bytes[i]) * 16777619u;
+  }
+  return h;
+}
+
+/**
+ * @brief `true` se o instantâneo é desta versão, está íntegro e tem um estado conhecido.
+ */
+bool instantaneoValido(const InstantaneoEstado& e){
+  return e.versao == INSTANTANEO_VERSAO && e.soma == somaInstantaneo(e) &&
+         (e.estado == ALARME_DESARMADO || e.estado == ALARME_ARMADO || e.estado == ALARME_DISPARADO);
+}
+
+/**
+ * @brief Fotografa o estado atual no formato do instantâneo. Saída e entrada contam como
+ * armado: é assim que voltam de um reinício, então trocar entre eles não grava nada.
+ */
+InstantaneoEstado montarInstantaneo(){
+  InstantaneoEstado e = {};
+  e.versao = INSTANTANEO_VERSAO;
+  e.estado = estadoAlarme == ALARME_DISPARADO ? ALARME_DISPARADO
+           : (sistemaArmado() ? ALARME_ARMADO : ALARME_DESARMADO);
+  e.zonasIgnoradas = zonasIgnoradas;
+  if(estadoAlarme == ALARME_DISPARADO){
+    e.causa = causaDisparo;
+    e.zonaDisparo = zonaDisparo;
+    e.zonasDisparadas = zonasDisparadas;
+  }
+#if SENTINELA_COM_TELEGRAM
+  e.ultimaMensagemTelegram = (int32_t)botPolling.last_message_received;
+  e.saidaConfirmada = ultimaConfirmadaSaida;
+#endif
+  return e;
+}
+
+/**
+ * @brief Restaura o estado do boot anterior: a cópia íntegra mais nova entre a RTC e as
+ * duas chaves da NVS ou, sem nenhuma, a chave `armado` do formato antigo. O armado volta
+ * sem atraso de saída (ninguém está saindo após um reinício) e o disparado religa a sirene.
+ */
+void restaurarEstado(){
+  InstantaneoEstado melhor = {};
+  if(instantaneoValido(instantaneoRtc)){
+    melhor = instantaneoRtc;
+    origemInstantaneo = INST_RTC;
+  }
+  preferencias.begin(NVS_NAMESPACE, true); // Somente leitura.
+  for(uint8_t i = 0; i < 2; i++){
+    InstantaneoEstado e;
+    if(preferencias.getBytes(NVS_CHAVES_INSTANTANEO[i], &e, sizeof(e)) == sizeof(e) && instantaneoValido(e) &&
+       (origemInstantaneo == INST_NENHUM || (int32_t)(e.geracao - melhor.geracao) > 0)){
+      melhor = e;
+      origemInstantaneo = INST_NVS;
+      chaveNvsInstantaneo = 1 - i; // A próxima gravação preserva esta cópia.
+    }
+  }
+  if(origemInstantaneo == INST_NENHUM && preferencias.getBool(NVS_CHAVE_ARMADO, false)){
+    melhor.estado = ALARME_ARMADO;
+    origemInstantaneo = INST_LEGADO;
+  }
+  preferencias.end();
+
+  // No formato antigo, `instantaneoSalvo` fica vazio e o trabalho "estado" grava o novo.
+  if(origemInstantaneo != INST_LEGADO){
+    instantaneoSalvo = melhor;
+  }
+  zonasIgnoradas = melhor.zonasIgnoradas & (uint16_t)((1u << TOTAL_ZONAS) - 1);
+  if(melhor.estado != ALARME_DESARMADO){
+    estadoAlarme = (EstadoAlarme)melhor.estado;
+    zonasArmadas = (uint16_t)((1u << TOTAL_ZONAS) - 1) & ~zonasIgnoradas;
+  }
+  if(melhor.estado == ALARME_DISPARADO){
+    causaDisparo = (CausaDisparo)melhor.causa;
+    zonaDisparo = melhor.zonaDisparo < TOTAL_ZONAS ? melhor.zonaDisparo : 0;
+    zonasDisparadas = melhor.zonasDisparadas;
+    PinoRele::escrever(true); // A trava do sono leve vem depois, em `setup()`.
+  }
+  ultimaMensagemRestaurada = melhor.ultimaMensagemTelegram;
+  saidaConfirmadaRestaurada = melhor.saidaConfirmada;
+}
+
+/**
+ * @brief Trabalho "estado": compara o estado atual com o último instantâneo gravado.
+ * Qualquer mudança vai na hora para a RTC; para a NVS, na hora se for do alarme e, se só
+ * os cursores mudaram, no máximo a cada `INSTANTANEO_INTERVALO_NVS_US`.
+ */
+void verificarInstantaneo(){
+  InstantaneoEstado atual = montarInstantaneo();
+  const InstantaneoEstado& salvo = instantaneoSalvo;
+  bool alarmeMudou = atual.estado != salvo.estado || atual.zonasIgnoradas != salvo.zonasIgnoradas ||
+                     atual.causa != salvo.causa || atual.zonaDisparo != salvo.zonaDisparo ||
+                     atual.zonasDisparadas != salvo.zonasDisparadas || salvo.versao != INSTANTANEO_VERSAO;
+  bool cursoresMudaram = atual.ultimaMensagemTelegram != salvo.ultimaMensagemTelegram ||
+                         atual.saidaConfirmada != salvo.saidaConfirmada;
+  if(alarmeMudou || cursoresMudaram){
+    atual.geracao = salvo.geracao + 1;
+    atual.soma = somaInstantaneo(atual);
+    instantaneoRtc = atual;
+    instantaneoSalvo = atual;
+    gravacoesRtc++;
+    nvsDesatualizada = true;
+  }
+  uint32_t agora = micros();
+  if(nvsDesatualizada && (alarmeMudou || agora - ultimaGravacaoNvsUs >= INSTANTANEO_INTERVALO_NVS_US)){
+    portENTER_CRITICAL(&muxInstantaneo);
+    instantaneoNvs = instantaneoSalvo; // Uma cópia ainda não gravada é substituída pela mais nova.
+    instantaneoNvsPendente = true;
+    portEXIT_CRITICAL(&muxInstantaneo);
+    nvsDesatualizada = false;
+    ultimaGravacaoNvsUs = agora;
+    if(tarefaLogHandle != nullptr){
+      xTaskNotifyGive(tarefaLogHandle); // Antes da tarefa existir, `tarefaLog()` grava ao começar.
+    }
+  }
+}
+
+/**
+ * @brief Grava na NVS a cópia deixada por `verificarInstantaneo()`, alternando as chaves.
+ * Chamada pela tarefa de log; sem cópia pendente, não faz nada.
+ */
+void gravarInstantaneoNvs(){
+  portENTER_CRITICAL(&muxInstantaneo);
+  bool pendente = instantaneoNvsPendente;
+  InstantaneoEstado e = instantaneoNvs;
+  instantaneoNvsPendente = false;
+  portEXIT_CRITICAL(&muxInstantaneo);
+  if(!pendente){
+    return;
+  }
+  Preferences nvs; // Própria da tarefa: `preferencias` também é usada pela tarefa de trabalho.
+  nvs.begin(NVS_NAMESPACE, false);
+  nvs.putBytes(NVS_CHAVES_INSTANTANEO[chaveNvsInstantaneo], &e, sizeof(e));
+  nvs.end();
+  chaveNvsInstantaneo ^= 1;
+  gravacoesNvs++;
+}
+
+/**
+ * @brief Grava o instantâneo na hora (armar, desarmar). Sem mudança, não grava nada.
+ */
+void salvarEstado(){
+  verificarInstantaneo();
+}
+
+
+// =================================================================================
+// --- FUNÇÕES DE PROCESSAMENTO (HANDLERS) ---
+// =================================================================================
+
+#if SENTINELA_COM_TELEGRAM
+/**
+ * @brief Mensagem recebida do Telegram (tarefa de polling). Só o chat do `CHAT_ID`
+ * comanda o sistema: mensagens de outros chats são descartadas e geram um aviso.
+ * @param msg O objeto da mensagem do Telegram.
+ */
+void handleNewMessage(const TelegramMessage& msg){
+  if(strcmp(msg.chat_id.c_str(), CHAT_ID) != 0){
+    Serial.printf("Mensagem ignorada de um chat não autorizado: %s\n", msg.chat_id.c_str());
+    char aviso[96];
+    snprintf(aviso, sizeof(aviso), "⚠️ Comando recusado: o chat %s não está autorizado.", msg.chat_id.c_str());
+    notificar(aviso, false, PRIO_INFO);
+    return;
+  }
+  interpretarComando(msg.text.c_str(), ORIGEM_TELEGRAM);
+}
+
+/**
+ * @brief Interpreta os argumentos do `/ignorar` (o número da zona).
+ * @param args O texto após "/ignorar".
+ * @param cmd Recebe a zona.
+ * @return `false` se a zona não existir.
+ */
+bool interpretarIgnorar(const char* args, Comando& cmd){
+  unsigned long n = strtoul(args, nullptr, 10);
+  if(n == 0 || n > TOTAL_ZONAS){
+    return false;
+  }
+  cmd.zonaRF = (uint8_t)n;
+  return true;
+}
+
+/**
+ * @brief Interpreta os argumentos do `/logs` para a tabela de comandos.
+ * @param args O texto após "/logs".
+ * @param cmd Recebe o filtro.
+ * @return `false` se algum argumento for inválido.
+ */
+bool interpretarLogs(const char* args, Comando& cmd){
+  return interpretarFiltroLogs(args, cmd.filtro);
+}
+
+#if SENTINELA_COM_OTA
+/**
+ * @brief Interpreta os argumentos do `/atualizar`: o endereço da imagem e o SHA-256 dela.
+ * @param args O texto após "/atualizar".
+ * @param cmd Recebe o endereço e o hash (32 bytes).
+ * @return `false` se faltar algum dos dois ou se estiverem malformados.
+ */
+bool interpretarAtualizar(const char* args, Comando& cmd){
+  args += strspn(args, " ");
+  size_t tamUrl = strcspn(args, " ");
+  if(tamUrl == 0 || tamUrl >= sizeof(cmd.url) ||
+     (strncmp(args, "http://", 7) != 0 && strncmp(args, "https://", 8) != 0)){
+    return false;
+  }
+  memcpy(cmd.url, args, tamUrl);
+  cmd.url[tamUrl] = '\0';
+  const char* hash = args + tamUrl + strspn(args + tamUrl, " ");
+  if(strspn(hash, "0123456789abcdefABCDEF") != 64 || hash[64 + strspn(hash + 64, " ")] != '\0'){
+    return false;
+  }
+  for(uint8_t i = 0; i < 32; i++){
+    char par[3] = {hash[2 * i], hash[2 * i + 1], '\0'};
+    cmd.sha256[i] = (uint8_t)strtoul(par, nullptr, 16);
+  }
+  return true;
+}
+#endif
+
+// Tabela dos comandos remotos. Fica aqui, e não com as demais globais, porque aponta
+// para os interpretadores de argumentos acima. Para mudar por onde um comando é aceito,
+// altere a coluna de origens: desarmar, ignorar zonas e cadastrar controles exigem o
+// Telegram, pois quem alcança o broker da rede local não é, necessariamente, o dono.
+constexpr DefinicaoComando COMANDOS_REMOTOS[] = {
+  {"armar",    CMD_ARMAR,    nullptr, nullptr, VIA_TELEGRAM | VIA_MQTT, false},
+  {"desarmar", CMD_DESARMAR, nullptr, nullptr, VIA_TELEGRAM,            false},
+  {"status",   CMD_STATUS,   nullptr, nullptr, VIA_TELEGRAM | VIA_MQTT, false},
+  {"logs",     CMD_LOGS,     interpretarLogs,
+   "Uso: /logs [desde <AAAA-MM-DD [HH:MM]|HH:MM|2h|30m|1d>] [ultimos <n>] [tipo <sistema|alarme|wifi|rf>] [novos]",
+   VIA_TELEGRAM | VIA_MQTT, false},
+  {"metricas", CMD_METRICAS, nullptr, nullptr, VIA_TELEGRAM | VIA_MQTT, false},
+  {"metrics",  CMD_METRICAS, nullptr, nullptr, VIA_TELEGRAM | VIA_MQTT, true},
+#if SENTINELA_COM_RF
+  {"aprender", CMD_APRENDER, interpretarAprender,
+   "Uso: /aprender <armar|desarmar|panico|zona <n>>", VIA_TELEGRAM, false},
+#endif
+  {"ignorar",  CMD_IGNORAR,  interpretarIgnorar,
+   "Uso: /ignorar <n> (zona de 1 até o total configurado; repita para reincluir)", VIA_TELEGRAM, false},
+  {"cancelar", CMD_CANCELAR, nullptr, nullptr, VIA_TELEGRAM | VIA_MQTT, false},
+#if SENTINELA_COM_OTA
+  {"atualizar", CMD_ATUALIZAR, interpretarAtualizar,
+   "Uso: /atualizar <url http(s) do .bin> <sha256 em hexadecimal>",
+   (uint8_t)(VIA_TELEGRAM | (OTA_VIA_MQTT ? VIA_MQTT : 0)), false},
+#endif
+};
+
+constexpr size_t TOTAL_COMANDOS_REMOTOS = sizeof(COMANDOS_REMOTOS) / sizeof(COMANDOS_REMOTOS[0]);
+static_assert(TOTAL_COMANDOS_REMOTOS < POSICOES_INDICE_COMANDOS, "Aumente POSICOES_INDICE_COMANDOS.");
+
+/** @brief FNV-1a de um nome de comando, com semente (usado também pelo compilador). */
+static constexpr uint32_t hashComando(const char* nome, size_t tam, uint32_t semente){
+  uint32_t h = 2166136261u ^ semente;
+  for(size_t i = 0; i < tam; i++){
+    h = (h ^ (uint8_t)nome[i]) * 16777619u;
+  }
+  return h;
+}
+
+/** @brief Tamanho de uma string em tempo de compilação. */
+static constexpr size_t tamanhoConstante(const char* texto){
+  size_t n = 0;
+  while(texto[n] != '\0'){
+    n++;
+  }
+  return n;
+}
+
+/**
+ * @brief Procura, em tempo de compilação, a primeira semente em que cada nome da tabela
+ * cai numa posição diferente do índice.
+ * @return O índice pronto, ou `semente == UINT32_MAX` se nenhuma semente servir.
+ */
+static constexpr IndiceComandos montarIndiceComandos(){
+  IndiceComandos indice = {};
+  for(uint32_t semente = 0; semente < 4096; semente++){
+    indice.semente = semente;
+    for(size_t p = 0; p < POSICOES_INDICE_COMANDOS; p++){
+      indice.posicao[p] = -1;
+    }
+    bool colidiu = false;
+    for(size_t i = 0; i < TOTAL_COMANDOS_REMOTOS && !colidiu; i++){
+      const char* nome = COMANDOS_REMOTOS[i].nome;
+      size_t p = hashComando(nome, tamanhoConstante(nome), semente) & (POSICOES_INDICE_COMANDOS - 1);
+      colidiu = indice.posicao[p] >= 0;
+      indice.posicao[p] = (int8_t)i;
+    }
+    if(!colidiu){
+      return indice;
+    }
+  }
+  indice.semente = UINT32_MAX;
+  return indice;
+}
+
+constexpr IndiceComandos INDICE_COMANDOS = montarIndiceComandos();
+static_assert(INDICE_COMANDOS.semente != UINT32_MAX, "Nomes de comando colidem no índice: aumente POSICOES_INDICE_COMANDOS.");
+
+/**
+ * @brief Acha um comando pelo nome: uma consulta ao índice e uma comparação.
+ * @param nome Início do nome (sem a barra), dentro do próprio texto recebido.
+ * @param tam Quantos caracteres formam o nome.
+ * @return A entrada da tabela, ou nullptr se o comando não existir.
+ */
+const DefinicaoComando* buscarComando(const char* nome, size_t tam){
+  uint32_t h = hashComando(nome, tam, INDICE_COMANDOS.semente);
+  int8_t i = INDICE_COMANDOS.posicao[h & (POSICOES_INDICE_COMANDOS - 1)];
+  if(i < 0){
+    return nullptr;
+  }
+  const DefinicaoComando& def = COMANDOS_REMOTOS[i];
+  return (strncmp(def.nome, nome, tam) == 0 && def.nome[tam] == '\0') ? &def : nullptr;
+}
+
+/**
+ * @brief Responde a um comando desconhecido com a lista tirada da própria tabela
+ * ("Use /armar, /desarmar, ... ou /cancelar.").
+ */
+void responderComandoDesconhecido(){
+  char ajuda[192];
+  int pos = snprintf(ajuda, sizeof(ajuda), "Comando não reconhecido. Use");
+  size_t listados = 0;
+  size_t totalListados = 0;
+  for(size_t i = 0; i < TOTAL_COMANDOS_REMOTOS; i++){
+    totalListados += COMANDOS_REMOTOS[i].apelido ? 0 : 1;
+  }
+  for(size_t i = 0; i < TOTAL_COMANDOS_REMOTOS && pos < (int)sizeof(ajuda); i++){
+    if(COMANDOS_REMOTOS[i].apelido){
+      continue;
+    }
+    listados++;
+    const char* separador = listados == 1 ? " " : (listados == totalListados ? " ou " : ", ");
+    pos += snprintf(ajuda + pos, sizeof(ajuda) - pos, "%s/%s", separador, COMANDOS_REMOTOS[i].nome);
+  }
+  if(pos < (int)sizeof(ajuda)){
+    snprintf(ajuda + pos, sizeof(ajuda) - pos, ".");
+  }
+  notificar(ajuda, false, PRIO_NORMAL);
+}
+
+/**
+ * @brief Interpreta um comando de qualquer transporte. Executada na tarefa que o
+ * recebeu (polling do Telegram ou cliente MQTT): os comandos reconhecidos são
+ * repassados ao núcleo 1 pela `filaComandos`, e as respostas de erro saem pela fila
+ * de notificações (só a tarefa de rede envia).
+ *
+ * O texto não é copiado: o nome vai da barra até o primeiro espaço (ou até o "@bot"
+ * que o Telegram acrescenta nos grupos) e os argumentos são o restante da mesma string.
+ * @param text O texto do comando ("/armar", "/logs ultimos 20"...).
+ * @param origem ORIGEM_TELEGRAM ou ORIGEM_MQTT.
+ */
+void interpretarComando(const char* text, OrigemEvento origem){
+  Serial.printf("Comando recebido (%s): %s\n", NOMES_ORIGEM[origem], text);
+
+  if(text[0] != '/'){
+    responderComandoDesconhecido();
+    return;
+  }
+  const char* nome = text + 1;
+  size_t tam = strcspn(nome, " @");
+  const char* args = nome + tam;
+  if(*args == '@'){
+    args += strcspn(args, " ");
+  }
+  const DefinicaoComando* def = buscarComando(nome, tam);
+  if(def == nullptr || (def->interpretar == nullptr && args[strspn(args, " ")] != '\0')){
+    responderComandoDesconhecido();
+    return;
+  }
+  if((def->origens & (1 << origem)) == 0){
+    char msg[96];
+    snprintf(msg, sizeof(msg), "⛔ O comando /%s não é aceito pelo canal %s.", def->nome, NOMES_ORIGEM[origem]);
+    notificar(msg, false, PRIO_NORMAL);
+    return;
+  }
+
+  Comando cmd;
+  cmd.tipo = def->tipo;
+  cmd.origem = origem;
+  if(def->interpretar != nullptr && !def->interpretar(args, cmd)){
+    notificar(def->uso, false, PRIO_NORMAL);
+    return;
+  }
+
+  if(xQueueSend(filaComandos, &cmd, 0) != pdTRUE){
+    Serial.println("Fila de comandos cheia: comando descartado.");
+  }
+}
+
+/**
+ * @brief Executa um comando remoto (Telegram ou MQTT) no núcleo 1 (lógica do alarme).
+ * @param cmd O comando interpretado pela tarefa de rede.
+ */
+void executarComando(const Comando& cmd){
+  switch(cmd.tipo){
+    case CMD_ARMAR:
+      armarSistema(cmd.origem);
+      break;
+    case CMD_DESARMAR:
+      desarmarSistema(cmd.origem);
+      break;
+    case CMD_STATUS: {
+      char abertas[48], ignoradas[48], disparadas[48];
+      formatarZonas(zonasAbertas, abertas, sizeof(abertas));
+      formatarZonas(zonasIgnoradas, ignoradas, sizeof(ignoradas));
+      formatarZonas(zonasDisparadas, disparadas, sizeof(disparadas));
+      static char resp[STATUS_TEXTO_MAX]; // Estático: só o loop executa comandos.
+      int pos = snprintf(resp, sizeof(resp),
+               "📊 *Status do Sentinela*\n\n*Sistema:* %s\n*Sirene Disparada:* %s"
+               "\n*Zonas:* %u (abertas: %s; ignoradas: %s; disparadas: %s)"
+               "\n*Latência PIR→Sirene:* %lu us (histórico em /metricas)",
+               NOMES_ESTADO_ALARME[estadoAlarme], estadoAlarme == ALARME_DISPARADO ? "SIM" : "NÃO",
+               (unsigned)TOTAL_ZONAS, abertas, ignoradas, disparadas,
+               (unsigned long)latenciaDisparoUs);
+#if SENTINELA_COM_RF
+      if(pos > 0 && (size_t)pos < sizeof(resp)){
+        pos += snprintf(resp + pos, sizeof(resp) - pos, "\n*Controles RF:* %u cadastrados", (unsigned)totalControlesRF);
+      }
+#endif
+      EtapaOperacao etapa = etapaOperacao;
+      if(etapa != ETAPA_OCIOSA && pos > 0 && (size_t)pos < sizeof(resp)){
+        if(etapa == ETAPA_VARRENDO){
+          snprintf(resp + pos, sizeof(resp) - pos, "\n*Log:* gerando relatório (/cancelar)");
+        } else if(etapa == ETAPA_ATUALIZANDO){
+          snprintf(resp + pos, sizeof(resp) - pos, "\n*Firmware:* gravando %lu/%lu KB (/cancelar)",
+                   (unsigned long)(progressoFeito / 1024), (unsigned long)((progressoTotal + 1023) / 1024));
+        } else {
+          snprintf(resp + pos, sizeof(resp) - pos, "\n*Log:* %s %lu/%lu KB (/cancelar)",
+                   etapa == ETAPA_PAUSADA ? "pausado por alerta," : "enviando",
+                   (unsigned long)(progressoFeito / 1024), (unsigned long)((progressoTotal + 1023) / 1024));
+        }
+      }
+      // Com todas as zonas listadas o texto passa de uma notificação: vai em partes.
+      notificarEmPartes(resp, true, PRIO_NORMAL);
+      break;
+    }
+    case CMD_LOGS:
+      solicitarEnvioLogs(cmd.filtro);
+      break;
+    case CMD_METRICAS:
+      solicitarMetricas();
+      break;
+#if SENTINELA_COM_RF
+    case CMD_APRENDER:
+      iniciarAprendizadoRF(cmd.funcaoRF, cmd.zonaRF);
+      break;
+#endif
+    case CMD_IGNORAR:
+      alternarBypassZona(cmd.zonaRF - 1, cmd.origem);
+      break;
+    case CMD_CANCELAR:
+      if(etapaOperacao == ETAPA_OCIOSA){
+        notificar("Nenhuma operação em andamento.", false, PRIO_NORMAL);
+      } else {
+        cancelarOperacao = true; // A tarefa de trabalho confirma quando parar.
+      }
+      break;
+#if SENTINELA_COM_OTA
+    case CMD_ATUALIZAR:
+      solicitarAtualizacaoFirmware(cmd);
+      break;
+#endif
+    default:
+      break;
+  }
+}
+#endif
+
+#if SENTINELA_COM_RF
+
+/**
+ * @brief Processa os códigos recebidos via RF. Durante o `/aprender`, o próximo
+ * código recebido é cadastrado; fora dele, a função cadastrada é executada.
+ * @param code O código numérico recebido.
+ * @param instanteUs Recepção do quadro (`micros()`).
+ */
+void handleRF(unsigned long code, uint32_t instanteUs){
+  if(aprendendoRF){
+    aprenderControleRF(code);
+    return;
+  }
+  const ControleRF* controle = buscarControleRF(code);
+  if(controle == nullptr){
+    contarRFDesconhecido(code);
+    return;
+  }
+  switch(controle->funcao){
+    case RF_ARMAR:
+      armarSistema(ORIGEM_RF);
+      break;
+    case RF_DESARMAR:
+      desarmarSistema(ORIGEM_RF);
+      break;
+    case RF_PANICO:
+      processarEventoAlarme(EA_PANICO, instanteUs, 0);
+      break;
+    case RF_ZONA:
+      if(controle->zona >= 1 && controle->zona <= TOTAL_ZONAS){
+        acionarZonaRF(controle->zona - 1, instanteUs);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief Interpreta os argumentos do `/aprender` ("armar", "panico", "zona 3"...).
+ * @param args O texto após "/aprender".
+ * @param cmd Recebe a função e a zona.
+ * @return `false` se os argumentos forem inválidos.
+ */
+bool interpretarAprender(const char* args, Comando& cmd){
+  char buf[32];
+  strlcpy(buf, args, sizeof(buf));
+  char* contexto = nullptr;
+  char* nome = strtok_r(buf, " ", &contexto);
+  cmd.funcaoRF = RF_VAZIO;
+  cmd.zonaRF = 0;
+  for(uint8_t f = RF_ARMAR; nome != nullptr && f < TOTAL_FUNCOES_RF; f++){
+    if(strcmp(nome, NOMES_FUNCAO_RF[f]) == 0){
+      cmd.funcaoRF = (FuncaoControle)f;
+    }
+  }
+  if(cmd.funcaoRF == RF_ZONA){
+    char* zona = strtok_r(nullptr, " ", &contexto);
+    unsigned long n = zona ? strtoul(zona, nullptr, 10) : 0;
+    if(n == 0 || n > TOTAL_ZONAS){
+      return false;
+    }
+    cmd.zonaRF = (uint8_t)n;
+  }
+  return cmd.funcaoRF != RF_VAZIO && strtok_r(nullptr, " ", &contexto) == nullptr;
+}
+
+/**
+ * @brief Fora do tratamento de um código: encerra a janela do `/aprender` e fecha o
+ * período de agregação dos códigos desconhecidos. Chamada a cada volta do loop.
+ */
+void verificarPendenciasRF(){
+  uint32_t agora = micros();
+  if(aprendendoRF && agora - inicioAprendizadoRF > RF_TEMPO_APRENDIZADO_US){
+    aprendendoRF = false;
+    notificar("⌛ Tempo esgotado: nenhum controle RF foi cadastrado.", false, PRIO_NORMAL);
+  }
+  if(rfDesconhecidosPeriodo > 0 && agora - inicioPeriodoRF > RF_PERIODO_DESCONHECIDOS_US){
+    logEvento(EVT_RF_DESCONHECIDOS, ORIGEM_RF, rfDesconhecidosPeriodo);
+    rfDesconhecidosPeriodo = 0;
+  }
+}
+
+
+// =================================================================================
+// --- TABELA DE CONTROLES RF ---
+// =================================================================================
+
+/**
+ * @brief Posição inicial de um código na tabela (hash multiplicativo de Fibonacci).
+ */
+static inline size_t hashCodigoRF(uint32_t codigo){
+  return (uint32_t)(codigo * 2654435761u) >> (32 - RF_BITS_TABELA);
+}
+
+/**
+ * @brief Procura um código na tabela.
+ * @return O controle cadastrado, ou `nullptr` se o código for desconhecido.
+ */
+const ControleRF* buscarControleRF(uint32_t codigo){
+  size_t i = hashCodigoRF(codigo);
+  for(size_t n = 0; n < RF_TABELA_CAPACIDADE; n++){
+    const ControleRF& c = tabelaRF[i];
+    if(c.funcao == RF_VAZIO){
+      return nullptr; // Posição livre: o código não está na tabela.
+    }
+    if(c.codigo == codigo){
+      return &c;
+    }
+    i = (i + 1) & (RF_TABELA_CAPACIDADE - 1);
+  }
+  return nullptr;
+}
+
+/**
+ * @brief Cadastra um código, ou atualiza a função de um código já cadastrado.
+ * @return `false` se a tabela estiver cheia.
+ */
+bool inserirControleRF(uint32_t codigo, FuncaoControle funcao, uint8_t zona){
+  size_t i = hashCodigoRF(codigo);
+  while(tabelaRF[i].funcao != RF_VAZIO && tabelaRF[i].codigo != codigo){
+    i = (i + 1) & (RF_TABELA_CAPACIDADE - 1);
+  }
+  if(tabelaRF[i].funcao == RF_VAZIO){
+    if(totalControlesRF >= RF_MAX_CONTROLES){
+      return false;
+    }
+    totalControlesRF++;
+  }
+  tabelaRF[i].codigo = codigo;
+  tabelaRF[i].funcao = funcao;
+  tabelaRF[i].zona = zona;
+  tabelaRF[i].reservado = 0;
+  return true;
+}
+
+/**
+ * @brief Monta a tabela: os códigos de fábrica (`CODE_ARM`/`CODE_DISARM`) e, por cima
+ * deles, os controles cadastrados no LittleFS.
+ */
+void carregarControlesRF(){
+  memset(tabelaRF, 0, sizeof(tabelaRF));
+  totalControlesRF = 0;
+  inserirControleRF(CODE_ARM, RF_ARMAR, 0);
+  inserirControleRF(CODE_DISARM, RF_DESARMAR, 0);
+
+  File f = LittleFS.open(RF_ARQUIVO, "r");
+  if(!f){
+    return;
+  }
+  CabecalhoControles cab;
+  if(f.read((uint8_t*)&cab, sizeof(cab)) == sizeof(cab) && cab.magia == RF_MAGIA){
+    ControleRF c;
+    for(uint16_t n = 0; n < cab.total && f.read((uint8_t*)&c, sizeof(c)) == sizeof(c); n++){
+      if(c.funcao != RF_VAZIO && c.funcao < TOTAL_FUNCOES_RF){
+        inserirControleRF(c.codigo, c.funcao, c.zona);
+      }
+    }
+  }
+  f.close();
+  Serial.printf("%u controles RF carregados.\n", (unsigned)totalControlesRF);
+}
+
+/**
+ * @brief Regrava a tabela no LittleFS. Chamada só quando um controle é cadastrado.
+ */
+void salvarControlesRF(){
+  File f = LittleFS.open(RF_ARQUIVO, "w");
+  if(!f){
+    Serial.println("Erro ao gravar os controles RF.");
+    return;
+  }
+  CabecalhoControles cab = { RF_MAGIA, (uint16_t)totalControlesRF, 0 };
+  f.write((const uint8_t*)&cab, sizeof(cab));
+  for(size_t i = 0; i < RF_TABELA_CAPACIDADE; i++){
+    if(tabelaRF[i].funcao != RF_VAZIO){
+      f.write((const uint8_t*)&tabelaRF[i], sizeof(ControleRF));
+    }
+  }
+  f.close();
+}
+
+/**
+ * @brief Abre a janela do `/aprender`: o próximo código recebido ganha a função pedida.
+ */
+void iniciarAprendizadoRF(FuncaoControle funcao, uint8_t zona){
+  aprendendoRF = true;
+  inicioAprendizadoRF = micros();
+  funcaoAprendizado = funcao;
+  zonaAprendizado = zona;
+  notificar("📡 Modo de aprendizado: pressione o botão do controle RF em até 30 s.", false, PRIO_NORMAL);
+}
+
+/**
+ * @brief Cadastra o código recebido durante a janela do `/aprender`.
+ */
+void aprenderControleRF(uint32_t codigo){
+  aprendendoRF = false;
+  char msg[NOTIF_TEXTO_MAX];
+  if(!inserirControleRF(codigo, funcaoAprendizado, zonaAprendizado)){
+    snprintf(msg, sizeof(msg), "❌ Tabela de controles cheia (%u): código %lu não cadastrado.",
+             (unsigned)RF_MAX_CONTROLES, (unsigned long)codigo);
+    notificar(msg, false, PRIO_NORMAL);
+    return;
+  }
+  salvarControlesRF();
+  if(funcaoAprendizado == RF_ZONA){
+    snprintf(msg, sizeof(msg), "✅ Controle RF cadastrado: código %lu como sensor da zona %u.",
+             (unsigned long)codigo, (unsigned)zonaAprendizado);
+  } else {
+    snprintf(msg, sizeof(msg), "✅ Controle RF cadastrado: código %lu com a função %s.",
+             (unsigned long)codigo, NOMES_FUNCAO_RF[funcaoAprendizado]);
+  }
+  notificar(msg, false, PRIO_NORMAL);
+  logEvento(EVT_CONTROLE_APRENDIDO, ORIGEM_RF, codigo);
+}
+
+/**
+ * @brief Conta um código desconhecido. Nada vai para o log aqui: o total do período
+ * é registrado uma vez por `verificarPendenciasRF()`.
+ */
+void contarRFDesconhecido(uint32_t codigo){
+  if(rfDesconhecidosPeriodo == 0){
+    inicioPeriodoRF = micros();
+  }
+  rfDesconhecidosPeriodo++;
+  rfDesconhecidosTotal++;
+  ultimoRFDesconhecido = codigo;
+}
+#endif
+
+
+// =================================================================================
+// --- MÉTRICAS ---
+// =================================================================================
+
+/**
+ * @brief Acrescenta uma medição de tempo ao histograma da métrica.
+ * Segura para qualquer tarefa; fica só alguns ciclos na seção crítica.
+ */
+void registrarMetrica(MetricaTempo metrica, uint32_t us){
+  uint8_t faixa = 0;
+  while(faixa < FAIXAS_HISTOGRAMA - 1 && us > LIMITES_HISTOGRAMA_US[faixa]){
+    faixa++;
+  }
+  Histograma& h = metricas[metrica];
+  portENTER_CRITICAL(&muxMetricas);
+  h.amostras++;
+  h.somaUs += us;
+  if(us > h.maxUs){
+    h.maxUs = us;
+  }
+  h.faixas[faixa]++;
+  portEXIT_CRITICAL(&muxMetricas);
+}
+
+/**
+ * @brief Escreve todas as métricas, uma por linha, no formato `nome chave=valor ...`.
+ * Os histogramas saem em `h=` com a contagem de cada faixa separada por '/', na
+ * ordem de `LIMITES_HISTOGRAMA_US`. Pilhas são a marca d'água (bytes nunca usados).
+ * @param destino Buffer de saída.
+ * @param tam Capacidade do buffer.
+ * @param prefixo Texto no início de cada linha (ex.: "METRICA " na serial).
+ * @return Bytes escritos (sem o terminador).
+ */
+size_t formatarMetricas(char* destino, size_t tam, const char* prefixo){
+  size_t pos = 0;
+  for(uint8_t m = 0; m < TOTAL_METRICAS && pos < tam; m++){
+    portENTER_CRITICAL(&muxMetricas);
+    Histograma h = metricas[m]; // Cópia: o snprintf fica fora da seção crítica.
+    portEXIT_CRITICAL(&muxMetricas);
+    pos += snprintf(destino + pos, tam - pos, "%s%s n=%lu media=%lu max=%lu h=", prefixo,
+                    NOMES_METRICA[m], (unsigned long)h.amostras,
+                    (unsigned long)(h.amostras ? h.somaUs / h.amostras : 0), (unsigned long)h.maxUs);
+    for(uint8_t f = 0; f < FAIXAS_HISTOGRAMA && pos < tam; f++){
+      pos += snprintf(destino + pos, tam - pos, f ? "/%lu" : "%lu", (unsigned long)h.faixas[f]);
+    }
+    if(pos < tam){
+      pos += snprintf(destino + pos, tam - pos, "\n");
+    }
+  }
+  if(pos < tam){
+    pos += snprintf(destino + pos, tam - pos, "%sheap livre=%lu maior_bloco=%lu minimo=%lu\n", prefixo,
+                    (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMaxAllocHeap(),
+                    (unsigned long)ESP.getMinFreeHeap());
+  }
+  if(pos < tam){
+#if SENTINELA_COM_TELEGRAM
+    TaskHandle_t polling = tarefaPollingHandle, trabalho = tarefaTrabalhoHandle;
+#else
+    TaskHandle_t polling = nullptr, trabalho = nullptr; // Tarefas não compiladas: saem como 0.
+#endif
+    pos += snprintf(destino + pos, tam - pos, "%spilha loop=%lu rede=%lu polling=%lu log=%lu trabalho=%lu\n",
+                    prefixo, (unsigned long)marcaPilha(tarefaLoopHandle), (unsigned long)marcaPilha(tarefaRedeHandle),
+                    (unsigned long)marcaPilha(polling), (unsigned long)marcaPilha(tarefaLogHandle),
+                    (unsigned long)marcaPilha(trabalho));
+  }
+  if(pos < tam){
+    bool conectado = WiFi.status() == WL_CONNECTED;
+    pos += snprintf(destino + pos, tam - pos, "%swifi conectado=%d rssi=%d quedas=%lu reconexoes=%lu falhas_seguidas=%u\n",
+                    prefixo, conectado ? 1 : 0, conectado ? (int)WiFi.RSSI() : 0,
+                    (unsigned long)quedasWiFi, (unsigned long)reconexoesWiFi, (unsigned)falhasSeguidasWiFi);
+  }
+#if SENTINELA_COM_TELEGRAM
+  if(pos < tam){
+    portENTER_CRITICAL(&muxTls);
+    uint32_t handshakes = tlsHandshakes, falhas = tlsFalhas, ultimo = tlsUltimoHandshakeMs;
+    uint32_t maior = tlsMaiorHandshakeMs, total = tlsTotalHandshakeMs;
+    portEXIT_CRITICAL(&muxTls);
+    pos += snprintf(destino + pos, tam - pos, "%stls handshakes=%lu falhas=%lu ultimo_ms=%lu media_ms=%lu max_ms=%lu\n",
+                    prefixo, (unsigned long)handshakes, (unsigned long)falhas, (unsigned long)ultimo,
+                    (unsigned long)(handshakes ? total / handshakes : 0), (unsigned long)maior);
+  }
+  for(uint8_t i = 0; i < totalTransportes && pos < tam; i++){
+    const Transporte& t = transportes[i];
+    pos += snprintf(destino + pos, tam - pos, "%stransporte_%s envios=%lu falhas=%lu\n", prefixo,
+                    t.nome, (unsigned long)t.envios, (unsigned long)t.falhas);
+  }
+#if SENTINELA_COM_MQTT
+  if(pos < tam){
+    pos += snprintf(destino + pos, tam - pos, "%smqtt conectado=%d sessoes=%lu pubacks_perdidos=%lu comandos=%d\n", prefixo,
+                    mqttConectado ? 1 : 0, (unsigned long)mqttConexoes, (unsigned long)pubacksPerdidos,
+                    MQTT_ACEITA_COMANDOS ? 1 : 0);
+  }
+#endif
+#endif
+  if(pos < tam){
+    pos += snprintf(destino + pos, tam - pos, "%sestado origem=%s gravacoes_rtc=%lu gravacoes_nvs=%lu\n", prefixo,
+                    NOMES_ORIGEM_INSTANTANEO[origemInstantaneo], (unsigned long)gravacoesRtc,
+                    (unsigned long)gravacoesNvs);
+  }
+#if SENTINELA_TELEMETRIA
+  if(pos < tam){
+    pos += snprintf(destino + pos, tam - pos, "%stelemetria quadros=%lu falhas=%lu\n", prefixo,
+                    (unsigned long)quadrosTelemetria, (unsigned long)falhasTelemetria);
+  }
+#endif
+#if SENTINELA_COM_RF
+  if(pos < tam){
+    pos += snprintf(destino + pos, tam - pos,
+                    "%srf controles=%u desconhecidos=%lu ultimo_desconhecido=%lu repeticoes=%lu\n",
+                    prefixo, (unsigned)totalControlesRF, (unsigned long)rfDesconhecidosTotal,
+                    (unsigned long)ultimoRFDesconhecido, (unsigned long)rfRepeticoesSuprimidas);
+  }
+#endif
+  if(pos < tam){
+    portENTER_CRITICAL(&muxMetricas);
+    uint64_t dormindoUs = loopDormindoUs;
+    uint32_t porBorda = despertaresBorda, porPrazo = despertaresPrazo;
+    uint32_t pirSireneMaxUs = metricas[MET_PIR_SIRENE].maxUs;
+    portEXIT_CRITICAL(&muxMetricas);
+    uint64_t totalUs = esp_timer_get_time();
+    uint32_t ativoPorMil = totalUs > dormindoUs ? (uint32_t)((totalUs - dormindoUs) * 1000 / totalUs) : 0;
+    pos += snprintf(destino + pos, tam - pos,
+                    "%senergia economia=%d sono_leve=%d ciclo_ativo_pct=%lu.%lu despertares_borda=%lu "
+                    "despertares_prazo=%lu limite_isr_rele_us=%lu isr_rele_dentro_limite=%d despertar_medido=%d\n",
+                    prefixo, ECONOMIA_ENERGIA ? 1 : 0, sonoLeveAtivo ? 1 : 0,
+                    (unsigned long)(ativoPorMil / 10), (unsigned long)(ativoPorMil % 10),
+                    (unsigned long)porBorda, (unsigned long)porPrazo, (unsigned long)ECONOMIA_LATENCIA_MAX_US,
+                    pirSireneMaxUs <= ECONOMIA_LATENCIA_MAX_US ? 1 : 0, sonoLeveAtivo ? 0 : 1);
+  }
+  if(pos < tam){
+    for(uint8_t i = 0; i < totalTrabalhos && pos < tam; i++){
+      const Trabalho& t = trabalhos[i];
+      pos += snprintf(destino + pos, tam - pos, "%strabalho_%s n=%lu max_us=%lu orcamento_us=%lu estouros=%lu\n",
+                      prefixo, t.nome, (unsigned long)t.execucoes, (unsigned long)t.maiorUs,
+                      (unsigned long)t.orcamentoUs, (unsigned long)t.estouros);
+    }
+  }
+  if(pos < tam){
+#if SENTINELA_COM_TELEGRAM
+    uint32_t alertas = alertasDescartados;
+#else
+    uint32_t alertas = 0;
+#endif
+    pos += snprintf(destino + pos, tam - pos, "%sperdas logs=%lu entradas=%lu alertas=%lu\n", prefixo,
+                    (unsigned long)logsDescartados, (unsigned long)entradasPerdidas,
+                    (unsigned long)alertas);
+  }
+  return pos < tam ? pos : tam - 1;
+}
+
+/**
+ * @brief Marca d'água da pilha de uma tarefa, ou 0 se ela ainda não existe.
+ */
+uint32_t marcaPilha(TaskHandle_t tarefa){
+  return tarefa != nullptr ? uxTaskGetStackHighWaterMark(tarefa) : 0;
+}
+
+
+// =================================================================================
+// --- FUNÇÕES DE LOG E TIMESTAMP ---
+// =================================================================================
+
+/**
+ * @brief Registra um evento no monitor serial e no buffer de logs.
+ * Não acessa o sistema de arquivos: a gravação é feita pela tarefa de gravação.
+ * @param codigo O evento ocorrido.
+ * @param origem A fonte do evento.
+ * @param valor Dado extra do evento (0 se não houver).
+ */
+void logEvento(CodigoEvento codigo, OrigemEvento origem, uint32_t valor){
+  uint32_t inicio = micros();
+  RegistroLog r = criarRegistro(codigo, origem, valor);
+  ecoarRegistroSerial(r);
+
+  size_t usados;
+  bool cabe = enfileirarLog(r, false, usados);
+  if(!cabe){
+    Serial.println("Buffer de logs cheio: registro descartado.");
+  }
+  if(usados >= LOG_LIMITE_REGISTROS && tarefaLogHandle != nullptr){
+    xTaskNotifyGive(tarefaLogHandle); // Acúmulo atingido (ou buffer cheio): antecipa a gravação.
+  }
+  registrarMetrica(MET_LOG_EVENTO, micros() - inicio);
+}
+
+/**
+ * @brief Registra um evento que não pode ser perdido (alarme, armar/desarmar).
+ * Usa a reserva do buffer e pede a gravação imediata, sem tocar na flash: pode ser
+ * chamada do caminho da sirene.
+ * @param codigo O evento ocorrido.
+ * @param origem A fonte do evento.
+ * @param valor Dado extra do evento (0 se não houver).
+ */
+void logEventoCritico(CodigoEvento codigo, OrigemEvento origem, uint32_t valor){
+  uint32_t inicio = micros();
+  RegistroLog r = criarRegistro(codigo, origem, valor);
+  ecoarRegistroSerial(r);
+
+  size_t usados;
+  if(!enfileirarLog(r, true, usados)){
+    Serial.println("Buffer de logs cheio: registro crítico descartado.");
+  }
+  if(tarefaLogHandle != nullptr){
+    xTaskNotifyGive(tarefaLogHandle);
+  }
+  registrarMetrica(MET_LOG_EVENTO, micros() - inicio);
+}
+
+/**
+ * @brief Monta um registro binário com o instante atual.
+ * @return O registro pronto para ser enfileirado.
+ */
+RegistroLog criarRegistro(CodigoEvento codigo, OrigemEvento origem, uint32_t valor){
+  RegistroLog r;
+  time_t agora = time(nullptr);
+  // Checa se o ano é válido (maior que 2020), indicando que o NTP sincronizou.
+  if(agora > 1577836800){ // 2020-01-01 00:00:00 UTC
+    r.instante = (uint32_t)agora;
+    r.flags = REG_RELOGIO_SINCRONIZADO;
+  } else {
+    r.instante = millis() / 1000;
+    r.flags = 0;
+  }
+  r.valor = valor;
+  r.codigo = codigo;
+  r.origem = origem;
+  r.crc = 0;
+  return r;
+}
+
+/**
+ * @brief Copia um registro para o buffer circular de logs. Pode ser chamada pelas duas tarefas.
+ * @param r O registro a ser gravado.
+ * @param critico `true` para poder ocupar a reserva de `LOG_RESERVA_CRITICOS`.
+ * @param usados Recebe a ocupação do buffer depois da cópia, lida sob o mesmo mux.
+ * @return `true` se o registro coube no buffer.
+ */
+bool enfileirarLog(const RegistroLog& r, bool critico, size_t& usados){
+  size_t limite = critico ? LOG_BUFFER_REGISTROS : LOG_BUFFER_REGISTROS - LOG_RESERVA_CRITICOS;
+  bool cabe;
+  portENTER_CRITICAL(&muxBufferLog);
+  cabe = usadosBufferLog < limite;
+  if(cabe){
+    bufferLog[(inicioBufferLog + usadosBufferLog) % LOG_BUFFER_REGISTROS] = r;
+    usadosBufferLog++;
+  } else {
+    logsDescartados++;
+  }
+  usados = usadosBufferLog;
+  portEXIT_CRITICAL(&muxBufferLog);
+  return cabe;
+}
+
+// =================================================================================
+// --- ARMAZENAMENTO DOS SEGMENTOS DE LOG ---
+// =================================================================================
+// As mesmas operações sobre arquivos do LittleFS ou sobre setores da partição do diário,
+// conforme `SENTINELA_DIARIO_PARTICAO`. O restante do log (buffer, índice, rotação,
+// relatórios) não sabe qual das duas está em uso.
+
+#if SENTINELA_DIARIO_PARTICAO
+
+/**
+ * @brief Localiza a partição do diário e a mapeia na memória.
+ * @return `false` se a partição não existe ou é menor que `LOG_ORCAMENTO_BYTES`.
+ */
+bool iniciarArmazenamentoLog(){
+  particaoDiario = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)0x40,
+                                            DIARIO_ROTULO);
+  if(particaoDiario == nullptr || particaoDiario->size < LOG_ORCAMENTO_BYTES){
+    Serial.println("Erro crítico: partição \"diario\" ausente ou pequena; log desativado.");
+    particaoDiario = nullptr;
+    return false;
+  }
+  const void* mapa = nullptr;
+  if(esp_partition_mmap(particaoDiario, 0, LOG_ORCAMENTO_BYTES, ESP_PARTITION_MMAP_DATA,
+                        &mapa, &handleMapaDiario) != ESP_OK){
+    Serial.println("Erro crítico: não foi possível mapear a partição do diário.");
+    particaoDiario = nullptr;
+    return false;
+  }
+  mapaDiario = (const uint8_t*)mapa;
+  return true;
+}
+
+/**
+ * @brief Endereço, no mapeamento, do primeiro registro de um setor.
+ */
+const RegistroLog* registrosDoSetor(uint8_t indice){
+  return (const RegistroLog*)(mapaDiario + indice * DIARIO_SETOR + LOG_BYTES_CABECALHO);
+}
+
+/**
+ * @brief `true` se a posição do registro ainda está apagada (todos os bytes em 0xFF).
+ */
+bool registroApagado(const RegistroLog& r){
+  const uint8_t* bytes = (const uint8_t*)&r;
+  for(size_t i = 0; i < sizeof(r); i++){
+    if(bytes[i] != 0xFF) return false;
+  }
+  return true;
+}
+
+/**
+ * @brief `true` se o CRC confere. Uma escrita interrompida por falta de energia é descartada.
+ */
+bool registroIntegro(const RegistroLog& r){
+  return r.crc == esp_rom_crc8_le(0, (const uint8_t*)&r, sizeof(r) - 1);
+}
+
+/**
+ * @brief Lê o cabeçalho de um setor e conta seus registros, buscando (em ordem, por
+ * bissecção) a primeira posição apagada.
+ * @param registros Recebe a quantidade de registros escritos no setor.
+ * @return `true` se o setor tem um cabeçalho válido.
+ */
+bool lerCabecalhoSegmento(uint8_t indice, CabecalhoSegmento& cab, size_t& registros){
+  if(mapaDiario == nullptr){
+    return false;
+  }
+  const CabecalhoSetor* setor = (const CabecalhoSetor*)(mapaDiario + indice * DIARIO_SETOR);
+  if(setor->segmento.magia != LOG_MAGIA ||
+     setor->crc != esp_rom_crc32_le(0, (const uint8_t*)&setor->segmento, sizeof(setor->segmento))){
+    return false;
+  }
+  cab = setor->segmento;
+  const RegistroLog* lista = registrosDoSetor(indice);
+  size_t inicio = 0, fim = LOG_REGISTROS_POR_SEGMENTO;
+  while(inicio < fim){
+    size_t meio = (inicio + fim) / 2;
+    if(registroApagado(lista[meio])){
+      fim = meio;
+    } else {
+      inicio = meio + 1;
+    }
+  }
+  registros = inicio;
+  return true;
+}
+
+/**
+ * @brief Lê um registro de um segmento pela posição.
+ */
+bool lerRegistroSegmento(uint8_t indice, size_t posicao, RegistroLog& r){
+  r = registrosDoSetor(indice)[posicao];
+  return registroIntegro(r);
+}
+
+/**
+ * @brief Apaga o setor e grava o cabeçalho de um novo segmento. Exige `mutexLog`.
+ */
+void iniciarSegmento(uint8_t indice, const CabecalhoSegmento& cab){
+  if(particaoDiario == nullptr){
+    return;
+  }
+  CabecalhoSetor setor;
+  setor.segmento = cab;
+  setor.crc = esp_rom_crc32_le(0, (const uint8_t*)&cab, sizeof(cab));
+  setor.reservado = 0xFFFFFFFF;
+  esp_partition_erase_range(particaoDiario, indice * DIARIO_SETOR, DIARIO_SETOR);
+  esp_partition_write(particaoDiario, indice * DIARIO_SETOR, &setor, sizeof(setor));
+}
+
+/**
+ * @brief Grava um bloco de registros no fim do segmento atual, com uma única escrita
+ * na flash. O bloco nunca cruza o fim do setor. Exige `mutexLog`.
+ */
+bool escreverRegistros(RegistroLog* bloco, size_t tam){
+  if(particaoDiario == nullptr){
+    return false;
+  }
+  for(size_t i = 0; i < tam; i++){
+    bloco[i].crc = esp_rom_crc8_le(0, (const uint8_t*)&bloco[i], sizeof(RegistroLog) - 1);
+  }
+  size_t destino = segmentoAtual * DIARIO_SETOR + LOG_BYTES_CABECALHO +
+                   registrosNoSegmento * sizeof(RegistroLog);
+  return esp_partition_write(particaoDiario, destino, bloco, tam * sizeof(RegistroLog)) == ESP_OK;
+}
+
+/**
+ * @brief No diário, cada escrita já está na flash; não há o que confirmar.
+ */
+void confirmarRegistros(){
+}
+
+/**
+ * @brief No diário, não há arquivo aberto entre as escritas.
+ */
+void fecharSegmento(){
+}
+
+/**
+ * @brief Prepara a leitura de um segmento a partir de uma posição.
+ */
+bool abrirLeitorSegmento(LeitorSegmento& leitor, uint8_t indice, size_t posicao){
+  if(mapaDiario == nullptr){
+    return false;
+  }
+  leitor.registros = registrosDoSetor(indice);
+  leitor.posicao = posicao;
+  return true;
+}
+
+/**
+ * @brief Entrega o próximo bloco de registros, apontando direto para a flash mapeada.
+ * @param bloco Recebe o endereço do primeiro registro do bloco.
+ * @return Quantos registros o bloco tem (0 no fim do setor).
+ */
+size_t lerBlocoSegmento(LeitorSegmento& leitor, const RegistroLog*& bloco){
+  size_t restantes = LOG_REGISTROS_POR_SEGMENTO - leitor.posicao;
+  size_t lidos = min(restantes, (size_t)64); // Blocos curtos: o watchdog é alimentado entre eles.
+  bloco = leitor.registros + leitor.posicao;
+  leitor.posicao += lidos;
+  return lidos;
+}
+
+void fecharLeitorSegmento(LeitorSegmento& leitor){
+}
+
+#else
+
+/**
+ * @brief Os arquivos dos segmentos são criados sob demanda; não há o que preparar.
+ */
+bool iniciarArmazenamentoLog(){
+  return true;
+}
+
+/**
+ * @brief Nos arquivos, o sistema de arquivos já garante a integridade de cada escrita.
+ */
+bool registroIntegro(const RegistroLog& r){
+  return true;
+}
+
+/**
+ * @brief Monta o nome do arquivo de um segmento de log (ex: "/log_0.bin").
+ */
+void nomeSegmento(uint8_t indice, char* destino, size_t tam){
+  snprintf(destino, tam, "/log_%u.bin", (unsigned)indice);
+}
+
+/**
+ * @brief Lê o cabeçalho de um segmento.
+ * @param registros Recebe a quantidade de registros completos do segmento.
+ * @return `true` se o segmento existe e é válido.
+ */
+bool lerCabecalhoSegmento(uint8_t indice, CabecalhoSegmento& cab, size_t& registros){
+  char nome[16];
+  nomeSegmento(indice, nome, sizeof(nome));
+  File f = LittleFS.open(nome, "r");
+  if(!f){
+    return false;
+  }
+  bool valido = f.read((uint8_t*)&cab, sizeof(cab)) == sizeof(cab) && cab.magia == LOG_MAGIA;
+  registros = valido ? (f.size() - sizeof(cab)) / sizeof(RegistroLog) : 0;
+  f.close();
+  return valido;
+}
+
+/**
+ * @brief Lê um registro de um segmento pela posição.
+ */
+bool lerRegistroSegmento(uint8_t indice, size_t posicao, RegistroLog& r){
+  char nome[16];
+  nomeSegmento(indice, nome, sizeof(nome));
+  File f = LittleFS.open(nome, "r");
+  if(!f){
+    return false;
+  }
+  f.seek(LOG_BYTES_CABECALHO + posicao * sizeof(RegistroLog));
+  bool ok = f.read((uint8_t*)&r, sizeof(r)) == sizeof(r);
+  f.close();
+  return ok;
+}
+
+/**
+ * @brief Trunca o arquivo do segmento e grava o cabeçalho. Exige `mutexLog`.
+ */
+void iniciarSegmento(uint8_t indice, const CabecalhoSegmento& cab){
+  char nome[16];
+  nomeSegmento(indice, nome, sizeof(nome));
+  arquivoLog = LittleFS.open(nome, "w"); // "w" trunca o segmento reaproveitado.
+  if(arquivoLog){
+    arquivoLog.write((const uint8_t*)&cab, sizeof(cab));
+  }
+}
+
+/**
+ * @brief Acrescenta um bloco de registros ao segmento atual, que fica aberto entre as
+ * escritas. Exige `mutexLog`.
+ */
+bool escreverRegistros(RegistroLog* bloco, size_t tam){
+  if(!arquivoLog){
+    char nome[16];
+    nomeSegmento(segmentoAtual, nome, sizeof(nome));
+    arquivoLog = LittleFS.open(nome, "a"); // Abre em modo "append" (adiciona ao final).
+  }
+  if(!arquivoLog){
+    return false;
+  }
+  arquivoLog.write((const uint8_t*)bloco, tam * sizeof(RegistroLog));
+  return true;
+}
+
+/**
+ * @brief `flush()`: uma única confirmação de metadados para o lote inteiro.
+ */
+void confirmarRegistros(){
+  arquivoLog.flush();
+}
+
+/**
+ * @brief Fecha o arquivo do segmento atual, se aberto.
+ */
+void fecharSegmento(){
+  if(arquivoLog){
+    arquivoLog.close();
+  }
+}
+
+/**
+ * @brief Abre um segmento para leitura, já posicionado (`seek`) no registro pedido.
+ */
+bool abrirLeitorSegmento(LeitorSegmento& leitor, uint8_t indice, size_t posicao){
+  char nome[16];
+  nomeSegmento(indice, nome, sizeof(nome));
+  leitor.arquivo = LittleFS.open(nome, "r");
+  if(!leitor.arquivo){
+    return false;
+  }
+  leitor.arquivo.seek(LOG_BYTES_CABECALHO + posicao * sizeof(RegistroLog));
+  return true;
+}
+
+/**
+ * @brief Lê o próximo bloco de registros do arquivo.
+ * @param bloco Recebe o endereço do primeiro registro lido.
+ * @return Quantos registros foram lidos (0 no fim do arquivo).
+ */
+size_t lerBlocoSegmento(LeitorSegmento& leitor, const RegistroLog*& bloco){
+  bloco = leitor.bloco;
+  return leitor.arquivo.read((uint8_t*)leitor.bloco, sizeof(leitor.bloco)) / sizeof(RegistroLog);
+}
+
+void fecharLeitorSegmento(LeitorSegmento& leitor){
+  leitor.arquivo.close();
+}
+
+#endif
+
+/**
+ * @brief Localiza, na inicialização, o segmento mais recente e a próxima sequência.
+ */
+void iniciarLogs(){
+  iniciarArmazenamentoLog();
+
+  bool encontrou = false;
+  uint32_t maiorInicio = 0;
+  for(uint8_t i = 0; i < LOG_SEGMENTOS; i++){
+    CabecalhoSegmento cab;
+    size_t registros;
+    indiceLog[i].valido = lerCabecalhoSegmento(i, cab, registros);
+    if(indiceLog[i].valido){
+      montarIndiceSegmento(i, cab.sequenciaInicial, registros);
+    }
+    if(indiceLog[i].valido && (!encontrou || cab.sequenciaInicial > maiorInicio)){
+      encontrou = true;
+      maiorInicio = cab.sequenciaInicial;
+      segmentoAtual = i;
+      registrosNoSegmento = registros;
+      proximaSequencia = cab.sequenciaInicial + registros;
+    }
+  }
+
+  File f = LittleFS.open(LOG_EXPORTADO, "r");
+  if(f){
+    f.read((uint8_t*)&proximaExportacao, sizeof(proximaExportacao));
+    f.close();
+  }
+  if(!encontrou){
+    // Nenhum segmento ainda: o primeiro lote cria o segmento 0.
+    segmentoAtual = LOG_SEGMENTOS - 1;
+    registrosNoSegmento = LOG_REGISTROS_POR_SEGMENTO;
+  }
+  importarLogLegado();
+}
+
+/**
+ * @brief Converte o final do log em texto das versões anteriores em registros e só
+ * então apaga o arquivo, que crescia sem limite. Chamada uma vez, antes da tarefa de
+ * gravação existir; os registros antigos ficam antes de qualquer evento deste boot.
+ */
+void importarLogLegado(){
+  File f = LittleFS.open(LOG_FILE_LEGADO, "r");
+  if(!f){
+    return;
+  }
+  char linha[160];
+  f.setTimeout(0); // No fim do arquivo, `readBytesUntil()` não espera por mais bytes.
+  size_t tamanho = f.size();
+  if(tamanho > LOG_LEGADO_MAX_BYTES){
+    f.seek(tamanho - LOG_LEGADO_MAX_BYTES);
+    f.readBytesUntil('\n', linha, sizeof(linha) - 1); // Descarta a linha cortada.
+  }
+
+  RegistroLog bloco[16];
+  size_t tam = 0;
+  bool gravou = true;
+  RegistroLog anterior = {};
+  xSemaphoreTake(mutexLog, portMAX_DELAY);
+  for(;;){
+    size_t n = f.readBytesUntil('\n', linha, sizeof(linha) - 1);
+    bool fim = n == 0 && f.available() == 0;
+    if(!fim){
+      linha[n] = '\0';
+      if(converterLinhaLegado(linha, anterior, bloco[tam])){
+        anterior = bloco[tam++];
+        legadoImportados++;
+      } else if(n > 0){
+        legadoSemEquivalente++;
+      }
+    }
+    // O bloco nunca passa do fim do segmento, como em `gravarBufferLog()`.
+    if(registrosNoSegmento >= LOG_REGISTROS_POR_SEGMENTO && tam > 0){
+      rotacionarSegmento();
+    }
+    if(tam > 0 && (fim || tam == sizeof(bloco) / sizeof(bloco[0]) ||
+                   tam == LOG_REGISTROS_POR_SEGMENTO - registrosNoSegmento)){
+      gravou = gravou && anexarRegistros(bloco, tam);
+      tam = 0;
+    }
+    if(fim){
+      break;
+    }
+  }
+  if(legadoImportados > 0){
+    confirmarRegistros();
+  }
+  xSemaphoreGive(mutexLog);
+  f.close();
+
+  if(gravou){
+    LittleFS.remove(LOG_FILE_LEGADO);
+    Serial.printf("Log antigo convertido: %lu eventos importados, %lu linhas sem equivalente.\n",
+                  (unsigned long)legadoImportados, (unsigned long)legadoSemEquivalente);
+  } else {
+    Serial.println("Erro ao converter o log antigo; o arquivo foi mantido.");
+    legadoImportados = 0;
+  }
+}
+
+/**
+ * @brief Converte uma linha "[AAAA-MM-DD HH:MM:SS] texto" do log antigo em registro.
+ * Uma linha sem horário (relógio ainda não sincronizado) herda o da linha anterior.
+ * @return `false` se o texto não tem um evento equivalente.
+ */
+bool converterLinhaLegado(const char* linha, const RegistroLog& anterior, RegistroLog& r){
+  const char* fecha = strstr(linha, "] ");
+  if(linha[0] != '[' || fecha == nullptr){
+    return false;
+  }
+  const char* texto = fecha + 2;
+  for(const EquivalenciaLegado& e : EQUIVALENCIAS_LEGADO){
+    const char* trecho = strstr(texto, e.trecho); // As frases de armar e desarmar têm emoji antes.
+    if(trecho == nullptr){
+      continue;
+    }
+    const char* resto = trecho + strlen(e.trecho);
+    r = anterior;
+    r.codigo = e.codigo;
+    r.origem = e.origem;
+    r.valor = e.valor;
+    r.crc = 0;
+    if(e.leitura == LEG_NUMERO){
+      r.valor = strtoul(resto, nullptr, 10);
+    } else if(e.leitura == LEG_ORIGEM){
+      for(uint8_t o = 0; o < TOTAL_ORIGENS; o++){
+        if(strcmp(resto, NOMES_ORIGEM[o]) == 0){
+          r.origem = o;
+        }
+      }
+    }
+    // O texto está no horário local do `configTime()`, que ainda não vale neste ponto.
+    struct tm t = {};
+    if(sscanf(linha + 1, "%d-%d-%d %d:%d:%d", &t.tm_year, &t.tm_mon, &t.tm_mday,
+              &t.tm_hour, &t.tm_min, &t.tm_sec) == 6){
+      t.tm_year -= 1900;
+      t.tm_mon -= 1;
+      r.instante = (uint32_t)(mktime(&t) - FUSO_HORARIO_S);
+      r.flags = REG_RELOGIO_SINCRONIZADO;
+    }
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Preenche o índice de um segmento existente lendo apenas o primeiro e o
+ * último registro (os registros de um segmento estão em ordem cronológica).
+ */
+void montarIndiceSegmento(uint8_t indice, uint32_t sequenciaInicial, size_t registros){
+  IndiceSegmento& ind = indiceLog[indice];
+  ind.sequenciaInicial = sequenciaInicial;
+  ind.registros = registros;
+  ind.primeiroInstante = 0;
+  ind.ultimoInstante = 0;
+  if(registros == 0){
+    return;
+  }
+  RegistroLog r;
+  if(lerRegistroSegmento(indice, 0, r)){
+    atualizarInstantesIndice(ind, r);
+  }
+  if(lerRegistroSegmento(indice, registros - 1, r)){
+    atualizarInstantesIndice(ind, r);
+  }
+}
+
+/**
+ * @brief Atualiza a faixa de instantes de um segmento com um registro novo.
+ */
+void atualizarInstantesIndice(IndiceSegmento& ind, const RegistroLog& r){
+  if(!(r.flags & REG_RELOGIO_SINCRONIZADO)){
+    return; // Sem relógio, o instante não pode ser comparado com datas.
+  }
+  if(ind.primeiroInstante == 0){
+    ind.primeiroInstante = r.instante;
+  }
+  ind.ultimoInstante = r.instante;
+}
+
+/**
+ * @brief Abre o próximo segmento da rotação, descartando o conteúdo mais antigo.
+ * Exige `mutexLog`.
+ */
+void rotacionarSegmento(){
+  fecharSegmento();
+  segmentoAtual = (segmentoAtual + 1) % LOG_SEGMENTOS;
+  CabecalhoSegmento cab = { LOG_MAGIA, proximaSequencia };
+  iniciarSegmento(segmentoAtual, cab);
+  registrosNoSegmento = 0;
+
+  IndiceSegmento& ind = indiceLog[segmentoAtual];
+  ind.valido = true;
+  ind.sequenciaInicial = proximaSequencia;
+  ind.registros = 0;
+  ind.primeiroInstante = 0;
+  ind.ultimoInstante = 0;
+}
+
+/**
+ * @brief Grava no segmento atual tudo o que estiver no buffer de logs. Exige `mutexLog`.
+ * O arquivo permanece aberto; `flush()` confirma o lote inteiro de uma vez.
+ */
+void gravarBufferLog(){
+  RegistroLog bloco[16];
+  size_t tam;
+  bool gravou = false;
+  do {
+    // O bloco nunca passa do fim do segmento, então a rotação sempre cai entre registros.
+    portENTER_CRITICAL(&muxBufferLog);
+    bool pendentes = usadosBufferLog > 0;
+    portEXIT_CRITICAL(&muxBufferLog);
+    if(registrosNoSegmento >= LOG_REGISTROS_POR_SEGMENTO && pendentes){
+      rotacionarSegmento();
+    }
+    size_t livres = LOG_REGISTROS_POR_SEGMENTO - registrosNoSegmento;
+
+    // Copia um bloco do buffer com a seção crítica aberta pelo menor tempo possível.
+    portENTER_CRITICAL(&muxBufferLog);
+    tam = min(usadosBufferLog, min(sizeof(bloco) / sizeof(bloco[0]), livres));
+    for(size_t i = 0; i < tam; i++){
+      bloco[i] = bufferLog[(inicioBufferLog + i) % LOG_BUFFER_REGISTROS];
+    }
+    inicioBufferLog = (inicioBufferLog + tam) % LOG_BUFFER_REGISTROS;
+    usadosBufferLog -= tam;
+    portEXIT_CRITICAL(&muxBufferLog);
+
+    if(tam > 0){
+      if(!anexarRegistros(bloco, tam)){
+        Serial.println("Erro ao gravar registros de log.");
+        return;
+      }
+      gravou = true;
+    }
+  } while(tam > 0);
+
+  if(gravou){
+    confirmarRegistros();
+  }
+}
+
+/**
+ * @brief Acrescenta um bloco ao segmento atual e atualiza o índice. O bloco não pode
+ * passar do fim do segmento. Exige `mutexLog`.
+ */
+bool anexarRegistros(RegistroLog* bloco, size_t tam){
+  if(!escreverRegistros(bloco, tam)){
+    return false;
+  }
+  registrosNoSegmento += tam;
+  proximaSequencia += tam;
+
+  IndiceSegmento& ind = indiceLog[segmentoAtual];
+  ind.registros = registrosNoSegmento;
+  for(size_t i = 0; i < tam; i++){
+    atualizarInstantesIndice(ind, bloco[i]);
+  }
+  return true;
+}
+
+/**
+ * @brief Ponto de descarga explícito: grava imediatamente o que estiver pendente.
+ * Usado antes de ler os segmentos de log (em `/logs`) e antes de reiniciar.
+ */
+void descarregarLogs(){
+  xSemaphoreTake(mutexLog, portMAX_DELAY);
+  gravarBufferLog();
+  xSemaphoreGive(mutexLog);
+}
+
+/**
+ * @brief Tratador registrado com `esp_register_shutdown_handler`: roda dentro de
+ * `esp_restart()` e grava os logs pendentes antes do reinício.
+ */
+void descarregarLogsAoReiniciar(){
+  if(xSemaphoreTake(mutexLog, pdMS_TO_TICKS(200)) == pdTRUE){
+    gravarBufferLog();
+    fecharSegmento();
+    xSemaphoreGive(mutexLog);
+  }
+}
+
+/**
+ * @brief Tarefa de gravação de logs: acorda por acúmulo, por evento crítico, por um
+ * instantâneo do estado a gravar ou a cada `LOG_INTERVALO_MS`, e grava o buffer em um
+ * único lote.
+ */
+void tarefaLog(void* parametro){
+  uint32_t descartadosReportados = 0;
+  uint32_t ultimoDespejoMetricas = millis();
+  for(;;){
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOG_INTERVALO_MS));
+    gravarInstantaneoNvs(); // O estado do alarme vem antes dos logs.
+    descarregarLogs();
+
+    // De carona na tarefa de baixa prioridade: o despejo na serial não atrasa o loop.
+    if(millis() - ultimoDespejoMetricas >= METRICAS_INTERVALO_SERIAL_MS){
+      ultimoDespejoMetricas = millis();
+      static char texto[METRICAS_TEXTO_MAX];
+      formatarMetricas(texto, sizeof(texto), "METRICA ");
+      Serial.print(texto);
+    }
+
+    if(logsDescartados != descartadosReportados){
+      descartadosReportados = logsDescartados;
+      Serial.printf("Aviso: %lu registros de log descartados (buffer cheio).\n", (unsigned long)descartadosReportados);
+    }
+  }
+}
+
+/**
+ * @brief Chamada pelo SNTP a cada sincronização do relógio (fora das nossas tarefas):
+ * só sinaliza, e o cache é esvaziado na próxima formatação.
+ */
+void aoSincronizarRelogio(struct timeval* tv){
+  relogioRessincronizado = true;
+}
+
+/**
+ * @brief Escreve dois dígitos decimais, sem `printf`.
+ */
+static inline void escreverDoisDigitos(char* destino, uint32_t valor){
+  destino[0] = (char)('0' + valor / 10);
+  destino[1] = (char)('0' + valor % 10);
+}
+
+/**
+ * @brief Formata o instante de um registro no formato AAAA-MM-DD HH:MM:SS, usando o
+ * cache. Antes da sincronização do NTP, escreve o tempo desde o boot (`boot+NNNNNNs`),
+ * que mantém a ordem dos registros e tem custo constante.
+ * @param r O registro.
+ * @param destino Buffer que recebe o texto.
+ * @param tam Tamanho do buffer.
+ */
+void formatarInstante(const RegistroLog& r, char* destino, size_t tam){
+  if(!(r.flags & REG_RELOGIO_SINCRONIZADO)){
+    snprintf(destino, tam, "boot+%07lus", (unsigned long)r.instante);
+    return;
+  }
+  if(relogioRessincronizado){
+    relogioRessincronizado = false;
+    cacheInstante.inicioDia = 0;
+  }
+
+  uint32_t segundoDoDia = r.instante - cacheInstante.inicioDia;
+  if(cacheInstante.inicioDia == 0 || r.instante < cacheInstante.inicioDia || segundoDoDia >= 86400){
+    // Outro dia: uma conversão completa, que vira a nova base do cache.
+    time_t instante = (time_t)r.instante;
+    struct tm timeinfo;
+    localtime_r(&instante, &timeinfo);
+    strftime(cacheInstante.texto, sizeof(cacheInstante.texto), "%Y-%m-%d %H:%M:%S", &timeinfo);
+    segundoDoDia = timeinfo.tm_hour * 3600 + timeinfo.tm_min * 60 + timeinfo.tm_sec;
+    cacheInstante.inicioDia = r.instante - segundoDoDia;
+    cacheInstante.ultimoMinuto = segundoDoDia / 60;
+  } else {
+    uint32_t minuto = segundoDoDia / 60;
+    if(minuto != cacheInstante.ultimoMinuto){
+      cacheInstante.ultimoMinuto = minuto;
+      escreverDoisDigitos(cacheInstante.texto + 11, minuto / 60);
+      escreverDoisDigitos(cacheInstante.texto + 14, minuto % 60);
+    }
+    escreverDoisDigitos(cacheInstante.texto + 17, segundoDoDia % 60);
+  }
+  strlcpy(destino, cacheInstante.texto, tam);
+}
+
+/**
+ * @brief Converte um registro binário na linha de texto do relatório.
+ * @param r O registro.
+ * @param destino Buffer que recebe a linha (terminada em '\n').
+ * @param tam Tamanho do buffer.
+ * @return O comprimento da linha gerada.
+ */
+size_t formatarRegistro(const RegistroLog& r, char* destino, size_t tam){
+  char instante[30];
+  char texto[96];
+  formatarInstante(r, instante, sizeof(instante));
+
+  if(r.codigo >= TOTAL_EVENTOS){
+    snprintf(texto, sizeof(texto), "Evento desconhecido (%u).", (unsigned)r.codigo);
+  } else {
+    const DescricaoEvento& d = DESCRICAO_EVENTOS[r.codigo];
+    const char* origem = r.origem < TOTAL_ORIGENS ? NOMES_ORIGEM[r.origem] : "?";
+    switch(d.formato){
+      case FMT_ORIGEM: snprintf(texto, sizeof(texto), d.texto, origem); break;
+      case FMT_VALOR:  snprintf(texto, sizeof(texto), d.texto, (unsigned long)r.valor); break;
+      case FMT_INCIDENTE: {
+        char zonas[48];
+        formatarZonas(r.valor & 0xFFFF, zonas, sizeof(zonas));
+        snprintf(texto, sizeof(texto), d.texto, (unsigned)((r.valor >> 16) & 0xFF),
+                 (unsigned)(r.valor >> 24), zonas);
+        break;
+      }
+      default:         strlcpy(texto, d.texto, sizeof(texto)); break;
+    }
+  }
+  int n = snprintf(destino, tam, "[%s] %s\n", instante, texto);
+  return n < 0 ? 0 : min((size_t)n, tam - 1);
+}
+
+/**
+ * @brief Mostra um registro no monitor serial, já convertido em texto.
+ */
+void ecoarRegistroSerial(const RegistroLog& r){
+  char linha[160];
+  formatarRegistro(r, linha, sizeof(linha));
+  Serial.print(linha);
+}
+
+#if SENTINELA_COM_TELEGRAM
+/**
+ * @brief Interpreta os argumentos do `/logs`. Aceita combinações como
+ * "ultimos 20 tipo alarme" ou "desde 2025-06-12 08:00".
+ * @param args O texto após "/logs".
+ * @param filtro Recebe os filtros reconhecidos.
+ * @return `false` se algum argumento for inválido.
+ */
+bool interpretarFiltroLogs(const char* args, FiltroLogs& filtro){
+  filtro.desde = 0;
+  filtro.ultimos = 0;
+  filtro.categoria = -1;
+  filtro.novos = false;
+
+  char buf[96];
+  strlcpy(buf, args, sizeof(buf));
+  char* contexto = nullptr;
+  char* palavra = strtok_r(buf, " ", &contexto);
+  while(palavra != nullptr){
+    if(strcmp(palavra, "novos") == 0 || strcmp(palavra, "new") == 0){
+      filtro.novos = true;
+    } else if(strcmp(palavra, "ultimos") == 0 || strcmp(palavra, "last") == 0){
+      char* n = strtok_r(nullptr, " ", &contexto);
+      filtro.ultimos = n ? strtoul(n, nullptr, 10) : 0;
+      if(filtro.ultimos == 0){
+        return false;
+      }
+    } else if(strcmp(palavra, "tipo") == 0 || strcmp(palavra, "type") == 0){
+      char* nome = strtok_r(nullptr, " ", &contexto);
+      filtro.categoria = -1;
+      for(uint8_t c = 0; nome != nullptr && c < TOTAL_CATEGORIAS; c++){
+        if(strcmp(nome, NOMES_CATEGORIA[c]) == 0){
+          filtro.categoria = c;
+        }
+      }
+      if(filtro.categoria < 0){
+        return false;
+      }
+    } else if(strcmp(palavra, "desde") == 0 || strcmp(palavra, "since") == 0){
+      char* data = strtok_r(nullptr, " ", &contexto);
+      // Uma hora logo após a data ("2025-06-12 08:00") faz parte do mesmo argumento.
+      char* hora = nullptr;
+      if(data != nullptr && strchr(data, '-') != nullptr && contexto != nullptr && isdigit((unsigned char)*contexto)){
+        hora = strtok_r(nullptr, " ", &contexto);
+      }
+      filtro.desde = interpretarInstante(data, hora);
+      if(filtro.desde == 0){
+        return false;
+      }
+    } else {
+      return false;
+    }
+    palavra = strtok_r(nullptr, " ", &contexto);
+  }
+  return true;
+}
+
+/**
+ * @brief Converte o argumento de `/logs desde` em epoch (horário local).
+ * Formatos: "AAAA-MM-DD [HH:MM]", "HH:MM" (hoje) ou relativo ("30m", "2h", "1d").
+ * @return O epoch correspondente, ou 0 se inválido ou se o relógio não sincronizou.
+ */
+uint32_t interpretarInstante(const char* data, const char* hora){
+  time_t agora = time(nullptr);
+  if(data == nullptr || agora < 1577836800){
+    return 0;
+  }
+  struct tm t;
+  localtime_r(&agora, &t);
+  unsigned long quantidade;
+  char unidade;
+  int ano, mes, dia, h = 0, m = 0;
+
+  if(sscanf(data, "%d-%d-%d", &ano, &mes, &dia) == 3){
+    if(hora != nullptr && sscanf(hora, "%d:%d", &h, &m) != 2){
+      return 0;
+    }
+    t.tm_year = ano - 1900;
+    t.tm_mon = mes - 1;
+    t.tm_mday = dia;
+  } else if(sscanf(data, "%d:%d", &h, &m) == 2){
+    // Apenas a hora: considera o dia de hoje.
+  } else if(sscanf(data, "%lu%c", &quantidade, &unidade) == 2){
+    uint32_t segundos = unidade == 'm' ? 60 : unidade == 'h' ? 3600 : unidade == 'd' ? 86400 : 0;
+    return segundos ? (uint32_t)(agora - (time_t)(quantidade * segundos)) : 0;
+  } else {
+    return 0;
+  }
+  t.tm_hour = h;
+  t.tm_min = m;
+  t.tm_sec = 0;
+  t.tm_isdst = -1;
+  time_t instante = mktime(&t);
+  return instante > 0 ? (uint32_t)instante : 0;
+}
+
+/**
+ * @brief Indica se um registro passa pelos filtros de categoria e de data.
+ */
+bool registroAtendeFiltro(const RegistroLog& r, const FiltroLogs& filtro){
+  if(filtro.categoria >= 0 &&
+     (r.codigo >= TOTAL_EVENTOS || DESCRICAO_EVENTOS[r.codigo].categoria != filtro.categoria)){
+    return false;
+  }
+  if(filtro.desde != 0 && (!(r.flags & REG_RELOGIO_SINCRONIZADO) || r.instante < filtro.desde)){
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Posiciona um cursor no início de um relatório.
+ */
+void iniciarCursorLogs(CursorLogs& cursor, const FiltroLogs& filtro, uint32_t inicio, uint32_t pular){
+  cursor.filtro = filtro;
+  cursor.sequencia = inicio;
+  cursor.fim = proximaSequencia;
+  cursor.pular = pular;
+  cursor.registros = 0;
+  cursor.tamLinha = 0;
+  cursor.posLinha = 0;
+}
+
+/**
+ * @brief Entrega o próximo trecho do relatório, lendo os segmentos a partir do cursor, do
+ * mais antigo ao mais recente. Usa o índice para pular segmentos inteiros e `seek` para
+ * começar no registro certo. Exige `mutexLog` só durante a chamada.
+ * @param cursor Onde a leitura parou; avança com o que foi entregue.
+ * @param destino Buffer que recebe o texto (sem terminador).
+ * @param tam Tamanho do buffer.
+ * @return Quantos bytes foram escritos (0 no fim do relatório ou num cancelamento).
+ */
+size_t lerRelatorioLogs(CursorLogs& cursor, char* destino, size_t tam){
+  size_t usados = 0;
+  // O segmento seguinte ao atual é o mais antigo da rotação.
+  for(uint8_t n = 1; n <= LOG_SEGMENTOS && !cancelarOperacao; n++){
+    // Primeiro o resto da linha que não coube na fatia anterior.
+    size_t resto = min((size_t)(cursor.tamLinha - cursor.posLinha), tam - usados);
+    memcpy(destino + usados, cursor.linha + cursor.posLinha, resto);
+    usados += resto;
+    cursor.posLinha += resto;
+    if(usados == tam){
+      break;
+    }
+
+    uint8_t indice = (segmentoAtual + n) % LOG_SEGMENTOS;
+    const IndiceSegmento& ind = indiceLog[indice];
+    uint32_t fimSegmento = min(ind.sequenciaInicial + ind.registros, cursor.fim);
+    if(!ind.valido || ind.registros == 0 || fimSegmento <= cursor.sequencia){
+      continue;
+    }
+    if(cursor.filtro.desde != 0 && ind.ultimoInstante < cursor.filtro.desde){
+      cursor.sequencia = fimSegmento; // Todo o segmento é anterior à data pedida.
+      continue;
+    }
+
+    // Registros que a rotação apagou desde o pedido ficam de fora.
+    cursor.sequencia = max(ind.sequenciaInicial, cursor.sequencia);
+    LeitorSegmento leitor;
+    if(!abrirLeitorSegmento(leitor, indice, cursor.sequencia - ind.sequenciaInicial)){
+      continue;
+    }
+    const RegistroLog* bloco;
+    size_t lidos;
+    while(usados < tam && cursor.sequencia < fimSegmento && !cancelarOperacao &&
+          (lidos = lerBlocoSegmento(leitor, bloco)) > 0){
+      esp_task_wdt_reset(); // Só a tarefa de trabalho lê o relatório.
+      for(size_t i = 0; i < lidos && usados < tam && cursor.sequencia < fimSegmento; i++){
+        cursor.sequencia++;
+        if(!registroIntegro(bloco[i]) || !registroAtendeFiltro(bloco[i], cursor.filtro)){
+          continue;
+        }
+        if(cursor.pular > 0){
+          cursor.pular--;
+          continue;
+        }
+        cursor.registros++;
+        cursor.tamLinha = formatarRegistro(bloco[i], cursor.linha, sizeof(cursor.linha));
+        cursor.posLinha = min((size_t)cursor.tamLinha, tam - usados);
+        memcpy(destino + usados, cursor.linha, cursor.posLinha);
+        usados += cursor.posLinha;
+      }
+    }
+    fecharLeitorSegmento(leitor);
+    if(usados == tam){
+      break;
+    }
+  }
+  return usados;
+}
+
+/**
+ * @brief Prepara o cursor do relatório com os registros que atendem aos filtros e mede o
+ * texto que ele vai gerar, sem gravar nada. Exige `mutexLog`.
+ * @param filtro Os filtros pedidos.
+ * @param cursor Recebe o cursor posicionado no início do relatório.
+ * @param registros Recebe a quantidade de registros incluídos.
+ * @return O tamanho do relatório em bytes.
+ */
+size_t prepararRelatorioLogs(const FiltroLogs& filtro, CursorLogs& cursor, size_t& registros){
+  // A sequência inicial já elimina, sem ler nada, o que `novos` e `ultimos` descartam.
+  uint32_t inicio = 0;
+  if(filtro.novos){
+    inicio = proximaExportacao;
+  }
+  uint32_t pular = 0;
+  char* rascunho = (char*)blocoUpload; // Livre até o upload começar.
+  if(filtro.ultimos != 0){
+    if(filtro.categoria < 0 && filtro.desde == 0){
+      if(proximaSequencia > filtro.ultimos){
+        inicio = max(inicio, proximaSequencia - filtro.ultimos);
+      }
+    } else {
+      // Com outros filtros, conta os aprovados primeiro para saber quantos pular.
+      iniciarCursorLogs(cursor, filtro, inicio, 0);
+      while(lerRelatorioLogs(cursor, rascunho, sizeof(blocoUpload)) > 0){}
+      pular = cursor.registros > filtro.ultimos ? cursor.registros - filtro.ultimos : 0;
+    }
+  }
+
+  iniciarCursorLogs(cursor, filtro, inicio, pular);
+  CursorLogs medida = cursor;
+  size_t bytes = 0, n;
+  while((n = lerRelatorioLogs(medida, rascunho, sizeof(blocoUpload))) > 0){
+    bytes += n;
+  }
+  registros = medida.registros;
+  return bytes;
+}
+
+/**
+ * @brief Envia o relatório de log para o chat do Telegram. Executada na tarefa de trabalho,
+ * com conexão própria. Relatórios pequenos vão como mensagem; os maiores, como documento,
+ * montado dos segmentos em fatias que alimentam o watchdog e respeitam `/cancelar` e
+ * alertas pendentes.
+ * @param filtro Os filtros pedidos no comando `/logs`.
+ */
+void enviarLogsTelegram(const FiltroLogs& filtro){
+  etapaOperacao = ETAPA_VARRENDO;
+  xSemaphoreTake(mutexLog, portMAX_DELAY);
+  gravarBufferLog(); // Garante que os segmentos contenham os eventos mais recentes.
+  size_t registros;
+  size_t bytes = prepararRelatorioLogs(filtro, cursorUpload, registros);
+  uint32_t fimVarredura = cursorUpload.fim;
+  xSemaphoreGive(mutexLog);
+
+  if(cancelarOperacao){
+    return;
+  }
+  // O handshake fica fora da vigilância do watchdog: seu tempo depende da rede, não de nós.
+  esp_task_wdt_delete(nullptr);
+  bool conectado = garantirSessaoTelegram(clientTrabalho);
+  esp_task_wdt_add(nullptr);
+  if(!conectado){
+    return;
+  }
+  if(registros == 0){
+    botTrabalho.sendMessage(CHAT_ID, "Nenhum registro de log encontrado para o pedido.", "");
+    return;
+  }
+
+  etapaOperacao = ETAPA_ENVIANDO;
+  progressoTotal = bytes;
+  bool enviado;
+  if(progressoTotal <= LOG_MENSAGEM_MAX){
+    // Estático: só a tarefa de trabalho chega aqui, e 3,5 KB não cabem bem na pilha dela.
+    static char texto[LOG_MENSAGEM_MAX + 1];
+    xSemaphoreTake(mutexLog, portMAX_DELAY);
+    size_t n = lerRelatorioLogs(cursorUpload, texto, LOG_MENSAGEM_MAX);
+    xSemaphoreGive(mutexLog);
+    texto[n] = '\0';
+    pausarSeHouverAlerta();
+    enviado = !cancelarOperacao && n > 0 && botTrabalho.sendMessage(CHAT_ID, texto, "");
+  } else {
+    // Envia o relatório como um documento. Isso evita o limite de caracteres
+    // de uma mensagem normal e melhora a formatação.
+    String resposta = botTrabalho.sendMultipartFormDataToTelegram(
+        "sendDocument", "document", "log_sentinela.txt", "text/plain", CHAT_ID, progressoTotal,
+        uploadTemMaisDados, nullptr, uploadProximoBloco, uploadTamanhoBloco);
+    enviado = !cancelarOperacao && resposta.indexOf("\"ok\":true") >= 0;
+  }
+  if(!enviado){
+    return; // Cancelado ou falhou: a marca do `/logs novos` não avança.
+  }
+
+  // Avança a marca usada por `/logs novos` (só exportações completas ou incrementais contam).
+  bool semFiltros = filtro.desde == 0 && filtro.ultimos == 0 && filtro.categoria < 0;
+  if((filtro.novos || semFiltros) && fimVarredura > proximaExportacao){
+    proximaExportacao = fimVarredura;
+    File marca = LittleFS.open(LOG_EXPORTADO, "w");
+    if(marca){
+      marca.write((const uint8_t*)&proximaExportacao, sizeof(proximaExportacao));
+      marca.close();
+    }
+  }
+}
+
+
+// =================================================================================
+// --- OPERAÇÕES LONGAS (TAREFA DE TRABALHO) ---
+// =================================================================================
+
+/**
+ * @brief Tarefa FreeRTOS que executa as operações longas, uma por vez.
+ * Fica inscrita no watchdog de tarefas só enquanto trabalha: ociosa, ela passa o
+ * tempo bloqueada na fila e não tem o que alimentar.
+ */
+void tarefaTrabalho(void* parametro){
+  clientTrabalho.setCACert(TELEGRAM_CERTIFICATE_ROOT);
+  OperacaoLonga op;
+  for(;;){
+    xQueueReceive(filaOperacoes, &op, portMAX_DELAY);
+    cancelarOperacao = false;
+    progressoFeito = 0;
+    progressoTotal = 0;
+    esp_task_wdt_add(nullptr);
+    if(op.tipo == OP_ENVIAR_LOGS){
+      enviarLogsTelegram(op.filtro);
+    }
+#if SENTINELA_COM_OTA
+    if(op.tipo == OP_ATUALIZAR_FIRMWARE){
+      atualizarFirmware(op);
+    }
+#endif
+    esp_task_wdt_delete(nullptr);
+    clientTrabalho.stop(); // Devolve a memória da sessão TLS até a próxima operação.
+    etapaOperacao = ETAPA_OCIOSA;
+    if(cancelarOperacao){
+      notificar(op.tipo == OP_ENVIAR_LOGS ? "🛑 Envio do log cancelado."
+                                                     : "🛑 Atualização do firmware cancelada.", false, PRIO_NORMAL);
+    }
+  }
+}
+
+/**
+ * @brief Segura a operação enquanto houver um disparo ainda não notificado, alimentando o
+ * watchdog. Desiste da pausa após `OPERACAO_PAUSA_MAX_MS` (por exemplo, alerta sem Wi-Fi).
+ */
+void pausarSeHouverAlerta(){
+  uint32_t inicio = millis();
+  EtapaOperacao etapa = etapaOperacao;
+  while(!cancelarOperacao && (disparoPendente || alertasPendentes()) &&
+        millis() - inicio < OPERACAO_PAUSA_MAX_MS){
+    etapaOperacao = ETAPA_PAUSADA;
+    esp_task_wdt_reset();
+    vTaskDelay(pdMS_TO_TICKS(50));
+  }
+  etapaOperacao = etapa;
+}
+
+/**
+ * @brief Callback do upload: ainda há fatias a enviar? Um cancelamento encerra o envio.
+ */
+bool uploadTemMaisDados(){
+  return !cancelarOperacao && progressoFeito < progressoTotal;
+}
+
+/**
+ * @brief Callback do upload: monta a próxima fatia do relatório direto dos segmentos.
+ * O mutex fica com a tarefa só durante a fatia, e a gravação dos logs segue entre elas.
+ */
+byte* uploadProximoBloco(){
+  pausarSeHouverAlerta();
+  esp_task_wdt_reset();
+  if(cancelarOperacao){
+    clientTrabalho.stop(); // O servidor descarta o envio incompleto.
+    tamanhoBlocoUpload = 0;
+    return blocoUpload;
+  }
+  size_t pedir = min((size_t)(progressoTotal - progressoFeito), sizeof(blocoUpload));
+  xSemaphoreTake(mutexLog, portMAX_DELAY);
+  size_t n = lerRelatorioLogs(cursorUpload, (char*)blocoUpload, pedir);
+  xSemaphoreGive(mutexLog);
+  if(n < pedir && !cancelarOperacao){
+    // A rotação apagou registros já medidos: completa o tamanho anunciado com linhas vazias.
+    memset(blocoUpload + n, '\n', pedir - n);
+    n = pedir;
+  }
+  tamanhoBlocoUpload = n;
+  progressoFeito += tamanhoBlocoUpload;
+  return blocoUpload;
+}
+
+/**
+ * @brief Callback do upload: tamanho da fatia lida por `uploadProximoBloco()`.
+ */
+int uploadTamanhoBloco(){
+  return tamanhoBlocoUpload;
+}
+#endif
+
+#if SENTINELA_COM_OTA
+
+// =================================================================================
+// --- ATUALIZAÇÃO PELO AR (OTA) ---
+// =================================================================================
+
+/**
+ * @brief Chamada pelo núcleo do Arduino no boot. Com `true`, ele não confirma sozinho a
+ * imagem recém-instalada: quem decide é `verificarSaudeFirmware()`.
+ */
+extern "C" bool verifyRollbackLater(){
+  return true;
+}
+
+/**
+ * @brief Entrega o `/atualizar` à tarefa de trabalho. Recusa se já houver uma operação longa.
+ * @param cmd O comando, com o endereço e o SHA-256 da imagem.
+ */
+void solicitarAtualizacaoFirmware(const Comando& cmd){
+  OperacaoLonga op;
+  op.tipo = OP_ATUALIZAR_FIRMWARE;
+  strlcpy(op.url, cmd.url, sizeof(op.url));
+  memcpy(op.sha256, cmd.sha256, sizeof(op.sha256));
+  if(xQueueSend(filaOperacoes, &op, 0) != pdTRUE){
+    notificar("⏳ Já há uma operação em andamento. Use /cancelar para interrompê-la.", false, PRIO_NORMAL);
+    return;
+  }
+  notificar("⬇️ Baixando o firmware novo. O alarme continua funcionando durante a atualização.", false, PRIO_NORMAL);
+}
+
+/**
+ * @brief No boot: descobre se esta imagem está em teste (primeiro boot após um
+ * `/atualizar`) ou se a anterior foi reprovada e o bootloader voltou para esta.
+ * Chamada no `setup()`, com o log já disponível.
+ */
+void iniciarVerificacaoFirmware(){
+  const esp_partition_t* atual = esp_ota_get_running_partition();
+  esp_ota_img_states_t estado;
+  firmwareEmTeste = esp_ota_get_state_partition(atual, &estado) == ESP_OK &&
+                    estado == ESP_OTA_IMG_PENDING_VERIFY;
+  if(firmwareEmTeste){
+    Serial.printf("Firmware novo em teste na partição %s.\n", atual->label);
+    return;
+  }
+  preferencias.begin(NVS_NAMESPACE, false);
+  uint32_t alvo = preferencias.getUInt(NVS_CHAVE_OTA, 0);
+  if(alvo != 0){
+    preferencias.remove(NVS_CHAVE_OTA);
+  }
+  preferencias.end();
+  if(alvo != 0 && alvo != atual->address){
+    logEventoCritico(EVT_FIRMWARE_REVERTIDO, ORIGEM_SISTEMA, 0);
+    notificar("⚠️ O firmware novo não passou na verificação de saúde: a versão anterior foi restaurada.", false, PRIO_NORMAL);
+  }
+}
+
+/**
+ * @brief Verificação de saúde do firmware em teste, a cada volta da tarefa de rede.
+ * Chegar ao Telegram prova que sensores, Wi-Fi, TLS e o certificado funcionam: a imagem
+ * é confirmada. Sem isso em `OTA_PRAZO_SAUDE_MS`, ela é marcada inválida e o ESP32
+ * reinicia na versão anterior.
+ */
+void verificarSaudeFirmware(){
+  if(!firmwareEmTeste){
+    return;
+  }
+  if(bootOnline){
+    firmwareEmTeste = false;
+    esp_ota_mark_app_valid_cancel_rollback();
+    Preferences nvs; // `preferencias` é do núcleo 1; esta tarefa usa um objeto próprio.
+    nvs.begin(NVS_NAMESPACE, false);
+    nvs.remove(NVS_CHAVE_OTA);
+    nvs.end();
+    logEventoCritico(EVT_FIRMWARE_CONFIRMADO, ORIGEM_SISTEMA, millis());
+    char msg[NOTIF_TEXTO_MAX];
+    snprintf(msg, sizeof(msg), "✅ Firmware novo confirmado (partição %s).", esp_ota_get_running_partition()->label);
+    notificar(msg, false, PRIO_NORMAL);
+  } else if(millis() > OTA_PRAZO_SAUDE_MS){
+    Serial.println("Firmware novo não chegou ao Telegram no prazo: revertendo.");
+    esp_ota_mark_app_invalid_rollback_and_reboot(); // Reinicia; a versão anterior registra a reversão.
+  }
+}
+
+/**
+ * @brief Operação longa do `/atualizar`: baixa a imagem em fatias de `OPERACAO_BLOCO`
+ * bytes, grava cada fatia na partição OTA inativa e a soma ao SHA-256. Nada muda no boot
+ * se o download falhar, for cancelado ou o hash não conferir. Roda na tarefa de trabalho,
+ * pausando enquanto houver um alerta por enviar; o alarme segue no núcleo 1.
+ * @param op A operação, com o endereço e o SHA-256 esperado.
+ */
+void atualizarFirmware(const OperacaoLonga& op){
+  etapaOperacao = ETAPA_ATUALIZANDO;
+  const esp_partition_t* destino = esp_ota_get_next_update_partition(nullptr);
+  if(destino == nullptr){
+    notificar("❌ Atualização impossível: a tabela de partições não tem partição OTA.", false, PRIO_NORMAL);
+    return;
+  }
+
+  // A imagem é autenticada pelo SHA-256 que veio do chat; o servidor pode ser qualquer um.
+  bool https = strncmp(op.url, "https://", 8) == 0;
+  WiFiClient clienteSimples;
+  if(https){
+    clientTrabalho.setInsecure();
+  }
+  HTTPClient http;
+  http.setTimeout(OTA_TIMEOUT_MS);
+  http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS); // Links de "releases" redirecionam.
+  const char* erro = nullptr;
+  int tamanho = 0;
+  // Conexão e cabeçalhos ficam fora da vigilância do watchdog, como o handshake do upload.
+  esp_task_wdt_delete(nullptr);
+  bool recebido = http.begin(https ? (WiFiClient&)clientTrabalho : clienteSimples, op.url) &&
+                  http.GET() == HTTP_CODE_OK;
+  esp_task_wdt_add(nullptr);
+  if(!recebido){
+    erro = "o servidor não entregou o arquivo";
+  } else {
+    tamanho = http.getSize();
+    if(tamanho <= 0 || (uint32_t)tamanho > destino->size){
+      erro = "tamanho da imagem ausente ou maior que a partição";
+    }
+  }
+
+  esp_ota_handle_t ota = 0;
+  bool otaAberta = false;
+  mbedtls_sha256_context sha;
+  mbedtls_sha256_init(&sha);
+  mbedtls_sha256_starts(&sha, 0);
+  if(erro == nullptr){
+    // Gravação sequencial: cada setor é apagado na hora de receber dados, sem apagar
+    // a partição inteira de antemão (o que seguraria a tarefa por segundos).
+    otaAberta = esp_ota_begin(destino, OTA_WITH_SEQUENTIAL_WRITES, &ota) == ESP_OK;
+    if(!otaAberta){
+      erro = "não foi possível abrir a partição OTA";
+    }
+  }
+  progressoTotal = tamanho;
+  WiFiClient* fluxo = http.getStreamPtr();
+  while(erro == nullptr && progressoFeito < progressoTotal){
+    pausarSeHouverAlerta();
+    esp_task_wdt_reset();
+    if(cancelarOperacao){
+      erro = "cancelada";
+      break;
+    }
+    size_t pedir = min((size_t)(progressoTotal - progressoFeito), sizeof(blocoUpload));
+    size_t lidos = fluxo->readBytes(blocoUpload, pedir);
+    if(lidos == 0){
+      erro = "o download parou no meio";
+    } else if(esp_ota_write(ota, blocoUpload, lidos) != ESP_OK){
+      erro = "falha ao gravar na flash";
+    } else {
+      mbedtls_sha256_update(&sha, blocoUpload, lidos);
+      progressoFeito += lidos;
+    }
+  }
+  http.end();
+  if(https){
+    clientTrabalho.setCACert(TELEGRAM_CERTIFICATE_ROOT); // Volta a ser a conexão do Telegram.
+  }
+
+  uint8_t calculado[32];
+  mbedtls_sha256_finish(&sha, calculado);
+  mbedtls_sha256_free(&sha);
+  if(erro == nullptr && memcmp(calculado, op.sha256, sizeof(calculado)) != 0){
+    erro = "o SHA-256 não confere";
+  }
+  if(erro == nullptr){
+    otaAberta = false;
+    if(esp_ota_end(ota) != ESP_OK){ // Também valida o cabeçalho e a soma da imagem.
+      erro = "a imagem recebida não é um firmware válido";
+    } else if(esp_ota_set_boot_partition(destino) != ESP_OK){
+      erro = "não foi possível trocar a partição de boot";
+    }
+  }
+  if(otaAberta){
+    esp_ota_abort(ota);
+  }
+  if(erro != nullptr){
+    if(!cancelarOperacao){
+      char msg[NOTIF_TEXTO_MAX];
+      snprintf(msg, sizeof(msg), "❌ Atualização abortada: %s. O firmware atual continua.", erro);
+      notificar(msg, false, PRIO_NORMAL);
+    }
+    return;
+  }
+
+  Preferences nvs;
+  nvs.begin(NVS_NAMESPACE, false);
+  nvs.putUInt(NVS_CHAVE_OTA, destino->address);
+  nvs.end();
+  logEventoCritico(EVT_FIRMWARE_INSTALADO, ORIGEM_SISTEMA, (uint32_t)tamanho);
+  char msg[NOTIF_TEXTO_MAX];
+  snprintf(msg, sizeof(msg), "🔄 Firmware gravado na partição %s e SHA-256 conferido. Reiniciando; "
+           "se a versão nova não chegar ao Telegram em %lu min, a atual volta sozinha.",
+           destino->label, (unsigned long)(OTA_PRAZO_SAUDE_MS / 60000));
+  notificar(msg, false, PRIO_NORMAL);
+  reiniciarComFirmwareNovo();
+}
+
+/**
+ * @brief Reinicia na partição nova depois de dar tempo para o aviso sair. A sirene tocando
+ * não segura o reinício: o instantâneo traz o disparo de volta, com o relé religado. Só um
+ * disparo recém-acontecido, ainda sem alerta enfileirado ou fora do instantâneo da RTC,
+ * adia a troca, e no máximo até `OTA_ESPERA_MAX_REINICIO_MS`.
+ */
+void reiniciarComFirmwareNovo(){
+  uint32_t inicio = millis();
+  while(millis() - inicio < OTA_ESPERA_REINICIO_MS ||
+        ((disparoPendente || (estadoAlarme == ALARME_DISPARADO && instantaneoRtc.estado != ALARME_DISPARADO)) &&
+         millis() - inicio < OTA_ESPERA_MAX_REINICIO_MS)){
+    esp_task_wdt_reset();
+    vTaskDelay(pdMS_TO_TICKS(100));
+  }
+  esp_restart(); // O tratador de desligamento grava o que restar do log.
+}
+#endif